@@ -3,6 +3,12 @@
 #include "header/ppu.h"
 #include "header/apu.h"
 #include "header/cartridge.h"
+#include "header/savestate.h"
+#include "header/fingerprint.h"
+#include "header/watchpoints.h"
+#include "header/codedatalog.h"
+#include "header/eventlog.h"
+#include "header/cheats.h"
 
 bus::bus() {
     reset();
@@ -23,7 +29,10 @@ void bus::connectAPU(apu *apu) {
 
     if (connectedAPU) {
         connectedAPU->setDmcReader([this](uint16_t a) -> uint8_t {
-            return this->read(a, true);
+            uint8_t data = this->read(a, true);
+            CdlPcm(this->cdl, *this, a);
+            EventSignal(this->events, EventLog::DmcDma, a, data);
+            return data;
         });
     }
 }
@@ -35,7 +44,32 @@ void bus::insertCartridge(cartridge* cart) {
         connectedPPU->connectCartridge(cart);
 }
 
+// Side-effect-free reads (readonly: debugger views, DMA) never hit
+// watchpoints; cheats patch them like any other read
 uint8_t bus::read(uint16_t addr, bool readonly) {
+    uint8_t data = readMemory(addr, readonly);
+
+    const uint8_t trap = trapPages[addr >> 8];
+    if (trap & TRAP_CHEAT)
+        data = cheats->onRead(addr, data);
+
+    if (!readonly) {
+        CdlCpuRead(cdl, *this, addr);
+        EventRead(events, addr, data);
+    }
+
+    if ((trap & TRAP_READ) && !readonly)
+        watchpoints->onAccess(*this, Watchpoints::Read, addr, data);
+
+    return data;
+}
+
+void bus::trapExec(uint16_t pc) {
+    if (watchpoints)
+        watchpoints->onAccess(*this, Watchpoints::Exec, pc, read(pc, true));
+}
+
+uint8_t bus::readMemory(uint16_t addr, bool readonly) {
     uint8_t data = 0x00;
 
     // Cartridge takes priority
@@ -65,7 +99,7 @@ uint8_t bus::read(uint16_t addr, bool readonly) {
         } else {
             // Return lowest bit, then shift right
             data_out = controller_state[idx] & 0x01;
-            controller_state[idx] >>= 1;
+            if (!readonly) controller_state[idx] >>= 1;
         }
 
         return data_out;
@@ -75,6 +109,10 @@ uint8_t bus::read(uint16_t addr, bool readonly) {
 }
 
 void bus::write(uint16_t addr, uint8_t data) {
+    if (trapPages[addr >> 8] & TRAP_WRITE)
+        watchpoints->onAccess(*this, Watchpoints::Write, addr, data);
+
+    EventWrite(events, addr, data);
 
     // OAM DMA ($4014)
     // Starts a DMA transfer of 256 bytes from CPU page (data << 8) into OAM
@@ -118,11 +156,15 @@ void bus::write(uint16_t addr, uint8_t data) {
     }
 
     // Cartridge first
-    if (cart && cart->cpuWrite(addr, data))
+    // (Some mappers take register writes but report them as not handled)
+    const bool handled = cart && cart->cpuWrite(addr, data);
+    EventMapperWrite(events, addr, data);
+    if (handled)
         return;
 
     // Internal RAM ($0000-$1FFF mirrored)
     if (addr <= 0x1FFF) {
+        FingerprintWrite(fingerprint, Fingerprint::CpuRam, addr & 0x07FF, ram[addr & 0x07FF], data);
         ram[addr & 0x07FF] = data;
         return;
     }
@@ -153,23 +195,24 @@ void bus::clock()
 
         if (dma_transfer)
         {
+            EventDmaCycle(events);
+
             // DMA dummy cycle: wait until an odd CPU cycle before starting reads/writes
-            // Use CPU-cycle parity
-            static uint64_t cpuCycleCount = 0; // local static ok, or make a member
-            cpuCycleCount++;
+            // Use CPU-cycle parity (kept per bus so it is part of the save state)
+            dma_cycle++;
 
             if (dma_dummy)
             {
                 // On real hardware DMA begins on an even CPU cycle
-                // wait for cpuCycleCount to be odd then start.
-                if (cpuCycleCount & 1) {
+                // wait for dma_cycle to be odd then start.
+                if (dma_cycle & 1) {
                     dma_dummy = false;
                 }
             }
             else
             {
                 // Alternate read/write each CPU cycle
-                if ((cpuCycleCount & 1) == 0)
+                if ((dma_cycle & 1) == 0)
                 {
                     // Read from CPU memory
                     uint16_t addr = (uint16_t(dma_page) << 8) | dma_addr;
@@ -178,6 +221,8 @@ void bus::clock()
                 else
                 {
                     // Write to OAM at current OAMADDR
+                    FingerprintWrite(fingerprint, Fingerprint::Oam, connectedPPU->OAMADDR,
+                                     connectedPPU->OAM[connectedPPU->OAMADDR], dma_data);
                     connectedPPU->OAM[connectedPPU->OAMADDR] = dma_data;
                     connectedPPU->OAMADDR++;
 
@@ -217,6 +262,7 @@ void bus::reset() {
     dma_page = 0x00;
     dma_addr = 0x00;
     dma_data = 0x00;
+    dma_cycle = 0;
 
     if (connectedCPU) connectedCPU->reset();
     if (connectedAPU) connectedAPU->reset();
@@ -225,4 +271,37 @@ void bus::reset() {
 void bus::setControllerState(int idx, uint8_t state) {
     if (idx < 0 || idx > 1) return;
     controller[idx] = state;
-}
\ No newline at end of file
+}
+void bus::saveState(StateWriter& w) const {
+    w.pod(ram);
+    saveRegisters(w);
+}
+
+void bus::saveRegisters(StateWriter& w) const {
+    w.pod(controller);
+    w.pod(controller_state);
+    w.pod(controller_strobe);
+    w.pod(systemClockCounter);
+
+    w.pod(dma_transfer);
+    w.pod(dma_dummy);
+    w.pod(dma_page);
+    w.pod(dma_addr);
+    w.pod(dma_data);
+    w.pod(dma_cycle);
+}
+
+void bus::loadState(StateReader& r) {
+    r.pod(ram);
+    r.pod(controller);
+    r.pod(controller_state);
+    r.pod(controller_strobe);
+    r.pod(systemClockCounter);
+
+    r.pod(dma_transfer);
+    r.pod(dma_dummy);
+    r.pod(dma_page);
+    r.pod(dma_addr);
+    r.pod(dma_data);
+    r.pod(dma_cycle);
+}
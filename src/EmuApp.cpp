@@ -1,5 +1,6 @@
 #include "header/EmuApp.h"
 
+#include <cstdio>
 #include <iostream>
 
 // GLAD
@@ -13,6 +14,14 @@
 
 #include "header/FileDialogs.h"
 #include "header/KeybindsUI.h"
+#include "header/savestate.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <unordered_map>
 
 #ifdef _WIN32
 #include <windows.h>
@@ -20,8 +29,22 @@
 
 
 void EmuApp::stepEMU() {
-    do { BUS.clock(); } while (CPU.complete());
-    do { BUS.clock(); } while (!CPU.complete());
+    try {
+        debugger.stepInto(NES);
+    } catch (const std::exception& e) {
+        emulationFault(e);
+    }
+}
+
+// cpu::XXX or the trace watchdog threw: the flight recorder has dumped by now
+void EmuApp::emulationFault(const std::exception& e)
+{
+    running = false;
+    accumulator = 0.0;
+    emuFault = e.what();
+    while (!emuFault.empty() && emuFault.back() == '\n') emuFault.pop_back();
+    showTraceLogger = true;
+    std::cerr << "Emulation stopped: " << emuFault << "\n";
 }
 
 bool EmuApp::init()
@@ -57,18 +80,6 @@ bool EmuApp::init()
     ImGui_ImplGlfw_InitForOpenGL(window, true);
     ImGui_ImplOpenGL3_Init("#version 330");
 
-    // Wire emulator
-    CPU.connectBus(&BUS);
-    BUS.connectCpu(&CPU);
-    BUS.connectPPU(&PPU);
-    BUS.connectAPU(&APU);
-
-    APU.setDmcReader([this](uint16_t a) -> uint8_t {
-    return BUS.read(a, true);
-    });
-
-
-
     // Keybinds
     binds = Keybinds::Defaults();
     if (!LoadKeybinds(binds, bindsPath)) {
@@ -83,6 +94,26 @@ bool EmuApp::init()
     // Textures
     textures.init();
 
+    watchpoints.attach(&BUS);
+    cheats.attach(&BUS);
+
+    // A game stuck in a spin loop for 5 s is dumped like a CPU fault
+    traceLog.attach(&NES);
+    traceLog.setHangWatchdog(300);
+    traceLog.startFlightRecorder("traces");
+
+    profiler.attach(&NES);
+    profiler.setRunning(false);
+
+    cdl.attach(&NES);
+    cdl.setRunning(false);
+
+    eventLog.attach(&NES);
+    eventLog.setRunning(false);
+
+    romLibrary.open(libraryPath);
+    if (!romLibrary.roots().empty()) romLibrary.scan();
+
     // timing
     lastTime = glfwGetTime();
     accumulator = 0.0;
@@ -92,6 +123,8 @@ bool EmuApp::init()
 
 void EmuApp::shutdown()
 {
+    traceLog.stop();
+    romLibrary.cancel();
     textures.shutdown();
     audio.shutdown();
 
@@ -109,21 +142,91 @@ void EmuApp::shutdown()
 
 bool EmuApp::loadRom(const std::string& path)
 {
-    if (path.empty()) return false;
+    movie.stop(NES);
+    if (!NES.loadRom(path)) return false;
 
-    auto newCart = std::make_unique<cartridge>(path);
-    if (!newCart->valid) return false;
+    loadedRomPath = path;
 
-    CART = std::move(newCart);
-    BUS.insertCartridge(CART.get());
+    rewind.clear();
+    runAheadNes.reset();
+
+    debugger.cancel();
+    disassembly.clear();
+    memoryView.clear();
+    memoryEdit = -1;
+
+    const std::string cheatPath = Movie::PathFor(path, "cht");
+    cheats.clear();
+    cheatStatus.clear();
+    if (std::ifstream(cheatPath).good() && !cheats.load(cheatPath, &cheatStatus))
+        std::cerr << cheatStatus << "\n";
+    loadSymbols();
+    emuFault.clear();
+
+    // Counters are per PRG offset, so they start over with the new cartridge
+    const bool profiling = profiler.running();
+    profiler.attach(&NES);
+    profiler.setRunning(profiling);
+    profilerStatus.clear();
+
+    const bool logging = cdl.running();
+    cdl.attach(&NES);
+    cdl.clear();
+    cdl.setRunning(logging);
+    cdlStatus.clear();
+
+    const bool recording = eventLog.running();
+    eventLog.attach(&NES);
+    eventLog.setRunning(recording);
 
-    BUS.reset();
-    PPU.frame_complete = false;
-    loadedRomPath = path;
+    return true;
+}
+
+// game.nes.*.nl (FCEUX) next to the ROM, and game.dbg (ld65)
+void EmuApp::loadSymbols()
+{
+    symbols.clear();
+    if (loadedRomPath.empty()) return;
+
+    symbols.loadNl(loadedRomPath);
+
+    std::string stem = loadedRomPath;
+    size_t dot = stem.find_last_of('.');
+    size_t slash = stem.find_last_of("/\\");
+    if (dot != std::string::npos && (slash == std::string::npos || dot > slash)) stem.resize(dot);
+    symbols.loadDbg(stem + ".dbg");
+}
+
+bool EmuApp::saveStateSlot(int slot)
+{
+    if (!NES.CART || loadedRomPath.empty()) return false;
+    return SaveState::SaveToFile(BUS, SaveState::SlotPath(loadedRomPath, slot));
+}
+
+bool EmuApp::loadStateSlot(int slot)
+{
+    if (!NES.CART || loadedRomPath.empty()) return false;
+
+    // Jumping to a state breaks the movie's input timeline
+    if (movie.active()) {
+        movie.stop(NES);
+        movieStatus = "Movie stopped (state loaded)";
+    }
+    if (!SaveState::LoadFromFile(NES, SaveState::SlotPath(loadedRomPath, slot))) return false;
 
+    // History before the load belongs to another timeline
+    rewind.clear();
     return true;
 }
 
+void EmuApp::resetGame()
+{
+    // While recording, the reset becomes part of the movie and happens at the
+    // next frame boundary; during playback only the movie may reset
+    if (movie.mode() == Movie::Mode::Recording) movieFlags |= Movie::FRAME_RESET;
+    else if (movie.mode() == Movie::Mode::Idle) BUS.reset();
+}
+
 void EmuApp::beginImGuiFrame()
 {
     ImGui_ImplOpenGL3_NewFrame();
@@ -146,10 +249,15 @@ void EmuApp::tickEmulation()
 
     // shortcuts
     if (ImGui::IsKeyPressed(binds.runGame)) running = !running;
-    if (ImGui::IsKeyPressed(binds.resetGame)) BUS.reset();
+    if (ImGui::IsKeyPressed(binds.resetGame)) resetGame();
     if (ImGui::IsKeyPressed(binds.stepGame)) stepEMU();
+    if (ImGui::IsKeyPressed(binds.saveState)) saveStateSlot(stateSlot);
+    if (ImGui::IsKeyPressed(binds.loadState)) loadStateSlot(stateSlot);
 
-    if (!running) return;
+    if (!running) {
+        frameRendered = false;
+        return;
+    }
 
     double now = glfwGetTime();
     double delta = now - lastTime;
@@ -159,15 +267,142 @@ void EmuApp::tickEmulation()
 
     accumulator += delta;
 
+    // Holding the rewind key plays history backwards at the normal frame rate
+    rewinding = rewindEnabled && NES.CART && !movie.active() && ImGui::IsKeyDown(binds.rewind);
+
     while (accumulator >= targetFrameTime) {
-        PPU.frame_complete = false;
-        while (!PPU.frame_complete) {
-            BUS.clock();
+        if (rewinding) {
+            rewind.stepBack(BUS);
+            frameRendered = false;
+        } else {
+            try {
+                emulateFrame();
+            } catch (const std::exception& e) {
+                emulationFault(e);
+                break;
+            }
+
+            // A watchpoint or a debugger goal stopped the frame part-way: pause there
+            if (BUS.breakRequested) {
+                running = false;
+                accumulator = 0.0;
+                break;
+            }
+            if (rewindEnabled) rewind.capture(BUS);
         }
         accumulator -= targetFrameTime;
     }
 }
 
+static double Smooth(double avg, double sample)
+{
+    return avg == 0.0 ? sample : avg * 0.95 + sample * 0.05;
+}
+
+void EmuApp::emulateFrame()
+{
+    if (movie.active() == (BUS.watchpoints != nullptr))
+        watchpoints.attach(movie.active() ? nullptr : &BUS);
+
+    double t0 = glfwGetTime();
+    if (debugger.goal() != Debugger::Goal::None && !movie.active()) {
+        debugger.run(NES);
+    } else if (!movie.step(NES, movieFlags)) {
+        movieStatus = "Playback finished";
+        NES.runFrame();
+    }
+    movieFlags = 0x00;
+    frameCostMs = Smooth(frameCostMs, (glfwGetTime() - t0) * 1000.0);
+
+    if (runAheadFrames > 0 && NES.CART)
+        runAhead();
+    else
+        frameRendered = false;
+}
+
+// Run-ahead: after the real frame, snapshot, emulate N more frames with the
+// same input (silent, only the last one rasterized), present that, and go
+// back to the snapshot. With a second instance the main console is never
+// rolled back, so its audio stays continuous.
+void EmuApp::runAhead()
+{
+    double t0 = glfwGetTime();
+
+    size_t size = NES.stateSize();
+    if (runAheadState.size() != size) runAheadState.resize(size);
+    if (NES.saveState(runAheadState.data(), runAheadState.size()) == 0) return;
+
+    double t1 = glfwGetTime();
+
+    nes* ahead = &NES;
+    if (runAheadSecondInstance) {
+        if (!runAheadNes) {
+            runAheadNes = std::make_unique<nes>();
+            if (!runAheadNes->loadRom(NES.CART->image)) {
+                runAheadNes.reset();
+                return;
+            }
+            runAheadNes->APU.setOutputEnabled(false);
+        }
+        ahead = runAheadNes.get();
+        if (!ahead->loadState(runAheadState.data(), runAheadState.size())) return;
+    } else {
+        APU.setOutputEnabled(false);
+    }
+
+    // Speculative frames must not hit watchpoints or go into the trace,
+    // profile, code/data log or event viewer, but do run with the cheats on
+    auto traps = ahead->BUS.trapPages;
+    Cheats* aheadCheats = ahead->BUS.cheats;
+    for (size_t i = 0; i < traps.size(); i++)
+        ahead->BUS.trapPages[i] = BUS.trapPages[i] & bus::TRAP_CHEAT;
+    ahead->BUS.cheats = BUS.cheats;
+    TraceLog* trace = ahead->CPU.trace;
+    ahead->CPU.trace = nullptr;
+    Profiler* prof = ahead->CPU.profiler;
+    ahead->CPU.profiler = nullptr;
+    EventLog* events = ahead->BUS.events;
+    ahead->BUS.events = nullptr;
+    ahead->PPU.events = nullptr;
+    CodeDataLog* cdlLog = ahead->BUS.cdl;
+    ahead->BUS.cdl = nullptr;
+    ahead->PPU.cdl = nullptr;
+    if (ahead->CART) ahead->CART->cdl = nullptr;
+
+    // Not in save states; the real frames alone advance it
+    const uint64_t frameCount = ahead->PPU.frameCount;
+
+    for (int i = 0; i < runAheadFrames; i++)
+        ahead->runFrame();
+    ahead->renderFrame();
+
+    ahead->PPU.frameCount = frameCount;
+    ahead->BUS.trapPages = traps;
+    ahead->BUS.cheats = aheadCheats;
+    ahead->CPU.trace = trace;
+    ahead->CPU.profiler = prof;
+    ahead->BUS.events = events;
+    ahead->PPU.events = events;
+    ahead->BUS.cdl = cdlLog;
+    ahead->PPU.cdl = cdlLog;
+    if (ahead->CART) ahead->CART->cdl = cdlLog;
+
+    double t2 = glfwGetTime();
+
+    if (runAheadSecondInstance) {
+        PPU.frame = ahead->PPU.frame;
+    } else {
+        NES.loadState(runAheadState.data(), runAheadState.size());
+        APU.setOutputEnabled(true);
+    }
+    frameRendered = true;
+
+    double t3 = glfwGetTime();
+
+    stateCostMs    = Smooth(stateCostMs, ((t1 - t0) + (t3 - t2)) * 1000.0);
+    runAheadCostMs = Smooth(runAheadCostMs, (t3 - t0) * 1000.0);
+}
+
 void EmuApp::drawMenuBar()
 {
     if (!ImGui::BeginMainMenuBar())
@@ -175,6 +410,10 @@ void EmuApp::drawMenuBar()
 
     if (ImGui::BeginMenu("File")) {
         if (ImGui::MenuItem("Open ROM...")) {
+#ifndef _WIN32
+            // No native dialog here; the library is the way in
+            showLibrary = true;
+#endif
             std::string path = FileDialogs::OpenRomDialog(window);
             if (!path.empty()) {
                 if (!loadRom(path)) {
@@ -186,6 +425,7 @@ void EmuApp::drawMenuBar()
                 }
             }
         }
+        if (ImGui::MenuItem("ROM Library...")) showLibrary = true;
 
         if (ImGui::MenuItem("Exit")) {
             glfwSetWindowShouldClose(window, GLFW_TRUE);
@@ -195,16 +435,30 @@ void EmuApp::drawMenuBar()
 
     if (ImGui::BeginMenu("Game")) {
         if (ImGui::MenuItem(running ? "Pause" : "Run", ImGui::GetKeyName(binds.runGame))) running = !running;
-        if (ImGui::MenuItem("Reset Game", ImGui::GetKeyName(binds.resetGame))) BUS.reset();
+        if (ImGui::MenuItem("Reset Game", ImGui::GetKeyName(binds.resetGame))) resetGame();
 
-        if (ImGui::MenuItem("Step Instruction", ImGui::GetKeyName(binds.stepGame))) {
-            do { BUS.clock(); } while (CPU.complete());
-            do { BUS.clock(); } while (!CPU.complete());
+        if (ImGui::MenuItem("Step Instruction", ImGui::GetKeyName(binds.stepGame))) stepEMU();
+
+        ImGui::Separator();
+
+        if (ImGui::MenuItem("Save State", ImGui::GetKeyName(binds.saveState), false, NES.CART != nullptr))
+            saveStateSlot(stateSlot);
+        if (ImGui::MenuItem("Load State", ImGui::GetKeyName(binds.loadState), false, NES.CART != nullptr))
+            loadStateSlot(stateSlot);
+
+        if (ImGui::BeginMenu("State Slot")) {
+            for (int i = 1; i <= 4; i++) {
+                std::string label = "Slot " + std::to_string(i);
+                if (ImGui::MenuItem(label.c_str(), nullptr, stateSlot == i)) stateSlot = i;
+            }
+            ImGui::EndMenu();
         }
 
         ImGui::EndMenu();
     }
 
+    drawMovieMenu();
+
     if (ImGui::BeginMenu("Settings")) {
         if (ImGui::MenuItem("Change Keybinds...")) openKeybindsPopup = true;
         ImGui::EndMenu();
@@ -215,23 +469,119 @@ void EmuApp::drawMenuBar()
         ImGui::MenuItem("Memory", nullptr, &showMemory);
         ImGui::MenuItem("Stack", nullptr, &showStack);
         ImGui::MenuItem("PPU", nullptr, &showPPU);
-        ImGui::MenuItem("VRAM", nullptr, &showVRAM);
         ImGui::MenuItem("Pattern Tables", nullptr, &showPattern);
         ImGui::MenuItem("APU", nullptr, &showAPU);
+        ImGui::MenuItem("Rewind", nullptr, &showRewind);
+        ImGui::MenuItem("Run-Ahead", nullptr, &showRunAhead);
+        ImGui::MenuItem("Movie", nullptr, &showMovie);
+        ImGui::MenuItem("Watchpoints", nullptr, &showWatchpoints);
+        ImGui::MenuItem("Debugger", nullptr, &showDebugger);
+        ImGui::MenuItem("Trace Logger", nullptr, &showTraceLogger);
+        ImGui::MenuItem("Profiler", nullptr, &showProfiler);
+        ImGui::MenuItem("Code/Data Logger", nullptr, &showCodeDataLog);
+        ImGui::MenuItem("Event Viewer", nullptr, &showEventViewer);
+        ImGui::MenuItem("Cheats", nullptr, &showCheats);
+        ImGui::MenuItem("ROM Library", nullptr, &showLibrary);
         ImGui::EndMenu();
     }
 
     ImGui::EndMainMenuBar();
 }
 
+void EmuApp::drawMovieMenu()
+{
+    if (!ImGui::BeginMenu("Movie"))
+        return;
+
+    bool haveRom = NES.CART != nullptr;
+    bool idle = !movie.active();
+    std::string moviePath = Movie::PathFor(loadedRomPath, "nesmovie");
+    std::string fm2Path = Movie::PathFor(loadedRomPath, "fm2");
+    std::string indexPath = Movie::PathFor(loadedRomPath, "nesidx");
+
+    if (ImGui::MenuItem("Record from Power-On", nullptr, false, haveRom && idle)) {
+        movieFlags = 0x00;
+        if (movie.startRecording(NES, Movie::Anchor::PowerOn)) {
+            movieIndex.clear();
+            rewind.clear();
+            movieStatus = "Recording from power-on";
+        }
+    }
+    if (ImGui::MenuItem("Record from Current State", nullptr, false, haveRom && idle)) {
+        movieFlags = 0x00;
+        if (movie.startRecording(NES, Movie::Anchor::SaveState)) {
+            movieIndex.clear();
+            movieStatus = "Recording from current state";
+        }
+    }
+    if (ImGui::MenuItem("Play", nullptr, false, haveRom && idle && movie.frameCount() > 0)) {
+        if (movie.startPlayback(NES)) {
+            rewind.clear();
+            movieStatus = "Playing";
+        } else {
+            movieStatus = "Movie does not match this ROM";
+        }
+    }
+    if (ImGui::MenuItem("Stop", nullptr, false, !idle)) {
+        movie.stop(NES);
+        movieStatus = "Stopped";
+    }
+
+    ImGui::Separator();
+
+    if (ImGui::MenuItem("Save Movie", nullptr, false, haveRom && idle && movie.frameCount() > 0))
+        movieStatus = movie.saveFile(moviePath) ? "Saved " + moviePath : "Save failed";
+    if (ImGui::MenuItem("Load Movie", nullptr, false, haveRom && idle)) {
+        movieIndex.clear();
+        movieStatus = movie.loadFile(moviePath) ? "Loaded " + moviePath : "Load failed";
+        if (movieIndex.loadFile(indexPath, movie)) movieStatus += " (with seek index)";
+    }
+    if (ImGui::MenuItem("Import FM2", nullptr, false, haveRom && idle)) {
+        movieIndex.clear();
+        movieStatus = movie.importFM2(fm2Path) ? "Imported " + fm2Path : "Import failed";
+    }
+    if (ImGui::MenuItem("Export FM2", nullptr, false, haveRom && idle && movie.frameCount() > 0)) {
+        size_t sep = loadedRomPath.find_last_of("/\\");
+        std::string romName = sep == std::string::npos ? loadedRomPath : loadedRomPath.substr(sep + 1);
+        movieStatus = movie.exportFM2(fm2Path, romName) ? "Exported " + fm2Path : "Export failed";
+    }
+
+    ImGui::Separator();
+
+    if (ImGui::MenuItem("Replay Headless", nullptr, false, haveRom && idle && movie.frameCount() > 0))
+        replayMovieHeadless();
+
+    ImGui::EndMenu();
+}
+
+// Plays the movie on a separate silent instance as fast as possible; the
+// visible console is untouched
+void EmuApp::replayMovieHeadless()
+{
+    nes headless;
+    if (!headless.loadRom(NES.CART->image)) return;
+    headless.APU.setOutputEnabled(false);
+
+    Movie copy = movie;
+    double t0 = glfwGetTime();
+    bool ok = copy.replay(headless);
+    double secs = glfwGetTime() - t0;
+
+    char buf[160];
+    std::snprintf(buf, sizeof(buf), "Headless: %zu frames in %.2f s (%.0f fps), %s",
+                  movie.frameCount(), secs, secs > 0.0 ? (double)movie.frameCount() / secs : 0.0,
+                  !ok ? "FAILED / DESYNC" : movie.hasEndHash() ? "end state matches" : "no end hash to verify");
+    movieStatus = buf;
+}
+
 void EmuApp::drawPanels()
 {
     // Keybinds popup
     KeybindsUI::DrawPopup(binds, openKeybindsPopup);
 
-    // Draw latest frame
-    PPU.renderBackground();
-    PPU.renderSprites();
+    // Draw latest frame (run-ahead has already rasterized the one to present)
+    if (!frameRendered)
+        NES.renderFrame();
     textures.uploadFrameBGRA(PPU.frame.data());
 
     // Pattern tables
@@ -257,18 +607,8 @@ void EmuApp::drawPanels()
     }
 
     // Memory
-    if (showMemory) {
-        ImGui::Begin("Memory (PC View)");
-        uint16_t start = CPU.PC;
-        for (int i = 0; i < 256; i++) {
-            uint16_t addr = start + i;
-            uint8_t value = BUS.read(addr, true);
-            if (i % 16 == 0) ImGui::Text("\n%04X: ", addr);
-            ImGui::SameLine();
-            ImGui::Text("%02X ", value);
-        }
-        ImGui::End();
-    }
+    if (showMemory)
+        drawMemoryEditor();
 
     // Stack
     if (showStack) {
@@ -277,27 +617,6 @@ void EmuApp::drawPanels()
         ImGui::End();
     }
 
-    // VRAM
-    if (showVRAM) {
-        ImGui::Begin("PPU VRAM ($2000-$27FF)");
-        ImGui::Text("Nametable VRAM (2 KB)");
-        ImGui::Separator();
-
-        ImGui::BeginChild("VRAMScroll", ImVec2(0, 400), true);
-        for (int row = 0; row < 2048; row += 16) {
-            uint16_t addr = 0x2000 + row;
-            ImGui::Text("%04X:", addr);
-            ImGui::SameLine();
-            for (int col = 0; col < 16; col++) {
-                uint8_t value = PPU.vram[row + col];
-                ImGui::SameLine();
-                ImGui::Text("%02X", value);
-            }
-        }
-        ImGui::EndChild();
-        ImGui::End();
-    }
-
     // PPU
     if (showPPU) {
         ImGui::Begin("PPU");
@@ -404,6 +723,451 @@ void EmuApp::drawPanels()
         ImGui::End();
     }
 
+    // Rewind
+    if (showRewind) {
+        ImGui::Begin("Rewind");
+
+        ImGui::Checkbox("Enabled", &rewindEnabled);
+        if (ImGui::SliderInt("Budget (MB)", &rewindBudgetMB, 8, 512))
+            rewind.setBudget((size_t)rewindBudgetMB * 1024u * 1024u);
+
+        size_t frames = rewind.frameCount();
+        double usedMB = (double)rewind.usedBytes() / (1024.0 * 1024.0);
+
+        ImGui::Separator();
+        ImGui::Text("History: %zu frames (%.1f s)", frames, (double)frames / 60.0);
+        ImGui::Text("Memory:  %.2f / %d MB", usedMB, rewindBudgetMB);
+        ImGui::ProgressBar((float)(usedMB / (double)rewindBudgetMB));
+        ImGui::Text("Compression: %.1fx", rewind.compressionRatio());
+        ImGui::Text("Hold %s to rewind%s", ImGui::GetKeyName(binds.rewind), rewinding ? " (rewinding)" : "");
+
+        ImGui::End();
+    }
+
+    // Run-ahead
+    if (showRunAhead) {
+        ImGui::Begin("Run-Ahead");
+
+        ImGui::SliderInt("Frames ahead", &runAheadFrames, 0, 4);
+        if (ImGui::Checkbox("Second instance (continuous audio)", &runAheadSecondInstance))
+            runAheadNes.reset();
+
+        const double budgetMs = targetFrameTime * 1000.0;
+
+        ImGui::Separator();
+        ImGui::Text("Emulated frame: %.3f ms (%.0fx real time)",
+                    frameCostMs, frameCostMs > 0.0 ? budgetMs / frameCostMs : 0.0);
+        ImGui::Text("Save/load:      %.3f ms", stateCostMs);
+        ImGui::Text("Run-ahead:      %.3f ms per host frame", runAheadFrames > 0 ? runAheadCostMs : 0.0);
+
+        // Estimated host-frame cost for each setting: real frame + N ahead + snapshot work
+        ImGui::Separator();
+        for (int n = 1; n <= 2; n++) {
+            double est = frameCostMs * (1 + n) + (stateCostMs > 0.0 ? stateCostMs : 0.0);
+            bool fits = est < budgetMs * 0.8;
+            ImVec4 c = fits ? ImVec4(0.2f, 1.0f, 0.2f, 1.0f) : ImVec4(1.0f, 0.3f, 0.3f, 1.0f);
+            ImGui::TextColored(c, "N=%d: ~%.2f ms of %.2f ms %s", n, est, budgetMs, fits ? "(ok)" : "(too slow)");
+        }
+
+        ImGui::End();
+    }
+
+    // Movie
+    if (showMovie) {
+        ImGui::Begin("Movie");
+
+        const char* modeName = movie.mode() == Movie::Mode::Recording ? "Recording"
+                             : movie.mode() == Movie::Mode::Playing   ? "Playing" : "Idle";
+        ImGui::Text("Mode:   %s", modeName);
+        ImGui::Text("Anchor: %s", movie.anchor() == Movie::Anchor::PowerOn ? "power-on" : "save state");
+        if (movie.mode() == Movie::Mode::Playing)
+            ImGui::Text("Frame:  %zu / %zu", movie.cursor(), movie.frameCount());
+        else
+            ImGui::Text("Frames: %zu (%.1f s)", movie.frameCount(), (double)movie.frameCount() / 60.0);
+
+        // Seek index
+        bool canIndex = NES.CART && movie.mode() != Movie::Mode::Recording && movie.frameCount() > 0;
+        ImGui::Separator();
+        if (ImGui::SliderInt("Index budget (MB)", &movieIndexBudgetMB, 1, 256))
+            movieIndex.setBudget((size_t)movieIndexBudgetMB * 1024u * 1024u);
+
+        ImGui::BeginDisabled(!canIndex || movieIndex.building());
+        if (ImGui::Button("Build Seek Index")) movieIndex.build(movie, NES.CART->image);
+        ImGui::SameLine();
+        if (ImGui::Button("Save Index"))
+            movieStatus = movieIndex.saveFile(Movie::PathFor(loadedRomPath, "nesidx")) ? "Index saved" : "Index save failed";
+        ImGui::EndDisabled();
+
+        if (movieIndex.building())
+            ImGui::ProgressBar(movieIndex.progress());
+        ImGui::Text("Keyframes: %zu every %d frames, %.2f MB%s", movieIndex.keyframeCount(), movieIndex.interval(),
+                    (double)movieIndex.usedBytes() / (1024.0 * 1024.0),
+                    movieIndex.keyframeCount() > 0 && !movieIndex.matches(movie) ? " (stale)" : "");
+
+        ImGui::BeginDisabled(!canIndex);
+        ImGui::InputInt("Frame", &movieSeekFrame);
+        if (movieSeekFrame < 0) movieSeekFrame = 0;
+        if (movieSeekFrame > (int)movie.frameCount()) movieSeekFrame = (int)movie.frameCount();
+        ImGui::SameLine();
+        if (ImGui::Button("Seek")) {
+            if (movieIndex.seek(NES, movie, (size_t)movieSeekFrame)) {
+                rewind.clear();
+                frameRendered = false;
+                movieStatus = "Seeked to frame " + std::to_string(movieSeekFrame);
+            } else {
+                movieStatus = "Seek failed";
+            }
+        }
+        ImGui::EndDisabled();
+
+        if (!movieStatus.empty()) {
+            ImGui::Separator();
+            ImGui::TextWrapped("%s", movieStatus.c_str());
+        }
+
+        ImGui::End();
+    }
+
+    if (showWatchpoints)
+        drawWatchpoints();
+
+    if (showDebugger)
+        drawDebugger();
+
+    if (showTraceLogger)
+        drawTraceLogger();
+
+    if (showProfiler)
+        drawProfiler();
+
+    if (showCodeDataLog)
+        drawCodeDataLog();
+
+    if (showEventViewer)
+        drawEventViewer();
+
+    if (showCheats)
+        drawCheats();
+
+    if (showLibrary)
+        drawLibrary();
+}
+
+void EmuApp::drawWatchpoints()
+{
+    ImGui::Begin("Watchpoints");
+
+    // "0300" or "0300-03FF"
+    ImGui::SetNextItemWidth(110);
+    ImGui::InputText("Address", watchRange, sizeof(watchRange), ImGuiInputTextFlags_CharsHexadecimal | ImGuiInputTextFlags_CharsNoBlank);
+    ImGui::SameLine(); ImGui::Checkbox("R", &watchRead);
+    ImGui::SameLine(); ImGui::Checkbox("W", &watchWrite);
+    ImGui::SameLine(); ImGui::Checkbox("X", &watchExec);
+    ImGui::SameLine(); ImGui::Checkbox("Break", &watchBreak);
+
+    // e.g. "A == $40 && [$0075] > 3 && scanline < 20"
+    ImGui::SetNextItemWidth(300);
+    ImGui::InputTextWithHint("Condition", "always", watchCondition, sizeof(watchCondition));
+    ImGui::SameLine();
+    if (ImGui::Button("Add")) {
+        char* end = nullptr;
+        unsigned long lo = std::strtoul(watchRange, &end, 16);
+        unsigned long hi = (end && *end == '-') ? std::strtoul(end + 1, nullptr, 16) : lo;
+        uint8_t access = (watchRead ? Watchpoints::Read : 0) | (watchWrite ? Watchpoints::Write : 0) |
+                         (watchExec ? Watchpoints::Exec : 0);
+        Condition condition;
+        if (condition.compile(watchCondition, &watchError)) {
+            watchError.clear();
+            if (access && lo <= 0xFFFF && hi <= 0xFFFF)
+                watchpoints.add((uint16_t)lo, (uint16_t)hi, access, watchBreak, std::move(condition));
+        }
+    }
+    if (!watchError.empty())
+        ImGui::TextColored(ImVec4(1.0f, 0.4f, 0.4f, 1.0f), "%s", watchError.c_str());
+
+    if (movie.active())
+        ImGui::TextDisabled("Inactive while a movie is recording or playing");
+
+    ImGui::Separator();
+
+    int removeId = 0;
+    int conditionId = 0;
+    for (const Watchpoints::Watch& w : watchpoints.list()) {
+        ImGui::PushID(w.id);
+
+        bool enabled = w.enabled;
+        if (ImGui::Checkbox("##on", &enabled)) watchpoints.setEnabled(w.id, enabled);
+        ImGui::SameLine();
+        if (w.lo == w.hi) ImGui::Text("$%04X     ", w.lo);
+        else              ImGui::Text("$%04X-%04X", w.lo, w.hi);
+        ImGui::SameLine();
+        ImGui::Text("%c%c%c %s  hits %llu/%llu",
+                    (w.access & Watchpoints::Read) ? 'R' : '-',
+                    (w.access & Watchpoints::Write) ? 'W' : '-',
+                    (w.access & Watchpoints::Exec) ? 'X' : '-',
+                    w.breaks ? "break" : "count",
+                    (unsigned long long)w.hits, (unsigned long long)w.accesses);
+        if (ImGui::IsItemHovered())
+            ImGui::SetTooltip("hits: condition held / accesses in range");
+        ImGui::SameLine();
+        if (ImGui::SmallButton("x")) removeId = w.id;
+        ImGui::SameLine();
+        if (ImGui::SmallButton("if")) {
+            watchEditId = w.id;
+            std::snprintf(watchEditCondition, sizeof(watchEditCondition), "%s", w.condition.text().c_str());
+        }
+        if (!w.condition.empty()) {
+            ImGui::SameLine();
+            ImGui::TextDisabled("if %s", w.condition.text().c_str());
+            if (ImGui::IsItemHovered())
+                ImGui::SetTooltip("%s", w.condition.dump().c_str());
+        }
+
+        // Edit the condition in place; Enter or Set applies it
+        if (watchEditId == w.id) {
+            ImGui::SetNextItemWidth(300);
+            if (ImGui::InputTextWithHint("##condition", "always", watchEditCondition, sizeof(watchEditCondition),
+                                         ImGuiInputTextFlags_EnterReturnsTrue))
+                conditionId = w.id;
+            ImGui::SameLine();
+            if (ImGui::SmallButton("Set")) conditionId = w.id;
+            ImGui::SameLine();
+            if (ImGui::SmallButton("Cancel")) watchEditId = 0;
+        }
+
+        ImGui::PopID();
+    }
+    if (removeId) watchpoints.remove(removeId);
+    if (conditionId && watchpoints.setCondition(conditionId, watchEditCondition, &watchError)) {
+        watchError.clear();
+        watchEditId = 0;
+    }
+
+    if (!watchpoints.list().empty() && ImGui::SmallButton("Reset counts"))
+        watchpoints.resetCounts();
+
+    if (watchpoints.hasHit()) {
+        const Watchpoints::Hit& h = watchpoints.lastHit();
+        const char* kind = h.access == Watchpoints::Read ? "read" : h.access == Watchpoints::Write ? "write" : "exec";
+        ImGui::Separator();
+        ImGui::Text("Last hit: %s $%04X = $%02X at PC $%04X", kind, h.addr, h.value, h.pc);
+        if (BUS.breakRequested && !running)
+            ImGui::TextDisabled("Stopped mid-frame; Run continues from here");
+    }
+
+    ImGui::End();
+}
+
+void EmuApp::drawDebugger()
+{
+    ImGui::Begin("Debugger");
+
+    // Stepping mid-frame would desync a movie
+    const bool canStep = NES.CART && !movie.active();
+
+    if (ImGui::Button(running ? "Pause" : "Run")) {
+        debugger.cancel();
+        running = !running;
+    }
+    ImGui::BeginDisabled(!canStep || running);
+    ImGui::SameLine();
+    if (ImGui::Button("Step Into")) stepEMU();
+    ImGui::SameLine();
+    if (ImGui::Button("Step Over")) {
+        debugger.stepOver(NES);
+        if (debugger.goal() != Debugger::Goal::None) running = true;
+    }
+    ImGui::SameLine();
+    if (ImGui::Button("Step Out")) {
+        debugger.stepOut(NES);
+        running = true;
+    }
+    ImGui::SameLine();
+    ImGui::BeginDisabled(debuggerCursor < 0);
+    if (ImGui::Button("Run to Cursor")) {
+        debugger.runTo((uint16_t)debuggerCursor);
+        running = true;
+    }
+    ImGui::EndDisabled();
+    ImGui::EndDisabled();
+
+    ImGui::SameLine();
+    ImGui::Checkbox("Follow PC", &debuggerFollowPC);
+
+    ImGui::Text("A:%02X X:%02X Y:%02X SP:%02X P:%02X PC:%04X  scanline %d dot %d",
+                CPU.A, CPU.X, CPU.Y, CPU.SP, CPU.P, CPU.PC, PPU.scanline, PPU.cycle);
+    ImGui::SameLine();
+    ImGui::TextDisabled("(%zu labels)", symbols.size());
+    if (ImGui::IsItemHovered())
+        ImGui::SetTooltip("Read from <rom>.*.nl and <rom>.dbg when the ROM is loaded");
+    ImGui::SameLine();
+    if (ImGui::SmallButton("Reload")) loadSymbols();
+
+    ImGui::Separator();
+
+    disassembly.refresh(NES, CPU.PC);
+
+    ImGui::BeginChild("listing", ImVec2(0, 0), ImGuiChildFlags_None, ImGuiWindowFlags_HorizontalScrollbar);
+
+    const float lineHeight = ImGui::GetTextLineHeightWithSpacing();
+    if (debuggerFollowPC && CPU.PC != debuggerShownPC) {
+        float y = (float)disassembly.find(CPU.PC) * lineHeight;
+        ImGui::SetScrollY(std::max(0.0f, y - ImGui::GetWindowHeight() * 0.4f));
+        debuggerShownPC = CPU.PC;
+    }
+    if (debuggerScrollTo >= 0) {
+        ImGui::SetScrollY((float)disassembly.find((uint16_t)debuggerScrollTo) * lineHeight);
+        debuggerScrollTo = -1;
+    }
+
+    // Lines with an execute watchpoint get a breakpoint marker
+    auto breakpointAt = [&](uint16_t addr) {
+        for (const Watchpoints::Watch& w : watchpoints.list())
+            if (w.enabled && (w.access & Watchpoints::Exec) && addr >= w.lo && addr <= w.hi) return w.id;
+        return 0;
+    };
+
+    ImGuiListClipper clipper;
+    clipper.Begin((int)disassembly.lineCount(), lineHeight);
+    while (clipper.Step()) {
+        for (int i = clipper.DisplayStart; i < clipper.DisplayEnd; i++) {
+            const Disassembly::Line& line = disassembly.line((size_t)i);
+            const std::string* label = symbols.find(NES.CART.get(), line.addr);
+            const int bp = breakpointAt(line.addr);
+
+            char bytes[12];
+            if (line.len == 1)      std::snprintf(bytes, sizeof(bytes), "%02X      ", line.bytes[0]);
+            else if (line.len == 2) std::snprintf(bytes, sizeof(bytes), "%02X %02X   ", line.bytes[0], line.bytes[1]);
+            else                    std::snprintf(bytes, sizeof(bytes), "%02X %02X %02X", line.bytes[0], line.bytes[1], line.bytes[2]);
+
+            char row[160];
+            std::snprintf(row, sizeof(row), "%c%c %04X  %-16.16s %s  %s",
+                          bp ? '*' : ' ', line.addr == CPU.PC ? '>' : ' ', line.addr,
+                          label ? (*label + ":").c_str() : "", bytes,
+                          Disassembly::format(NES, line, &symbols).c_str());
+
+            ImGui::PushID(i);
+            if (line.addr == CPU.PC) ImGui::PushStyleColor(ImGuiCol_Text, ImVec4(1.0f, 0.9f, 0.3f, 1.0f));
+            if (ImGui::Selectable(row, debuggerCursor == line.addr, ImGuiSelectableFlags_AllowDoubleClick)) {
+                debuggerCursor = line.addr;
+                if (ImGui::IsMouseDoubleClicked(ImGuiMouseButton_Left)) {
+                    if (bp) watchpoints.remove(bp);
+                    else    watchpoints.add(line.addr, line.addr, Watchpoints::Exec);
+                }
+            }
+            if (line.addr == CPU.PC) ImGui::PopStyleColor();
+
+            if (ImGui::BeginPopupContextItem()) {
+                debuggerCursor = line.addr;
+                if (ImGui::MenuItem(bp ? "Remove Breakpoint" : "Add Breakpoint")) {
+                    if (bp) watchpoints.remove(bp);
+                    else    watchpoints.add(line.addr, line.addr, Watchpoints::Exec);
+                }
+                if (ImGui::MenuItem("Run to Here", nullptr, false, canStep)) {
+                    debugger.runTo(line.addr);
+                    running = true;
+                }
+                uint16_t target = 0;
+                if (Disassembly::target(NES, line, target) && ImGui::MenuItem("Go to Target")) {
+                    debuggerCursor = target;
+                    debuggerFollowPC = false;
+                    debuggerScrollTo = target;
+                }
+                ImGui::EndPopup();
+            }
+            ImGui::PopID();
+        }
+    }
+    clipper.End();
+
+    ImGui::EndChild();
+
+    if (ImGui::IsItemHovered()) {
+        Disassembly::Stats st = disassembly.stats();
+        ImGui::SetTooltip("Double-click: toggle breakpoint\nDecode cache: %zu pages, %llu decoded, %llu reused",
+                          st.cachedPages, (unsigned long long)st.pagesDecoded, (unsigned long long)st.pageHits);
+    }
+
+    ImGui::End();
+}
+
+void EmuApp::drawTraceLogger()
+{
+    ImGui::Begin("Trace Logger");
+
+    if (!emuFault.empty()) {
+        ImGui::TextColored(ImVec4(1.0f, 0.4f, 0.4f, 1.0f), "Stopped: %s", emuFault.c_str());
+        ImGui::Separator();
+    }
+
+    const TraceLog::Mode mode = traceLog.mode();
+    const char* formats[] = { "nestest", "Mesen" };
+    const TraceLog::Format format = (TraceLog::Format)traceFormat;
+
+    int selected = (int)mode;
+    ImGui::RadioButton("Off", &selected, (int)TraceLog::Mode::Off);
+    ImGui::SameLine(); ImGui::RadioButton("Flight recorder", &selected, (int)TraceLog::Mode::FlightRecorder);
+    if (ImGui::IsItemHovered())
+        ImGui::SetTooltip("Keeps the last instructions in memory; dumps them with a save state\n"
+                          "to %s/ when the CPU faults or the game hangs", traceLog.dumpDir().empty() ? "traces" : traceLog.dumpDir().c_str());
+    ImGui::SameLine(); ImGui::RadioButton("Stream to file", &selected, (int)TraceLog::Mode::Stream);
+
+    ImGui::BeginDisabled(mode == TraceLog::Mode::Stream);
+    ImGui::SetNextItemWidth(260);
+    ImGui::InputText("File", tracePath, sizeof(tracePath));
+    ImGui::EndDisabled();
+
+    if (selected != (int)mode) {
+        traceStatus.clear();
+        if (selected == (int)TraceLog::Mode::Off) {
+            traceLog.stop();
+        } else if (selected == (int)TraceLog::Mode::FlightRecorder) {
+            traceLog.startFlightRecorder("traces");
+        } else if (!traceLog.startStream(tracePath, &traceStatus)) {
+            traceLog.startFlightRecorder("traces");
+        }
+    }
+
+    ImGui::SetNextItemWidth(120);
+    ImGui::Combo("Text format", &traceFormat, formats, IM_ARRAYSIZE(formats));
+
+    // The ring in flight recorder mode; the streamed file once it is closed
+    ImGui::BeginDisabled(mode == TraceLog::Mode::Off);
+    if (ImGui::Button(mode == TraceLog::Mode::Stream ? "Stop and Export Text" : "Export Text")) {
+        const std::string textPath = std::string(tracePath) + ".txt";
+        if (mode == TraceLog::Mode::Stream) {
+            traceLog.startFlightRecorder("traces");
+            if (TraceLog::ExportFile(NES, tracePath, textPath, format, &traceStatus))
+                traceStatus = "Wrote " + textPath;
+        } else {
+            std::vector<TraceLog::Entry> entries = traceLog.snapshot();
+            std::ofstream out(textPath);
+            TraceLog::WriteText(out, NES, entries.data(), entries.size(), format);
+            traceStatus = out ? "Wrote " + textPath + " (" + std::to_string(entries.size()) + " instructions)"
+                              : "Cannot write " + textPath;
+        }
+    }
+    ImGui::EndDisabled();
+    ImGui::SameLine();
+    ImGui::BeginDisabled(mode != TraceLog::Mode::FlightRecorder || !NES.CART);
+    if (ImGui::Button("Dump Now")) {
+        std::string path = traceLog.dump("manual dump");
+        traceStatus = path.empty() ? "Dump failed" : "Wrote " + path;
+    }
+    ImGui::EndDisabled();
+
+    TraceLog::Stats st = traceLog.stats();
+    ImGui::Separator();
+    ImGui::Text("Instructions: %llu", (unsigned long long)st.recorded);
+    if (mode == TraceLog::Mode::Stream)
+        ImGui::Text("Written: %llu  (CPU waited for the disk %llu times)",
+                    (unsigned long long)st.written, (unsigned long long)st.stalls);
+    if (!st.lastDump.empty())
+        ImGui::TextWrapped("Last dump: %s", st.lastDump.c_str());
+    if (!traceStatus.empty())
+        ImGui::TextWrapped("%s", traceStatus.c_str());
+
+    ImGui::End();
 }
 
 int EmuApp::run()
@@ -425,3 +1189,669 @@ int EmuApp::run()
 
     return 0;
 }
+
+void EmuApp::drawProfiler()
+{
+    ImGui::Begin("Profiler");
+
+    const bool on = profiler.running();
+    if (ImGui::Button(on ? "Stop" : "Start")) profiler.setRunning(!on);
+    ImGui::SameLine();
+    if (ImGui::Button("Reset")) profiler.reset();
+    ImGui::SameLine();
+    ImGui::BeginDisabled(profiler.totalCycles() == 0);
+    if (ImGui::Button("Export Flame Graph")) {
+        // Collapsed stacks, for flamegraph.pl or speedscope
+        std::string path = (loadedRomPath.empty() ? std::string("profile") : loadedRomPath) + ".folded";
+        std::ofstream out(path);
+        profiler.writeCollapsed(out, &symbols);
+        profilerStatus = out ? "Wrote " + path : "Cannot write " + path;
+    }
+    ImGui::EndDisabled();
+    if (!profilerStatus.empty())
+        ImGui::TextWrapped("%s", profilerStatus.c_str());
+
+    const uint64_t total = profiler.totalCycles();
+    const uint64_t frames = profiler.frames();
+    const double perFrame = frames ? (double)total / (double)frames : 0.0;
+    ImGui::Text("%llu cycles over %llu frames (%.0f per frame)",
+                (unsigned long long)total, (unsigned long long)frames, perFrame);
+
+    Profiler::NmiStats nmi = profiler.nmiStats();
+    if (nmi.count) {
+        ImGui::Text("NMI handler: last %u  avg %.0f  max %u cycles (%.1f%% of a frame at most)",
+                    nmi.last, nmi.average, nmi.max, 100.0 * nmi.max / 29780.0);
+        std::vector<uint32_t> history = profiler.nmiHistory();
+        std::vector<float> values(history.begin(), history.end());
+        ImGui::PlotLines("##nmi", values.data(), (int)values.size(), 0, "NMI cycles", 0.0f,
+                         (float)nmi.max * 1.1f, ImVec2(-1, 60));
+    }
+
+    if (total == 0) {
+        ImGui::TextDisabled(on ? "Waiting for the CPU..." : "Start to count cycles per routine and bank");
+        ImGui::End();
+        return;
+    }
+
+    if (ImGui::CollapsingHeader("PRG banks")) {
+        const char* sizes[] = { "8 KB", "16 KB", "32 KB" };
+        ImGui::SetNextItemWidth(90);
+        ImGui::Combo("Bank size", &profilerBankSize, sizes, IM_ARRAYSIZE(sizes));
+
+        std::vector<uint64_t> banks = profiler.bankCycles(0x2000u << profilerBankSize);
+        for (size_t i = 0; i < banks.size(); i++) {
+            if (!banks[i]) continue;
+            char label[48];
+            std::snprintf(label, sizeof(label), "bank %02zu  %.1f%%", i, 100.0 * banks[i] / total);
+            ImGui::ProgressBar((float)((double)banks[i] / total), ImVec2(200, 0), "");
+            ImGui::SameLine();
+            ImGui::TextUnformatted(label);
+        }
+    }
+
+    if (ImGui::CollapsingHeader("Routines", ImGuiTreeNodeFlags_DefaultOpen)) {
+        // Call tree nodes merged per routine. Inclusive time counts a
+        // routine once even when it recurses.
+        struct Routine { size_t node; uint64_t calls = 0, self = 0, inclusive = 0; };
+        std::vector<Profiler::Node> tree = profiler.callTree();
+        std::unordered_map<uint64_t, Routine> routines;
+        for (size_t i = 0; i < tree.size(); i++) {
+            const Profiler::Node& n = tree[i];
+            const uint64_t key = (uint64_t)n.kind << 32 | n.key;
+            Routine& r = routines.emplace(key, Routine{ i }).first->second;
+            r.calls += n.calls;
+            r.self += n.self;
+
+            bool nested = false;
+            for (uint32_t p = n.parent; i && !nested; p = tree[p].parent) {
+                nested = tree[p].key == n.key && tree[p].kind == n.kind;
+                if (p == 0) break;
+            }
+            if (!nested) r.inclusive += n.inclusive;
+        }
+
+        std::vector<Routine> sorted;
+        for (auto& kv : routines) sorted.push_back(kv.second);
+        std::sort(sorted.begin(), sorted.end(),
+                  [](const Routine& a, const Routine& b) { return a.inclusive > b.inclusive; });
+
+        if (ImGui::BeginTable("routines", 5, ImGuiTableFlags_RowBg | ImGuiTableFlags_ScrollY | ImGuiTableFlags_Resizable,
+                              ImVec2(0, 300))) {
+            ImGui::TableSetupScrollFreeze(0, 1);
+            ImGui::TableSetupColumn("Routine");
+            ImGui::TableSetupColumn("Calls");
+            ImGui::TableSetupColumn("Inclusive");
+            ImGui::TableSetupColumn("Exclusive");
+            ImGui::TableSetupColumn("Cycles/frame");
+            ImGui::TableHeadersRow();
+
+            for (const Routine& r : sorted) {
+                ImGui::TableNextRow();
+                ImGui::TableNextColumn(); ImGui::TextUnformatted(profiler.nodeName(tree[r.node], &symbols).c_str());
+                ImGui::TableNextColumn(); ImGui::Text("%llu", (unsigned long long)r.calls);
+                ImGui::TableNextColumn(); ImGui::Text("%5.1f%%", 100.0 * r.inclusive / total);
+                ImGui::TableNextColumn(); ImGui::Text("%5.1f%%", 100.0 * r.self / total);
+                ImGui::TableNextColumn(); ImGui::Text("%.0f", frames ? (double)r.inclusive / frames : 0.0);
+            }
+            ImGui::EndTable();
+        }
+    }
+
+    ImGui::End();
+}
+
+void EmuApp::drawCodeDataLog()
+{
+    ImGui::Begin("Code/Data Logger");
+
+    const std::string path = loadedRomPath.empty() ? std::string() : loadedRomPath + ".cdl";
+
+    ImGui::BeginDisabled(!NES.CART);
+    const bool on = cdl.running();
+    if (ImGui::Button(on ? "Pause" : "Start")) cdl.setRunning(!on);
+    ImGui::SameLine();
+    if (ImGui::Button("Clear")) cdl.clear();
+    ImGui::SameLine();
+    if (ImGui::Button("Save")) {
+        cdlStatus = cdl.save(path) ? "Wrote " + path : "Cannot write " + path;
+    }
+    ImGui::SameLine();
+    if (ImGui::Button("Merge Saved")) {
+        // Adds <rom>.cdl from earlier sessions to the current flags
+        std::string error;
+        cdlStatus = cdl.merge(path, &error) ? "Merged " + path : error;
+    }
+    ImGui::EndDisabled();
+
+    if (!path.empty()) ImGui::TextDisabled("%s (FCEUX format)", path.c_str());
+    if (!cdlStatus.empty()) ImGui::TextWrapped("%s", cdlStatus.c_str());
+
+    ImGui::Separator();
+
+    const CodeDataLog::Coverage c = cdl.coverage();
+    if (c.prgSize) {
+        ImGui::ProgressBar((float)c.prgLogged() / (float)c.prgSize, ImVec2(200, 0));
+        ImGui::SameLine();
+        ImGui::Text("PRG logged: %zu code, %zu data of %zu bytes", c.code, c.data, c.prgSize);
+    }
+    if (c.chrSize) {
+        ImGui::ProgressBar((float)c.drawn / (float)c.chrSize, ImVec2(200, 0));
+        ImGui::SameLine();
+        ImGui::Text("CHR drawn: %zu of %zu bytes (%zu read by the CPU)", c.drawn, c.chrSize, c.read);
+    }
+
+    if (ImGui::CollapsingHeader("Report")) {
+        std::ostringstream report;
+        cdl.writeReport(report);
+        ImGui::TextUnformatted(report.str().c_str());
+    }
+
+    ImGui::End();
+}
+
+void EmuApp::drawEventViewer()
+{
+    ImGui::Begin("Event Viewer");
+
+    static const ImU32 colors[EventLog::TypeCount] = {
+        IM_COL32(100, 160, 255, 255),   // PPU read
+        IM_COL32(255, 120, 60, 255),    // PPU write
+        IM_COL32(120, 220, 220, 255),   // APU/IO read
+        IM_COL32(255, 220, 60, 255),    // APU/IO write
+        IM_COL32(255, 255, 255, 255),   // OAM DMA
+        IM_COL32(200, 100, 255, 255),   // mapper write
+        IM_COL32(255, 80, 200, 255),    // bank switch
+        IM_COL32(80, 255, 80, 255),     // NMI
+        IM_COL32(255, 60, 60, 255),     // IRQ
+        IM_COL32(160, 160, 160, 255),   // DMC DMA
+        IM_COL32(255, 255, 160, 255),   // sprite 0 hit
+    };
+
+    ImGui::BeginDisabled(!NES.CART);
+    const bool on = eventLog.running();
+    if (ImGui::Button(on ? "Stop" : "Start")) eventLog.setRunning(!on);
+    ImGui::SameLine();
+    if (ImGui::Button("Reset")) eventLog.reset();
+    ImGui::EndDisabled();
+    ImGui::SameLine();
+    ImGui::Checkbox("Picture", &eventPicture);
+
+    for (int t = 0; t < EventLog::TypeCount; t++) {
+        if (t % 6) ImGui::SameLine();
+        ImGui::PushStyleColor(ImGuiCol_CheckMark, colors[t]);
+        ImGui::Checkbox(EventLog::typeName((EventLog::Type)t), &eventShown[t]);
+        ImGui::PopStyleColor();
+    }
+
+    // Dot x scanline grid, two pixels per dot and scanline
+    constexpr float Z = 2.0f;
+    const ImVec2 p0 = ImGui::GetCursorScreenPos();
+    const ImVec2 size(EventLog::DOTS * Z, EventLog::SCANLINES * Z);
+    ImDrawList* draw = ImGui::GetWindowDrawList();
+    draw->AddRectFilled(p0, ImVec2(p0.x + size.x, p0.y + size.y), IM_COL32(24, 24, 24, 255));
+    if (eventPicture) {
+        // The picture is dots 1-256 of scanlines 0-239
+        const ImVec2 a(p0.x + Z, p0.y);
+        draw->AddImage((void*)(intptr_t)textures.frameTex(), a, ImVec2(a.x + 256 * Z, a.y + 240 * Z),
+                       ImVec2(0, 0), ImVec2(1, 1), IM_COL32(255, 255, 255, 110));
+    }
+    draw->AddLine(ImVec2(p0.x, p0.y + 241 * Z), ImVec2(p0.x + size.x, p0.y + 241 * Z), IM_COL32(80, 255, 80, 90));
+    draw->AddLine(ImVec2(p0.x + 257 * Z, p0.y), ImVec2(p0.x + 257 * Z, p0.y + size.y), IM_COL32(255, 255, 255, 40));
+
+    const EventLog::Event* events = eventLog.events();
+    const size_t count = eventLog.count();
+    for (size_t i = 0; i < count; i++) {
+        const EventLog::Event& e = events[i];
+        if (!eventShown[e.type]) continue;
+        const ImVec2 a(p0.x + e.dot * Z, p0.y + e.scanline * Z);
+        draw->AddRectFilled(a, ImVec2(a.x + Z, a.y + Z), colors[e.type]);
+    }
+
+    ImGui::InvisibleButton("##events", size);
+    if (ImGui::IsItemHovered()) {
+        const ImVec2 m = ImGui::GetIO().MousePos;
+        const int dot = (int)((m.x - p0.x) / Z);
+        const int line = (int)((m.y - p0.y) / Z);
+
+        ImGui::BeginTooltip();
+        ImGui::Text("Scanline %d, dot %d", line, dot);
+        int shown = 0;
+        for (size_t i = 0; i < count && shown < 12; i++) {
+            const EventLog::Event& e = events[i];
+            if (!eventShown[e.type] || e.scanline != line || std::abs(e.dot - dot) > 3) continue;
+            ImGui::TextColored(ImGui::ColorConvertU32ToFloat4(colors[e.type]), "%3d,%3d  %-12s $%04X = $%02X",
+                               e.scanline, e.dot, EventLog::typeName(e.type), e.addr, e.value);
+            shown++;
+        }
+        ImGui::EndTooltip();
+    }
+
+    const EventLog::Counters& frame = eventLog.frameCounters();
+    const EventLog::Counters& totals = eventLog.totals();
+    const double frames = (double)std::max<uint64_t>(eventLog.frames(), 1);
+    if (frame.dropped)
+        ImGui::TextColored(ImVec4(1, 0.4f, 0.4f, 1), "%llu events past the %zu per frame limit were not shown",
+                           (unsigned long long)frame.dropped, EventLog::CAPACITY);
+
+    if (ImGui::BeginTable("##eventcounts", 3, ImGuiTableFlags_RowBg | ImGuiTableFlags_SizingFixedFit)) {
+        ImGui::TableSetupColumn("Event");
+        ImGui::TableSetupColumn("Last frame");
+        ImGui::TableSetupColumn("Per frame (avg)");
+        ImGui::TableHeadersRow();
+
+        auto row = [](const char* name, uint64_t last, double avg) {
+            ImGui::TableNextRow();
+            ImGui::TableNextColumn(); ImGui::TextUnformatted(name);
+            ImGui::TableNextColumn(); ImGui::Text("%llu", (unsigned long long)last);
+            ImGui::TableNextColumn(); ImGui::Text("%.1f", avg);
+        };
+        row("Writes", frame.writes(), (double)totals.writes() / frames);
+        for (int t = 0; t < EventLog::TypeCount; t++)
+            row(EventLog::typeName((EventLog::Type)t), frame.events[t], (double)totals.events[t] / frames);
+        row("DMA cycles", frame.dmaCycles, (double)totals.dmaCycles / frames);
+        ImGui::EndTable();
+    }
+    ImGui::Text("%llu frames", (unsigned long long)eventLog.frames());
+
+    ImGui::End();
+}
+
+void EmuApp::drawMemoryEditor()
+{
+    ImGui::Begin("Memory");
+    memoryView.tick();
+
+    const MemoryView::Space space = (MemoryView::Space)memorySpace;
+    ImGui::SetNextItemWidth(150);
+    if (ImGui::BeginCombo("##space", MemoryView::name(space))) {
+        for (int s = 0; s < (int)MemoryView::Space::Count; s++) {
+            if (MemoryView::size(NES, (MemoryView::Space)s) == 0) continue;
+            if (ImGui::Selectable(MemoryView::name((MemoryView::Space)s), s == memorySpace)) {
+                memorySpace = s;
+                memoryEdit = -1;
+            }
+        }
+        ImGui::EndCombo();
+    }
+    ImGui::SameLine();
+    ImGui::SetNextItemWidth(70);
+    if (ImGui::InputText("Go to", memoryGoto, sizeof(memoryGoto),
+                         ImGuiInputTextFlags_CharsHexadecimal | ImGuiInputTextFlags_EnterReturnsTrue)) {
+        memoryScrollTo = (int)std::strtoul(memoryGoto, nullptr, 16);
+        memoryFollowPC = false;
+    }
+    if (space == MemoryView::Space::CpuBus) {
+        ImGui::SameLine();
+        ImGui::Checkbox("Follow PC", &memoryFollowPC);
+    }
+
+    const size_t size = MemoryView::size(NES, space);
+    if (size == 0) {
+        ImGui::TextDisabled("No %s on this cartridge", MemoryView::name(space));
+        ImGui::End();
+        return;
+    }
+
+    constexpr int   COLUMNS = 16;
+    constexpr float FADE = 60.0f;         // UI frames a change stays highlighted
+    const int digits = size > 0x10000 ? 6 : 4;
+    const int rows = (int)((size + COLUMNS - 1) / COLUMNS);
+
+    ImGui::BeginChild("bytes", ImVec2(0, 0), ImGuiChildFlags_None, ImGuiWindowFlags_NoMove);
+
+    const float lineHeight = ImGui::GetTextLineHeightWithSpacing();
+    const float charWidth = ImGui::CalcTextSize("F").x;
+    const float bytesX = (float)(digits + 2) * charWidth;
+    const float cell = 3.0f * charWidth;
+    auto cellX = [&](int col) { return bytesX + (float)col * cell + (col >= COLUMNS / 2 ? charWidth : 0.0f); };
+
+    if (memoryFollowPC && space == MemoryView::Space::CpuBus && CPU.PC != memoryShownPC) {
+        memoryScrollTo = CPU.PC;
+        memoryShownPC = CPU.PC;
+    }
+    if (memoryScrollTo >= 0) {
+        const float y = (float)((size_t)memoryScrollTo / COLUMNS) * lineHeight;
+        ImGui::SetScrollY(std::max(0.0f, y - ImGui::GetWindowHeight() * 0.3f));
+        memoryScrollTo = -1;
+    }
+
+    ImDrawList* draw = ImGui::GetWindowDrawList();
+    const ImU32 textColor = ImGui::GetColorU32(ImGuiCol_Text);
+    const ImU32 dimColor = ImGui::GetColorU32(ImGuiCol_TextDisabled);
+
+    // Only the rows in view are peeked and drawn; bytes go straight to the
+    // draw list, one invisible button per row takes the clicks
+    ImGuiListClipper clipper;
+    clipper.Begin(rows, lineHeight);
+    while (clipper.Step()) {
+        for (int row = clipper.DisplayStart; row < clipper.DisplayEnd; row++) {
+            const ImVec2 p = ImGui::GetCursorScreenPos();
+            const uint32_t base = (uint32_t)row * COLUMNS;
+
+            char label[16];
+            std::snprintf(label, sizeof(label), "%0*X:", digits, base);
+            draw->AddText(p, dimColor, label);
+
+            for (int col = 0; col < COLUMNS && base + col < size; col++) {
+                const uint32_t addr = base + col;
+                if ((int)addr == memoryEdit) continue;
+
+                const uint8_t value = MemoryView::peek(NES, space, addr);
+                const uint32_t age = memoryView.age(NES, space, addr, value);
+                const ImVec2 at(p.x + cellX(col), p.y);
+                if (age < FADE) {
+                    const int alpha = (int)(180.0f * (1.0f - (float)age / FADE));
+                    draw->AddRectFilled(at, ImVec2(at.x + 2 * charWidth, at.y + ImGui::GetTextLineHeight()),
+                                        IM_COL32(255, 70, 70, alpha));
+                }
+                char hex[4];
+                std::snprintf(hex, sizeof(hex), "%02X", value);
+                draw->AddText(at, textColor, hex);
+            }
+
+            ImGui::PushID(row);
+            ImGui::InvisibleButton("##row", ImVec2(cellX(COLUMNS), ImGui::GetTextLineHeight()));
+            const float mx = ImGui::GetIO().MousePos.x - p.x;
+            int col = -1;
+            for (int c = 0; c < COLUMNS; c++)
+                if (mx >= cellX(c) && mx < cellX(c) + cell) col = c;
+            const uint32_t hovered = base + (uint32_t)col;
+
+            if (col >= 0 && hovered < size && ImGui::IsItemHovered()) {
+                const uint8_t value = MemoryView::peek(NES, space, hovered);
+                const bool canWrite = MemoryView::writable(NES, space, hovered);
+                ImGui::SetTooltip("$%0*X = $%02X (%u)%s", digits, hovered, value, value,
+                                  canWrite ? "\nClick to edit" : "\nRead-only");
+                if (ImGui::IsItemClicked() && canWrite) {
+                    memoryEdit = (int)hovered;
+                    memoryEditText[0] = 0;
+                    memoryEditFocus = true;
+                }
+            }
+
+            if (memoryEdit >= (int)base && memoryEdit < (int)(base + COLUMNS)) {
+                // Two hex digits write the byte and move on to the next one
+                ImGui::SetCursorScreenPos(ImVec2(p.x + cellX(memoryEdit - (int)base), p.y));
+                ImGui::PushID(memoryEdit);
+                ImGui::PushStyleVar(ImGuiStyleVar_FramePadding, ImVec2(0, 0));
+                ImGui::SetNextItemWidth(2 * charWidth + 2);
+                if (memoryEditFocus) {
+                    ImGui::SetKeyboardFocusHere();
+                    memoryEditFocus = false;
+                }
+                char current[4];
+                std::snprintf(current, sizeof(current), "%02X", MemoryView::peek(NES, space, (uint32_t)memoryEdit));
+                const bool enter = ImGui::InputTextWithHint("##edit", current, memoryEditText, sizeof(memoryEditText),
+                                                            ImGuiInputTextFlags_CharsHexadecimal |
+                                                            ImGuiInputTextFlags_EnterReturnsTrue);
+                const bool done = enter || std::strlen(memoryEditText) == 2;
+                if (done && memoryEditText[0]) {
+                    const uint32_t addr = (uint32_t)memoryEdit;
+                    MemoryView::poke(NES, space, addr, (uint8_t)std::strtoul(memoryEditText, nullptr, 16));
+                    if (addr + 1 < size && MemoryView::writable(NES, space, addr + 1)) {
+                        memoryEdit = (int)addr + 1;
+                        memoryEditText[0] = 0;
+                        memoryEditFocus = true;
+                    } else {
+                        memoryEdit = -1;
+                    }
+                } else if (ImGui::IsItemDeactivated() || ImGui::IsKeyPressed(ImGuiKey_Escape)) {
+                    memoryEdit = -1;
+                }
+                ImGui::PopStyleVar();
+                ImGui::PopID();
+            }
+            ImGui::PopID();
+        }
+    }
+    clipper.End();
+
+    ImGui::EndChild();
+    ImGui::End();
+}
+
+void EmuApp::saveCheats()
+{
+    if (loadedRomPath.empty()) return;
+    const std::string path = Movie::PathFor(loadedRomPath, "cht");
+    if (!cheats.save(path)) cheatStatus = "Cannot write " + path;
+}
+
+void EmuApp::drawCheats()
+{
+    ImGui::Begin("Cheats");
+
+    ImGui::BeginDisabled(!NES.CART);
+    ImGui::SetNextItemWidth(120);
+    bool add = ImGui::InputTextWithHint("##code", "SXIOPO", cheatCode, sizeof(cheatCode),
+                                        ImGuiInputTextFlags_EnterReturnsTrue);
+    ImGui::SameLine();
+    ImGui::SetNextItemWidth(200);
+    add |= ImGui::InputTextWithHint("##name", "description", cheatName, sizeof(cheatName),
+                                    ImGuiInputTextFlags_EnterReturnsTrue);
+    ImGui::SameLine();
+    add |= ImGui::Button("Add");
+    ImGui::EndDisabled();
+
+    if (add && cheatCode[0]) {
+        std::string error;
+        if (cheats.add(cheatCode, cheatName, &error)) {
+            cheatCode[0] = 0;
+            cheatName[0] = 0;
+            cheatStatus.clear();
+            saveCheats();
+        } else {
+            cheatStatus = error;
+        }
+    }
+    ImGui::TextDisabled("Game Genie (6 or 8 letters) or AAAA:VV[:CC]");
+    if (!cheatStatus.empty()) ImGui::TextWrapped("%s", cheatStatus.c_str());
+
+    ImGui::Separator();
+
+    int removeAt = -1;
+    if (ImGui::BeginTable("##cheats", 5, ImGuiTableFlags_RowBg | ImGuiTableFlags_SizingFixedFit)) {
+        ImGui::TableSetupColumn("On");
+        ImGui::TableSetupColumn("Code");
+        ImGui::TableSetupColumn("Patch");
+        ImGui::TableSetupColumn("Name", ImGuiTableColumnFlags_WidthStretch);
+        ImGui::TableSetupColumn("");
+        ImGui::TableHeadersRow();
+
+        const std::vector<Cheats::Cheat>& list = cheats.list();
+        for (size_t i = 0; i < list.size(); i++) {
+            const Cheats::Cheat& c = list[i];
+            ImGui::PushID((int)i);
+            ImGui::TableNextRow();
+
+            ImGui::TableNextColumn();
+            bool on = c.enabled;
+            if (ImGui::Checkbox("##on", &on)) {
+                cheats.setEnabled(i, on);
+                saveCheats();
+            }
+            ImGui::TableNextColumn();
+            ImGui::TextUnformatted(c.code.c_str());
+            ImGui::TableNextColumn();
+            if (c.compare >= 0) ImGui::Text("$%04X = $%02X if $%02X", c.addr, c.value, c.compare);
+            else                ImGui::Text("$%04X = $%02X", c.addr, c.value);
+            ImGui::TableNextColumn();
+            ImGui::TextUnformatted(c.name.c_str());
+            ImGui::TableNextColumn();
+            if (ImGui::SmallButton("Remove")) removeAt = (int)i;
+
+            ImGui::PopID();
+        }
+        ImGui::EndTable();
+    }
+    if (removeAt >= 0) {
+        cheats.remove((size_t)removeAt);
+        saveCheats();
+    }
+
+    ImGui::End();
+}
+
+void EmuApp::drawLibrary()
+{
+    ImGui::Begin("ROM Library");
+
+    std::vector<std::string> roots = romLibrary.roots();
+    int removeRoot = -1;
+    for (size_t i = 0; i < roots.size(); i++) {
+        ImGui::PushID((int)i);
+        if (ImGui::SmallButton("Remove")) removeRoot = (int)i;
+        ImGui::SameLine();
+        ImGui::TextUnformatted(roots[i].c_str());
+        ImGui::PopID();
+    }
+
+    ImGui::SetNextItemWidth(300);
+    bool add = ImGui::InputTextWithHint("##folder", "folder with .nes files", libraryFolder, sizeof(libraryFolder),
+                                        ImGuiInputTextFlags_EnterReturnsTrue);
+    ImGui::SameLine();
+    add |= ImGui::Button("Add Folder");
+
+    bool rescan = false;
+    if (add && libraryFolder[0]) {
+        roots.push_back(libraryFolder);
+        libraryFolder[0] = 0;
+        rescan = true;
+    }
+    if (removeRoot >= 0) {
+        roots.erase(roots.begin() + removeRoot);
+        rescan = true;
+    }
+    if (rescan) {
+        romLibrary.setRoots(roots);
+        romLibrary.scan();
+    }
+
+    const bool scanning = romLibrary.scanning();
+    ImGui::BeginDisabled(roots.empty() && !scanning);
+    if (ImGui::Button(scanning ? "Cancel" : "Rescan")) {
+        if (scanning) romLibrary.cancel();
+        else          romLibrary.scan();
+    }
+    ImGui::EndDisabled();
+    ImGui::SameLine();
+    if (scanning)
+        ImGui::Text("Scanning: %zu files, %zu hashed", romLibrary.filesSeen(), romLibrary.filesHashed());
+    else
+        ImGui::Text("%zu ROMs (last scan %.0f ms)", romLibrary.size(), romLibrary.lastScanMs());
+
+    ImGui::Separator();
+
+    ImGui::SetNextItemWidth(200);
+    ImGui::InputTextWithHint("##search", "name or CRC-32", librarySearch, sizeof(librarySearch));
+    ImGui::SameLine();
+    ImGui::SetNextItemWidth(120);
+    const std::string mapperLabel = libraryMapper < 0 ? "Any mapper" : "Mapper " + std::to_string(libraryMapper);
+    if (ImGui::BeginCombo("##mapper", mapperLabel.c_str())) {
+        if (ImGui::Selectable("Any mapper", libraryMapper < 0)) libraryMapper = -1;
+        for (uint16_t m : romLibrary.mappers()) {
+            const std::string label = "Mapper " + std::to_string(m);
+            if (ImGui::Selectable(label.c_str(), libraryMapper == m)) libraryMapper = m;
+        }
+        ImGui::EndCombo();
+    }
+    ImGui::SameLine();
+    ImGui::Checkbox("Playable only", &libraryPlayable);
+
+    // Rows are only rebuilt when the index or the filter changes
+    RomLibrary::Filter filter;
+    filter.text = librarySearch;
+    filter.mapper = libraryMapper;
+    filter.playableOnly = libraryPlayable;
+    if (libraryRowsGeneration != romLibrary.generation() || filter.text != libraryRowsFilter.text ||
+        filter.mapper != libraryRowsFilter.mapper || filter.playableOnly != libraryRowsFilter.playableOnly) {
+        libraryRowsGeneration = romLibrary.generation();
+        libraryRowsFilter = filter;
+        libraryRows = romLibrary.search(filter);
+    }
+
+    if (!libraryStatus.empty()) ImGui::TextWrapped("%s", libraryStatus.c_str());
+
+    std::string load;
+    if (ImGui::BeginTable("##library", 7, ImGuiTableFlags_RowBg | ImGuiTableFlags_ScrollY | ImGuiTableFlags_Resizable)) {
+        ImGui::TableSetupScrollFreeze(0, 1);
+        ImGui::TableSetupColumn("Name", ImGuiTableColumnFlags_WidthStretch);
+        ImGui::TableSetupColumn("Mapper");
+        ImGui::TableSetupColumn("PRG");
+        ImGui::TableSetupColumn("CHR");
+        ImGui::TableSetupColumn("Mirroring");
+        ImGui::TableSetupColumn("Battery");
+        ImGui::TableSetupColumn("CRC-32");
+        ImGui::TableHeadersRow();
+
+        static const char* const mirrorNames[] = { "Horizontal", "Vertical", "Four-screen" };
+        static const char* const regionNames[] = { "NTSC", "PAL", "Multi-region", "Dendy" };
+
+        ImGuiListClipper clipper;
+        clipper.Begin((int)libraryRows.size());
+        while (clipper.Step()) {
+            for (int row = clipper.DisplayStart; row < clipper.DisplayEnd; row++) {
+                const RomLibrary::Entry& e = libraryRows[(size_t)row];
+                const cartridge::Header& h = e.header;
+                ImGui::PushID(row);
+                ImGui::TableNextRow();
+
+                // Unsupported mappers and broken headers are listed but dimmed
+                const bool playable = e.playable();
+                if (!playable) ImGui::PushStyleColor(ImGuiCol_Text, ImGui::GetStyle().Colors[ImGuiCol_TextDisabled]);
+
+                ImGui::TableNextColumn();
+                if (ImGui::Selectable(e.name().c_str(), e.path == loadedRomPath,
+                                      ImGuiSelectableFlags_SpanAllColumns | ImGuiSelectableFlags_AllowDoubleClick) &&
+                    ImGui::IsMouseDoubleClicked(ImGuiMouseButton_Left))
+                    load = e.path;
+                if (ImGui::IsItemHovered()) {
+                    ImGui::BeginTooltip();
+                    ImGui::TextUnformatted(e.path.c_str());
+                    char sha[41];
+                    for (size_t i = 0; i < e.sha1.size(); i++) std::snprintf(sha + i * 2, 3, "%02x", e.sha1[i]);
+                    ImGui::Text("SHA-1 %s", sha);
+                    if (e.headerOk) {
+                        ImGui::Text("%s, submapper %u, %s", h.nes20 ? "NES 2.0" : "iNES", h.submapper, regionNames[(int)h.region]);
+                        ImGui::Text("PRG-RAM %u + %u NV bytes, CHR-RAM %u + %u NV bytes",
+                                    h.prgRamSize, h.prgNvramSize, h.chrRamSize, h.chrNvramSize);
+                    } else {
+                        ImGui::TextUnformatted("No iNES header");
+                    }
+                    ImGui::EndTooltip();
+                }
+
+                ImGui::TableNextColumn();
+                if (e.headerOk) ImGui::Text("%u", h.mapper);
+                ImGui::TableNextColumn();
+                if (e.headerOk) ImGui::Text("%u KB", h.prgRomSize / 1024);
+                ImGui::TableNextColumn();
+                if (e.headerOk) {
+                    if (h.chrRomSize) ImGui::Text("%u KB", h.chrRomSize / 1024);
+                    else              ImGui::TextUnformatted("RAM");
+                }
+                ImGui::TableNextColumn();
+                if (e.headerOk) ImGui::TextUnformatted(mirrorNames[(int)h.mirror]);
+                ImGui::TableNextColumn();
+                if (e.headerOk && h.battery) ImGui::TextUnformatted("Yes");
+                ImGui::TableNextColumn();
+                ImGui::Text("%08X", e.crc32);
+
+                if (!playable) ImGui::PopStyleColor();
+                ImGui::PopID();
+            }
+        }
+        ImGui::EndTable();
+    }
+
+    if (!load.empty()) {
+        if (loadRom(load)) {
+            running = false;
+            libraryStatus.clear();
+        } else {
+            libraryStatus = "Cannot load " + load;
+        }
+    }
+
+    ImGui::End();
+}
@@ -0,0 +1,144 @@
+#include "header/ForkPool.h"
+#include "header/nes.h"
+
+struct ForkPool::Shared {
+    std::mutex mutex;
+
+    // Fork point
+    std::shared_ptr<const RomImage> image;
+    std::shared_ptr<const std::vector<uint8_t>> snapshot;
+    bool fingerprint = false;
+    size_t childBytes = 0;
+
+    std::vector<std::unique_ptr<nes>> idle;
+    size_t live = 0;
+};
+
+// Debugger tools a caller attached to a child must not follow it into the
+// next fork
+static void detachHooks(nes& n)
+{
+    n.BUS.trapPages.fill(0);
+    n.BUS.watchpoints = nullptr;
+    n.BUS.cheats = nullptr;
+    n.BUS.cdl = nullptr;
+    n.BUS.events = nullptr;
+    n.BUS.breakRequested = false;
+    n.PPU.cdl = nullptr;
+    n.PPU.events = nullptr;
+    if (n.CART) n.CART->cdl = nullptr;
+    n.CPU.trace = nullptr;
+    n.CPU.profiler = nullptr;
+}
+
+ForkPool::ForkPool() : m_shared(std::make_shared<Shared>())
+{
+}
+
+ForkPool::~ForkPool() = default;
+
+bool ForkPool::setParent(const nes& parent)
+{
+    if (!parent.CART || !parent.CART->image) return false;
+
+    auto snapshot = std::make_shared<std::vector<uint8_t>>(parent.stateSize());
+    if (parent.saveState(snapshot->data(), snapshot->size()) == 0) return false;
+
+    std::lock_guard<std::mutex> lock(m_shared->mutex);
+    m_shared->image = parent.CART->image;
+    m_shared->snapshot = std::move(snapshot);
+    m_shared->fingerprint = parent.fingerprinting();
+    m_shared->childBytes = parent.instanceBytes();
+    return true;
+}
+
+void ForkPool::reserve(size_t children)
+{
+    std::shared_ptr<const RomImage> image;
+    size_t have = 0;
+    {
+        std::lock_guard<std::mutex> lock(m_shared->mutex);
+        image = m_shared->image;
+        have = m_shared->idle.size();
+    }
+
+    std::vector<std::unique_ptr<nes>> made;
+    for (size_t i = have; i < children; i++) {
+        auto n = std::make_unique<nes>();
+        n->APU.setOutputEnabled(false);
+        if (image) n->loadRom(image);
+        made.push_back(std::move(n));
+    }
+
+    std::lock_guard<std::mutex> lock(m_shared->mutex);
+    for (auto& n : made) m_shared->idle.push_back(std::move(n));
+}
+
+std::shared_ptr<nes> ForkPool::fork()
+{
+    std::unique_ptr<nes> n;
+    std::shared_ptr<const RomImage> image;
+    std::shared_ptr<const std::vector<uint8_t>> snapshot;
+    bool fingerprint = false;
+    {
+        std::lock_guard<std::mutex> lock(m_shared->mutex);
+        if (!m_shared->snapshot) return nullptr;
+
+        image = m_shared->image;
+        snapshot = m_shared->snapshot;
+        fingerprint = m_shared->fingerprint;
+
+        if (!m_shared->idle.empty()) {
+            n = std::move(m_shared->idle.back());
+            m_shared->idle.pop_back();
+        }
+        m_shared->live++;
+    }
+
+    if (!n) {
+        n = std::make_unique<nes>();
+        n->APU.setOutputEnabled(false);
+    }
+
+    // Recycled instances may still hold the cartridge of an older fork point
+    bool ok = (n->CART && n->CART->image == image) || n->loadRom(image);
+    if (ok) {
+        n->setFingerprinting(fingerprint);
+        ok = n->loadState(snapshot->data(), snapshot->size());
+    }
+
+    if (!ok) {
+        std::lock_guard<std::mutex> lock(m_shared->mutex);
+        m_shared->live--;
+        return nullptr;
+    }
+
+    // The child comes back to the pool when its last reference goes, or is
+    // simply deleted if the pool is gone by then
+    std::weak_ptr<Shared> pool = m_shared;
+    return std::shared_ptr<nes>(n.release(), [pool](nes* child) {
+        std::shared_ptr<Shared> s = pool.lock();
+        if (!s) {
+            delete child;
+            return;
+        }
+        detachHooks(*child);
+        std::lock_guard<std::mutex> lock(s->mutex);
+        s->live--;
+        s->idle.emplace_back(child);
+    });
+}
+
+ForkPool::MemoryReport ForkPool::memory() const
+{
+    std::lock_guard<std::mutex> lock(m_shared->mutex);
+
+    MemoryReport r;
+    r.romBytes = m_shared->image ? m_shared->image->size() : 0;
+    r.snapshotBytes = m_shared->snapshot ? m_shared->snapshot->size() : 0;
+    r.childBytes = m_shared->childBytes;
+    r.childStateBytes = r.snapshotBytes;
+    r.liveChildren = m_shared->live;
+    r.pooledChildren = m_shared->idle.size();
+    return r;
+}
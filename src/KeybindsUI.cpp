@@ -67,6 +67,9 @@ bool DrawPopup(Keybinds& binds, bool& openPopup)
         Row("Run/Pause", binds.runGame);
         Row("Reset", binds.resetGame);
         Row("Step Game", binds.stepGame);
+        Row("Save State", binds.saveState);
+        Row("Load State", binds.loadState);
+        Row("Rewind (hold)", binds.rewind);
 
         if (g_rebindingTarget) {
             ImGuiKey pressed = CaptureAnyPressedKey();
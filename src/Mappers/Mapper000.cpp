@@ -1,6 +1,6 @@
-#include "mapper000.h"
+#include "Mapper000.h"
 
-Mapper000::Mapper000(uint8_t prgBanks, uint8_t chrBanks)
+Mapper000::Mapper000(uint16_t prgBanks, uint16_t chrBanks)
     : Mapper(prgBanks, chrBanks) {}
 
 
@@ -5,7 +5,7 @@
 
 class Mapper000 : public Mapper {
 public:
-    Mapper000(uint8_t prgBanks, uint8_t chrBanks);
+    Mapper000(uint16_t prgBanks, uint16_t chrBanks);
     ~Mapper000() override = default;
 
     bool cpuMapRead(uint16_t addr, uint32_t& mappedAddr) override;
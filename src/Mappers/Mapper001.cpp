@@ -1,6 +1,7 @@
 #include "Mapper001.h"
+#include "savestate.h"
 
-Mapper001::Mapper001(uint8_t prgBanks_, uint8_t chrBanks_)
+Mapper001::Mapper001(uint16_t prgBanks_, uint16_t chrBanks_)
     : Mapper(prgBanks_, chrBanks_) {
 
     // Power-on defaults (common behavior expected by many games)
@@ -162,4 +163,20 @@ bool Mapper001::ppuMapWrite(uint16_t addr, uint32_t& mappedAddr) {
     }
 
     return false;
-}
\ No newline at end of file
+}
+
+void Mapper001::saveState(StateWriter& w) const {
+    w.pod(shiftReg);
+    w.pod(control);
+    w.pod(chrBank0);
+    w.pod(chrBank1);
+    w.pod(prgBank);
+}
+
+void Mapper001::loadState(StateReader& r) {
+    r.pod(shiftReg);
+    r.pod(control);
+    r.pod(chrBank0);
+    r.pod(chrBank1);
+    r.pod(prgBank);
+}
@@ -1,10 +1,10 @@
 #pragma once
-#include "Mapper.h"
+#include "mapper.h"
 #include <cstdint>
 
 class Mapper001 : public Mapper {
 public:
-    Mapper001(uint8_t prgBanks, uint8_t chrBanks);
+    Mapper001(uint16_t prgBanks, uint16_t chrBanks);
 
     bool cpuMapRead(uint16_t addr, uint32_t& mappedAddr) override;
     bool cpuMapWrite(uint16_t addr, uint32_t& mappedAddr, uint8_t data) override;
@@ -14,6 +14,9 @@ public:
 
     uint8_t getControl() const { return control; }
 
+    void saveState(StateWriter& w) const override;
+    void loadState(StateReader& r) override;
+
     // Optional: expose mirroring bits if you want cart->mirror updated dynamically
     // uint8_t getMirrorMode() const { return control & 0x03; }
 
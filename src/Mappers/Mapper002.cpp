@@ -1,6 +1,7 @@
-#include "mapper002.h"
+#include "Mapper002.h"
+#include "savestate.h"
 
-Mapper002::Mapper002(uint8_t prgBanks, uint8_t chrBanks)
+Mapper002::Mapper002(uint16_t prgBanks, uint16_t chrBanks)
     : Mapper(prgBanks, chrBanks) {}
 
 bool Mapper002::cpuMapRead(uint16_t addr, uint32_t& mappedAddr) {
@@ -49,3 +50,11 @@ bool Mapper002::ppuMapWrite(uint16_t addr, uint32_t& mappedAddr) {
     }
     return false;
 }
+
+void Mapper002::saveState(StateWriter& w) const {
+    w.pod(prgBankSelect);
+}
+
+void Mapper002::loadState(StateReader& r) {
+    r.pod(prgBankSelect);
+}
@@ -5,7 +5,7 @@
 
 class Mapper002 : public Mapper {
 public:
-    Mapper002(uint8_t prgBanks, uint8_t chrBanks);
+    Mapper002(uint16_t prgBanks, uint16_t chrBanks);
     ~Mapper002() override = default;
 
     bool cpuMapRead(uint16_t addr, uint32_t& mappedAddr) override;
@@ -14,6 +14,9 @@ public:
     bool ppuMapRead(uint16_t addr, uint32_t& mappedAddr) override;
     bool ppuMapWrite(uint16_t addr, uint32_t& mappedAddr) override;
 
+    void saveState(StateWriter& w) const override;
+    void loadState(StateReader& r) override;
+
 private:
     uint8_t prgBankSelect = 0; // 16KB bank at $8000-$BFFF
 };
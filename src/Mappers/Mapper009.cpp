@@ -1,7 +1,8 @@
 // mapper009.cpp
-#include "mapper009.h"
+#include "Mapper009.h"
+#include "savestate.h"
 
-Mapper009::Mapper009(uint8_t prgBanks, uint8_t chrBanks)
+Mapper009::Mapper009(uint16_t prgBanks, uint16_t chrBanks)
     : Mapper(prgBanks, chrBanks) {
     // both latches start at FD
     latch0 = 0; // FD
@@ -76,6 +77,13 @@ bool Mapper009::cpuMapWrite(uint16_t addr, uint32_t& mappedAddr, uint8_t data) {
 
 // PPU READ mapping
 bool Mapper009::ppuMapRead(uint16_t addr, uint32_t& mappedAddr) {
+    if (!ppuMapPeek(addr, mappedAddr)) return false;
+
+    updateLatchesAfterRead(addr);
+    return true;
+}
+
+bool Mapper009::ppuMapPeek(uint16_t addr, uint32_t& mappedAddr) {
     if (addr >= 0x2000) return false;
 
     const uint32_t chrCount4k = chr4kCount();
@@ -88,8 +96,6 @@ bool Mapper009::ppuMapRead(uint16_t addr, uint32_t& mappedAddr) {
         uint8_t bank = (latch1 == 0) ? chrFD_1000 : chrFE_1000;
         mappedAddr = mapChr4k((uint8_t)(bank % chrCount4k), addr - 0x1000);
     }
-
-    updateLatchesAfterRead(addr);
     return true;
 }
 
@@ -115,3 +121,27 @@ void Mapper009::updateLatchesAfterRead(uint16_t addr) {
     else if (addr >= 0x1FD8 && addr <= 0x1FDF) latch1 = 0;   // FD
     else if (addr >= 0x1FE8 && addr <= 0x1FEF) latch1 = 1;   // FE
 }
+
+void Mapper009::saveState(StateWriter& w) const {
+    w.pod(prgBank8000);
+    w.pod(chrFD_0000);
+    w.pod(chrFE_0000);
+    w.pod(chrFD_1000);
+    w.pod(chrFE_1000);
+    w.pod(latch0);
+    w.pod(latch1);
+    w.pod(mirroringOverrideValid);
+    w.pod(mirroringHorizontal);
+}
+
+void Mapper009::loadState(StateReader& r) {
+    r.pod(prgBank8000);
+    r.pod(chrFD_0000);
+    r.pod(chrFE_0000);
+    r.pod(chrFD_1000);
+    r.pod(chrFE_1000);
+    r.pod(latch0);
+    r.pod(latch1);
+    r.pod(mirroringOverrideValid);
+    r.pod(mirroringHorizontal);
+}
@@ -5,13 +5,14 @@
 
 class Mapper009 : public Mapper {
 public:
-    Mapper009(uint8_t prgBanks, uint8_t chrBanks);
+    Mapper009(uint16_t prgBanks, uint16_t chrBanks);
 
     bool cpuMapRead(uint16_t addr, uint32_t& mappedAddr) override;
     bool cpuMapWrite(uint16_t addr, uint32_t& mappedAddr, uint8_t data) override;
 
     bool ppuMapRead(uint16_t addr, uint32_t& mappedAddr) override;
     bool ppuMapWrite(uint16_t addr, uint32_t& mappedAddr) override;
+    bool ppuMapPeek(uint16_t addr, uint32_t& mappedAddr) override;
 
     // Optional helper so cartridge can query mirroring override after mapper writes.
     bool hasMirroringOverride() const { return mirroringOverrideValid; }
@@ -20,6 +21,9 @@ public:
     uint32_t prg8kCount() const { return (uint32_t)prgBanks * 2u; }   // 16KB -> 8KB
     uint32_t chr4kCount() const { return (uint32_t)chrBanks * 2u; }   // 8KB  -> 4KB
 
+    void saveState(StateWriter& w) const override;
+    void loadState(StateReader& r) override;
+
 
 private:
     // PRG
@@ -0,0 +1,401 @@
+#include "header/Movie.h"
+#include "header/nes.h"
+#include "header/hash.h"
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <sstream>
+
+namespace {
+
+constexpr uint32_t MOVIE_VERSION = 1;
+
+// FM2 button order, leftmost character first; character i is controller bit 7 - i
+const char FM2_BUTTONS[] = "RLDUTSBA";
+
+void putVarint(std::vector<uint8_t>& out, size_t v)
+{
+    while (v >= 0x80) {
+        out.push_back((uint8_t)(v | 0x80));
+        v >>= 7;
+    }
+    out.push_back((uint8_t)v);
+}
+
+bool getVarint(const std::vector<uint8_t>& in, size_t& pos, size_t& v)
+{
+    v = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+        if (pos >= in.size()) return false;
+        uint8_t b = in[pos++];
+        v |= (size_t)(b & 0x7F) << shift;
+        if (!(b & 0x80)) return true;
+    }
+    return false;
+}
+
+template <typename T>
+void putPod(std::vector<uint8_t>& out, const T& v)
+{
+    const uint8_t* p = reinterpret_cast<const uint8_t*>(&v);
+    out.insert(out.end(), p, p + sizeof(T));
+}
+
+template <typename T>
+bool getPod(const std::vector<uint8_t>& in, size_t& pos, T& v)
+{
+    if (sizeof(T) > in.size() - pos) return false;
+    std::memcpy(&v, in.data() + pos, sizeof(T));
+    pos += sizeof(T);
+    return true;
+}
+
+bool sameFrame(const Movie::Frame& a, const Movie::Frame& b)
+{
+    return a.pad[0] == b.pad[0] && a.pad[1] == b.pad[1] && a.flags == b.flags;
+}
+
+uint8_t parseFM2Pad(const std::string& s)
+{
+    uint8_t state = 0x00;
+    for (size_t i = 0; i < 8 && i < s.size(); i++)
+        if (s[i] != '.' && s[i] != ' ') state |= (uint8_t)(1 << (7 - i));
+    return state;
+}
+
+std::string formatFM2Pad(uint8_t state)
+{
+    std::string s(8, '.');
+    for (int i = 0; i < 8; i++)
+        if (state & (1 << (7 - i))) s[i] = FM2_BUTTONS[i];
+    return s;
+}
+
+} // namespace
+
+void Movie::clear()
+{
+    m_mode = Mode::Idle;
+    m_anchor = Anchor::PowerOn;
+    m_romCrc = 0;
+    m_endHash = 0;
+    m_state.clear();
+    m_frames.clear();
+    m_cursor = 0;
+}
+
+uint64_t Movie::StateHash(const nes& n)
+{
+    std::vector<uint8_t> buf(n.stateSize());
+    size_t size = n.saveState(buf.data(), buf.size());
+    return Hash::Hash64(buf.data(), size);
+}
+
+uint64_t Movie::contentHash() const
+{
+    uint64_t h = Hash::Hash64(m_state.data(), m_state.size(), ((uint64_t)m_anchor << 32) | m_romCrc);
+    static_assert(sizeof(Frame) == 3, "frames are hashed as raw bytes");
+    return Hash::Hash64(reinterpret_cast<const uint8_t*>(m_frames.data()), m_frames.size() * sizeof(Frame), h);
+}
+
+uint64_t Movie::prefixHash(size_t frames) const
+{
+    return PrefixHash(m_anchor, m_state, m_frames.data(), std::min(frames, m_frames.size()));
+}
+
+uint64_t Movie::PrefixHash(Anchor anchor, const std::vector<uint8_t>& state, const Frame* frames, size_t count)
+{
+    uint64_t h = Hash::Hash64(state.data(), state.size(), ((uint64_t)anchor << 32) | count);
+    return Hash::Hash64(reinterpret_cast<const uint8_t*>(frames), count * sizeof(Frame), h);
+}
+
+uint32_t Movie::RomCrc(const cartridge& c)
+{
+    return c.romCrc;
+}
+
+std::string Movie::PathFor(const std::string& romPath, const char* ext)
+{
+    std::string base = romPath;
+    size_t dot = base.find_last_of('.');
+    size_t sep = base.find_last_of("/\\");
+    if (dot != std::string::npos && (sep == std::string::npos || dot > sep))
+        base.resize(dot);
+
+    return base + "." + ext;
+}
+
+bool Movie::startRecording(nes& n, Anchor anchor)
+{
+    if (!n.CART) return false;
+
+    clear();
+    m_anchor = anchor;
+    m_romCrc = RomCrc(*n.CART);
+
+    if (anchor == Anchor::PowerOn) {
+        n.powerOn();
+    } else {
+        m_state.resize(n.stateSize());
+        if (n.saveState(m_state.data(), m_state.size()) == 0) {
+            clear();
+            return false;
+        }
+    }
+
+    m_mode = Mode::Recording;
+    return true;
+}
+
+bool Movie::startPlayback(nes& n)
+{
+    if (!n.CART) return false;
+
+    if (m_romCrc != 0 && m_romCrc != RomCrc(*n.CART)) {
+        std::cout << "Movie was recorded with a different ROM\n";
+        return false;
+    }
+
+    if (m_anchor == Anchor::PowerOn) {
+        n.powerOn();
+    } else if (!n.loadState(m_state.data(), m_state.size())) {
+        std::cout << "Movie anchor state rejected\n";
+        return false;
+    }
+
+    m_cursor = 0;
+    m_mode = Mode::Playing;
+    return true;
+}
+
+bool Movie::resumeAt(size_t frame)
+{
+    if (m_mode == Mode::Recording || frame > m_frames.size()) return false;
+
+    m_cursor = frame;
+    m_mode = Mode::Playing;
+    return true;
+}
+
+void Movie::stop(const nes& n)
+{
+    if (m_mode == Mode::Recording)
+        m_endHash = StateHash(n);
+    m_mode = Mode::Idle;
+}
+
+bool Movie::step(nes& n, uint8_t flags)
+{
+    Frame f;
+
+    if (m_mode == Mode::Recording) {
+        f.pad[0] = n.BUS.controller[0];
+        f.pad[1] = n.BUS.controller[1];
+        f.flags = flags;
+        m_frames.push_back(f);
+        m_endHash = 0;
+    } else if (m_mode == Mode::Playing) {
+        if (m_cursor >= m_frames.size()) {
+            stop(n);
+            return false;
+        }
+        f = m_frames[m_cursor++];
+    } else {
+        n.runFrame();
+        return true;
+    }
+
+    if (f.flags & FRAME_POWER) n.powerOn();
+    else if (f.flags & FRAME_RESET) n.reset();
+
+    n.BUS.setControllerState(0, f.pad[0]);
+    n.BUS.setControllerState(1, f.pad[1]);
+    n.runFrame();
+    return true;
+}
+
+bool Movie::replay(nes& n)
+{
+    if (!startPlayback(n)) return false;
+
+    while (step(n)) {}
+
+    return m_endHash == 0 || StateHash(n) == m_endHash;
+}
+
+// ---- native file ----
+// "NESM" u32 version, u8 anchor, u32 rom crc, u64 end hash, u32 frame count,
+// u32 state size + state, then runs of [varint repeat, pad0, pad1, flags]
+
+bool Movie::saveFile(const std::string& path) const
+{
+    std::vector<uint8_t> out;
+    out.insert(out.end(), { 'N', 'E', 'S', 'M' });
+    putPod(out, MOVIE_VERSION);
+    putPod(out, (uint8_t)m_anchor);
+    putPod(out, m_romCrc);
+    putPod(out, m_endHash);
+    putPod(out, (uint32_t)m_frames.size());
+    putPod(out, (uint32_t)m_state.size());
+    out.insert(out.end(), m_state.begin(), m_state.end());
+
+    for (size_t i = 0; i < m_frames.size();) {
+        size_t run = 1;
+        while (i + run < m_frames.size() && sameFrame(m_frames[i + run], m_frames[i])) run++;
+
+        putVarint(out, run);
+        out.push_back(m_frames[i].pad[0]);
+        out.push_back(m_frames[i].pad[1]);
+        out.push_back(m_frames[i].flags);
+        i += run;
+    }
+
+    std::ofstream ofs(path, std::ofstream::binary);
+    if (!ofs.is_open()) {
+        std::cout << "Movie open failed: " << path << "\n";
+        return false;
+    }
+
+    ofs.write(reinterpret_cast<const char*>(out.data()), (std::streamsize)out.size());
+    return ofs.good();
+}
+
+bool Movie::loadFile(const std::string& path)
+{
+    std::ifstream ifs(path, std::ifstream::binary);
+    if (!ifs.is_open()) {
+        std::cout << "Movie open failed: " << path << "\n";
+        return false;
+    }
+
+    std::vector<uint8_t> in((std::istreambuf_iterator<char>(ifs)), std::istreambuf_iterator<char>());
+
+    size_t pos = 4;
+    uint32_t version = 0;
+    uint8_t anchor = 0;
+    uint32_t frameCount = 0;
+    uint32_t stateSize = 0;
+
+    clear();
+
+    if (in.size() < 4 || std::memcmp(in.data(), "NESM", 4) != 0 ||
+        !getPod(in, pos, version) || version != MOVIE_VERSION ||
+        !getPod(in, pos, anchor) || anchor > (uint8_t)Anchor::SaveState ||
+        !getPod(in, pos, m_romCrc) || !getPod(in, pos, m_endHash) ||
+        !getPod(in, pos, frameCount) || !getPod(in, pos, stateSize) ||
+        stateSize > in.size() - pos) {
+        std::cout << "Movie rejected: " << path << "\n";
+        clear();
+        return false;
+    }
+
+    m_anchor = (Anchor)anchor;
+    m_state.assign(in.begin() + pos, in.begin() + pos + stateSize);
+    pos += stateSize;
+
+    m_frames.reserve(frameCount);
+    while (pos < in.size() && m_frames.size() < frameCount) {
+        size_t run = 0;
+        if (!getVarint(in, pos, run) || in.size() - pos < 3 || run > frameCount - m_frames.size())
+            break;
+
+        Frame f;
+        f.pad[0] = in[pos++];
+        f.pad[1] = in[pos++];
+        f.flags = in[pos++];
+        m_frames.insert(m_frames.end(), run, f);
+    }
+
+    if (m_frames.size() != frameCount) {
+        std::cout << "Movie truncated: " << path << "\n";
+        clear();
+        return false;
+    }
+    return true;
+}
+
+// ---- FM2 ----
+
+bool Movie::importFM2(const std::string& path)
+{
+    std::ifstream ifs(path);
+    if (!ifs.is_open()) {
+        std::cout << "Movie open failed: " << path << "\n";
+        return false;
+    }
+
+    clear();
+
+    std::string line;
+    while (std::getline(ifs, line)) {
+        if (!line.empty() && line.back() == '\r') line.pop_back();
+        if (line.empty()) continue;
+
+        if (line[0] != '|') {
+            std::istringstream kv(line);
+            std::string key;
+            kv >> key;
+            if (key == "savestate") {
+                std::cout << "FM2 movies that start from a save state are not supported\n";
+                clear();
+                return false;
+            }
+            continue;
+        }
+
+        // |commands|port0|port1|port2|
+        std::vector<std::string> fields;
+        size_t start = 1;
+        for (size_t bar = line.find('|', start); bar != std::string::npos; bar = line.find('|', start)) {
+            fields.push_back(line.substr(start, bar - start));
+            start = bar + 1;
+        }
+        if (fields.size() < 3) continue;
+
+        Frame f;
+        int cmd = std::atoi(fields[0].c_str());
+        if (cmd & 0x01) f.flags |= FRAME_RESET;
+        if (cmd & 0x02) f.flags |= FRAME_POWER;
+        f.pad[0] = parseFM2Pad(fields[1]);
+        f.pad[1] = parseFM2Pad(fields[2]);
+        m_frames.push_back(f);
+    }
+
+    return true;
+}
+
+bool Movie::exportFM2(const std::string& path, const std::string& romName) const
+{
+    if (m_anchor != Anchor::PowerOn) {
+        std::cout << "Only power-on movies can be exported to FM2\n";
+        return false;
+    }
+
+    std::ofstream ofs(path);
+    if (!ofs.is_open()) {
+        std::cout << "Movie open failed: " << path << "\n";
+        return false;
+    }
+
+    ofs << "version 3\n";
+    ofs << "emuVersion 22020\n";
+    ofs << "rerecordCount 0\n";
+    ofs << "palFlag 0\n";
+    ofs << "romFilename " << romName << "\n";
+    ofs << "fourscore 0\n";
+    ofs << "port0 1\n";
+    ofs << "port1 1\n";
+    ofs << "port2 0\n";
+
+    for (const Frame& f : m_frames) {
+        int cmd = 0;
+        if (f.flags & FRAME_RESET) cmd |= 0x01;
+        if (f.flags & FRAME_POWER) cmd |= 0x02;
+        ofs << '|' << cmd << '|' << formatFM2Pad(f.pad[0]) << '|' << formatFM2Pad(f.pad[1]) << "||\n";
+    }
+
+    return ofs.good();
+}
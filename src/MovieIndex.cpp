@@ -0,0 +1,287 @@
+#include "header/MovieIndex.h"
+#include "header/Movie.h"
+#include "header/nes.h"
+#include "header/statecodec.h"
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+
+namespace {
+
+constexpr uint32_t INDEX_VERSION = 1;
+constexpr int START_INTERVAL = 60;
+
+template <typename T>
+void putPod(std::vector<uint8_t>& out, const T& v)
+{
+    const uint8_t* p = reinterpret_cast<const uint8_t*>(&v);
+    out.insert(out.end(), p, p + sizeof(T));
+}
+
+template <typename T>
+bool getPod(const std::vector<uint8_t>& in, size_t& pos, T& v)
+{
+    if (sizeof(T) > in.size() - pos) return false;
+    std::memcpy(&v, in.data() + pos, sizeof(T));
+    pos += sizeof(T);
+    return true;
+}
+
+} // namespace
+
+MovieIndex::~MovieIndex()
+{
+    cancel();
+}
+
+void MovieIndex::cancel()
+{
+    m_cancel = true;
+    if (m_thread.joinable()) m_thread.join();
+    m_cancel = false;
+}
+
+void MovieIndex::clear()
+{
+    cancel();
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_keys.clear();
+    m_movieHash = 0;
+    m_total = 0;
+    m_stateSize = 0;
+    m_used = 0;
+    m_interval = START_INTERVAL;
+    m_done = 0;
+}
+
+void MovieIndex::build(const Movie& movie, std::shared_ptr<const RomImage> rom)
+{
+    clear();
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_movieHash = movie.contentHash();
+        m_total = movie.frameCount();
+    }
+
+    m_building = true;
+    m_thread = std::thread(&MovieIndex::worker, this, movie, std::move(rom));
+}
+
+void MovieIndex::worker(Movie movie, std::shared_ptr<const RomImage> rom)
+{
+    nes n;
+    if (!n.loadRom(std::move(rom)) || !movie.startPlayback(n)) {
+        m_building = false;
+        return;
+    }
+    n.APU.setOutputEnabled(false);
+
+    std::vector<uint8_t> raw(n.stateSize());
+
+    for (;;) {
+        size_t frame = movie.cursor();
+        m_done = frame;
+
+        int interval;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            interval = m_interval;
+        }
+
+        if (frame % (size_t)interval == 0) {
+            Keyframe k;
+            k.frame = (uint32_t)frame;
+
+            size_t size = n.saveState(raw.data(), raw.size());
+            if (size == 0) break;
+            StateCodec::Compress(raw.data(), size, k.data);
+            k.data.shrink_to_fit();
+
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_stateSize = size;
+            m_used += k.data.size();
+            m_keys.push_back(std::move(k));
+            thin();
+        }
+
+        if (m_cancel || !movie.step(n)) break;
+    }
+
+    m_building = false;
+}
+
+// Halves the keyframe density until the index fits the budget.
+// Frame 0 is always kept, so a seek never has to fall back to the anchor.
+void MovieIndex::thin()
+{
+    while (m_used > m_budget && m_keys.size() > 1) {
+        m_interval *= 2;
+
+        size_t out = 0;
+        for (size_t i = 0; i < m_keys.size(); i++) {
+            if (m_keys[i].frame % (uint32_t)m_interval != 0)
+                m_used -= m_keys[i].data.size();
+            else if (out++ != i)
+                m_keys[out - 1] = std::move(m_keys[i]);
+        }
+        m_keys.resize(out);
+    }
+}
+
+bool MovieIndex::seek(nes& n, Movie& movie, size_t frame)
+{
+    if (frame > movie.frameCount() || movie.mode() == Movie::Mode::Recording)
+        return false;
+
+    bool restored = false;
+    size_t from = 0;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        if (m_movieHash == movie.contentHash()) {
+            // Last keyframe at or before the target
+            const Keyframe* best = nullptr;
+            for (const Keyframe& k : m_keys) {
+                if (k.frame > frame) break;
+                best = &k;
+            }
+
+            // Already playing and closer than any keyframe: just keep going
+            bool closer = movie.mode() == Movie::Mode::Playing && movie.cursor() <= frame &&
+                          (!best || movie.cursor() >= best->frame);
+
+            if (best && !closer) {
+                m_restore.resize(m_stateSize);
+                restored = StateCodec::Decompress(best->data.data(), best->data.size(),
+                                                  m_restore.data(), m_restore.size()) &&
+                           n.loadState(m_restore.data(), m_restore.size());
+                from = best->frame;
+            }
+        }
+    }
+
+    if (restored) {
+        movie.resumeAt(from);
+    } else if (movie.mode() != Movie::Mode::Playing || movie.cursor() > frame) {
+        if (!movie.startPlayback(n)) return false;
+    }
+
+    while (movie.cursor() < frame && movie.step(n)) {}
+    return movie.cursor() == frame;
+}
+
+bool MovieIndex::matches(const Movie& movie) const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return !m_keys.empty() && m_movieHash == movie.contentHash();
+}
+
+float MovieIndex::progress() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_total == 0 ? 0.0f : (float)m_done / (float)m_total;
+}
+
+size_t MovieIndex::keyframeCount() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_keys.size();
+}
+
+size_t MovieIndex::usedBytes() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_used;
+}
+
+int MovieIndex::interval() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_interval;
+}
+
+// ---- sidecar file ----
+// "NESI" u32 version, u64 movie hash, u32 state size, u32 interval, u32 count,
+// then per keyframe: u32 frame, u32 length, RLE bytes
+
+bool MovieIndex::saveFile(const std::string& path) const
+{
+    std::vector<uint8_t> out;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_keys.empty()) return false;
+
+        out.insert(out.end(), { 'N', 'E', 'S', 'I' });
+        putPod(out, INDEX_VERSION);
+        putPod(out, m_movieHash);
+        putPod(out, (uint32_t)m_stateSize);
+        putPod(out, (uint32_t)m_interval);
+        putPod(out, (uint32_t)m_keys.size());
+        for (const Keyframe& k : m_keys) {
+            putPod(out, k.frame);
+            putPod(out, (uint32_t)k.data.size());
+            out.insert(out.end(), k.data.begin(), k.data.end());
+        }
+    }
+
+    std::ofstream ofs(path, std::ofstream::binary);
+    if (!ofs.is_open()) {
+        std::cout << "Movie index open failed: " << path << "\n";
+        return false;
+    }
+
+    ofs.write(reinterpret_cast<const char*>(out.data()), (std::streamsize)out.size());
+    return ofs.good();
+}
+
+bool MovieIndex::loadFile(const std::string& path, const Movie& movie)
+{
+    std::ifstream ifs(path, std::ifstream::binary);
+    if (!ifs.is_open()) return false;
+
+    std::vector<uint8_t> in((std::istreambuf_iterator<char>(ifs)), std::istreambuf_iterator<char>());
+
+    size_t pos = 4;
+    uint32_t version = 0, stateSize = 0, interval = 0, count = 0;
+    uint64_t movieHash = 0;
+
+    if (in.size() < 4 || std::memcmp(in.data(), "NESI", 4) != 0 ||
+        !getPod(in, pos, version) || version != INDEX_VERSION ||
+        !getPod(in, pos, movieHash) || !getPod(in, pos, stateSize) ||
+        !getPod(in, pos, interval) || !getPod(in, pos, count) || interval == 0)
+        return false;
+
+    // An index for another movie (or an older take of this one) is useless
+    if (movieHash != movie.contentHash()) {
+        std::cout << "Movie index is stale: " << path << "\n";
+        return false;
+    }
+
+    std::vector<Keyframe> keys;
+    size_t used = 0;
+    for (uint32_t i = 0; i < count; i++) {
+        Keyframe k;
+        uint32_t len = 0;
+        if (!getPod(in, pos, k.frame) || !getPod(in, pos, len) || len > in.size() - pos)
+            return false;
+        k.data.assign(in.begin() + pos, in.begin() + pos + len);
+        pos += len;
+        used += len;
+        keys.push_back(std::move(k));
+    }
+
+    clear();
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_keys = std::move(keys);
+    m_movieHash = movieHash;
+    m_total = movie.frameCount();
+    m_done = m_total;
+    m_stateSize = stateSize;
+    m_interval = (int)interval;
+    m_used = used;
+    return true;
+}
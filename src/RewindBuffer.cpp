@@ -0,0 +1,197 @@
+#include "header/RewindBuffer.h"
+#include "header/savestate.h"
+#include "header/statecodec.h"
+
+RewindBuffer::RewindBuffer()
+{
+    m_worker = std::thread([this] { workerLoop(); });
+}
+
+RewindBuffer::~RewindBuffer()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_quit = true;
+    }
+    m_wake.notify_all();
+    if (m_worker.joinable()) m_worker.join();
+}
+
+void RewindBuffer::waitIdle(std::unique_lock<std::mutex>& lock)
+{
+    m_idle.wait(lock, [this] { return m_pending.empty() && !m_busy; });
+}
+
+void RewindBuffer::clear()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    waitIdle(lock);
+
+    m_history.clear();
+    m_used = 0;
+    m_sinceKey = 0;
+    m_forceKey = true;
+    m_stateSize = 0;
+}
+
+void RewindBuffer::setBudget(size_t bytes)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_budget = bytes;
+    evictToBudget();
+}
+
+void RewindBuffer::capture(const bus& b)
+{
+    std::vector<uint8_t> raw;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        if (m_stateSize == 0)
+            m_stateSize = SaveState::Measure(b);
+
+        if (!m_free.empty()) {
+            raw = std::move(m_free.back());
+            m_free.pop_back();
+        } else if (m_pending.size() >= POOL_SIZE) {
+            return; // worker is behind, skip this frame
+        }
+    }
+
+    // Only grows the first time a pooled buffer is used with this cartridge
+    if (raw.size() != m_stateSize) raw.resize(m_stateSize);
+
+    if (SaveState::Save(b, raw.data(), raw.size()) == 0)
+        return;
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_pending.push_back(std::move(raw));
+    }
+    m_wake.notify_one();
+}
+
+void RewindBuffer::workerLoop()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+
+    for (;;) {
+        m_wake.wait(lock, [this] { return m_quit || !m_pending.empty(); });
+        if (m_quit) return;
+
+        std::vector<uint8_t> raw = std::move(m_pending.front());
+        m_pending.pop_front();
+        m_busy = true;
+
+        lock.unlock();
+        store(raw);
+        lock.lock();
+
+        m_free.push_back(std::move(raw));
+        m_busy = false;
+
+        if (m_pending.empty()) m_idle.notify_all();
+    }
+}
+
+// Runs on the worker without the lock; only the history push is locked
+void RewindBuffer::store(const std::vector<uint8_t>& raw)
+{
+    Entry e;
+    e.key = m_forceKey || m_keyRaw.size() != raw.size() || m_sinceKey >= m_keyInterval;
+
+    if (e.key) {
+        m_keyRaw = raw;
+        StateCodec::Compress(raw.data(), raw.size(), e.data);
+        m_sinceKey = 0;
+        m_forceKey = false;
+    } else {
+        m_scratch.resize(raw.size());
+        StateCodec::XorDelta(raw.data(), m_keyRaw.data(), m_scratch.data(), raw.size());
+        StateCodec::Compress(m_scratch.data(), m_scratch.size(), e.data);
+        m_sinceKey++;
+    }
+    e.data.shrink_to_fit();
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_used += e.data.size();
+    m_history.push_back(std::move(e));
+    evictToBudget();
+}
+
+void RewindBuffer::evictToBudget()
+{
+    // Deltas are useless without their keyframe, so whole groups are dropped.
+    // The newest group is always kept.
+    while (m_used > m_budget && !m_history.empty()) {
+        size_t groupEnd = 1;
+        while (groupEnd < m_history.size() && !m_history[groupEnd].key) groupEnd++;
+        if (groupEnd == m_history.size()) break;
+
+        for (size_t i = 0; i < groupEnd; i++) {
+            m_used -= m_history.front().data.size();
+            m_history.pop_front();
+        }
+    }
+}
+
+bool RewindBuffer::decodeEntry(size_t idx, std::vector<uint8_t>& out)
+{
+    size_t k = idx;
+    while (k > 0 && !m_history[k].key) k--;
+    if (!m_history[k].key) return false;
+
+    out.resize(m_stateSize);
+    const Entry& key = m_history[k];
+    if (!StateCodec::Decompress(key.data.data(), key.data.size(), out.data(), out.size()))
+        return false;
+
+    if (k == idx) return true;
+
+    m_scratch.resize(m_stateSize);
+    const Entry& d = m_history[idx];
+    if (!StateCodec::Decompress(d.data.data(), d.data.size(), m_scratch.data(), m_scratch.size()))
+        return false;
+
+    StateCodec::XorDelta(out.data(), m_scratch.data(), out.data(), out.size());
+    return true;
+}
+
+bool RewindBuffer::stepBack(bus& b)
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    waitIdle(lock);
+
+    if (m_history.empty()) return false;
+
+    size_t idx = m_history.size() - 1;
+    bool ok = decodeEntry(idx, m_restore) && SaveState::Load(b, m_restore.data(), m_restore.size());
+
+    // The restored frame becomes "now"; the next capture will re-add it
+    Entry& e = m_history.back();
+    m_used -= e.data.size();
+    if (e.key) m_forceKey = true;
+    else       m_sinceKey--;
+    m_history.pop_back();
+
+    return ok;
+}
+
+size_t RewindBuffer::frameCount() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_history.size();
+}
+
+size_t RewindBuffer::usedBytes() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_used;
+}
+
+double RewindBuffer::compressionRatio() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_used == 0) return 0.0;
+    return (double)(m_history.size() * m_stateSize) / (double)m_used;
+}
@@ -0,0 +1,118 @@
+#include "header/ThreadPool.h"
+
+namespace {
+
+// Set on pool threads so tasks submitted from a task stay on the local deque
+thread_local const ThreadPool* currentPool = nullptr;
+thread_local size_t currentWorker = 0;
+
+} // namespace
+
+ThreadPool::ThreadPool(size_t threads)
+{
+    if (threads == 0) threads = std::thread::hardware_concurrency();
+    if (threads == 0) threads = 1;
+
+    for (size_t i = 0; i < threads; i++)
+        m_queues.push_back(std::make_unique<Queue>());
+    for (size_t i = 0; i < threads; i++)
+        m_threads.emplace_back([this, i] { workerLoop(i); });
+}
+
+ThreadPool::~ThreadPool()
+{
+    wait();
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_quit = true;
+    }
+    m_wake.notify_all();
+    for (std::thread& t : m_threads) t.join();
+}
+
+void ThreadPool::submit(std::function<void()> task)
+{
+    size_t target = currentPool == this ? currentWorker
+                                        : m_next.fetch_add(1) % m_queues.size();
+
+    m_pending++;
+
+    // Counted before the task is published, so a worker that steals it at
+    // once cannot take m_queued below zero (a worker woken in between just
+    // retries). Taking m_mutex orders the increment against a worker about
+    // to sleep.
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_queued++;
+    }
+    {
+        std::lock_guard<std::mutex> lock(m_queues[target]->mutex);
+        m_queues[target]->tasks.push_back(std::move(task));
+    }
+    m_wake.notify_one();
+}
+
+void ThreadPool::wait()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_idle.wait(lock, [this] { return m_pending == 0; });
+}
+
+void ThreadPool::parallelFor(size_t n, const std::function<void(size_t)>& fn)
+{
+    for (size_t i = 0; i < n; i++)
+        submit([&fn, i] { fn(i); });
+    wait();
+}
+
+bool ThreadPool::popOrSteal(size_t self, std::function<void()>& task)
+{
+    // Own queue: newest first (still warm in cache)
+    {
+        Queue& q = *m_queues[self];
+        std::lock_guard<std::mutex> lock(q.mutex);
+        if (!q.tasks.empty()) {
+            task = std::move(q.tasks.back());
+            q.tasks.pop_back();
+            return true;
+        }
+    }
+
+    // Victims: oldest first (usually the biggest remaining chunk of work)
+    for (size_t k = 1; k < m_queues.size(); k++) {
+        Queue& q = *m_queues[(self + k) % m_queues.size()];
+        std::lock_guard<std::mutex> lock(q.mutex);
+        if (!q.tasks.empty()) {
+            task = std::move(q.tasks.front());
+            q.tasks.pop_front();
+            return true;
+        }
+    }
+    return false;
+}
+
+void ThreadPool::workerLoop(size_t self)
+{
+    currentPool = this;
+    currentWorker = self;
+
+    for (;;) {
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_wake.wait(lock, [this] { return m_quit || m_queued > 0; });
+            if (m_quit && m_queued == 0) return;
+        }
+
+        std::function<void()> task;
+        if (!popOrSteal(self, task))
+            continue; // another worker got it first
+
+        m_queued--;
+        task();
+
+        if (--m_pending == 0) {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_idle.notify_all();
+        }
+    }
+}
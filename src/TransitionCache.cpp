@@ -0,0 +1,143 @@
+#include "header/TransitionCache.h"
+#include "header/nes.h"
+#include "header/hash.h"
+#include "header/statecodec.h"
+
+namespace {
+
+// Bookkeeping per entry on top of the compressed data (list node, map slot, Value)
+constexpr size_t ENTRY_OVERHEAD = 128;
+
+// Per-thread scratch, so concurrent step() calls never share buffers
+struct Scratch {
+    std::vector<uint8_t> before;
+    std::vector<uint8_t> after;
+};
+
+thread_local Scratch t_scratch;
+
+} // namespace
+
+size_t TransitionCache::KeyHash::operator()(const Key& k) const
+{
+    return (size_t)Hash::Mix64(k.state ^ k.input);
+}
+
+TransitionCache::TransitionCache(size_t budgetBytes, bool storeFrames)
+    : m_storeFrames(storeFrames), m_budget(budgetBytes)
+{
+}
+
+void TransitionCache::step(nes& n, uint8_t input)
+{
+    Scratch& s = t_scratch;
+    const size_t size = n.stateSize();
+    s.before.resize(size);
+    s.after.resize(size);
+
+    n.BUS.setControllerState(0, input);
+    n.saveState(s.before.data(), size);
+
+    // The incremental fingerprint saves hashing the whole state when it is on
+    const uint64_t state = n.fingerprinting() ? n.fingerprint() : Hash::Hash64(s.before.data(), size);
+    const Key key{ state, input };
+
+    if (std::shared_ptr<const Value> hit = find(key)) {
+        if (StateCodec::Decompress(hit->delta.data(), hit->delta.size(), s.after.data(), size) &&
+            (!m_storeFrames || StateCodec::Decompress(hit->frame.data(), hit->frame.size(),
+                                                      n.PPU.frameIndex.data(), n.PPU.frameIndex.size()))) {
+            StateCodec::XorDelta(s.after.data(), s.before.data(), s.after.data(), size);
+            if (n.loadState(s.after.data(), size)) return;
+        }
+        // A corrupt entry should not happen; fall through and emulate
+    }
+
+    n.runFrame();
+    if (m_storeFrames) n.renderIndexed();
+
+    auto value = std::make_shared<Value>();
+    n.saveState(s.after.data(), size);
+    StateCodec::XorDelta(s.after.data(), s.before.data(), s.after.data(), size);
+    StateCodec::Compress(s.after.data(), size, value->delta);
+    if (m_storeFrames)
+        StateCodec::Compress(n.PPU.frameIndex.data(), n.PPU.frameIndex.size(), value->frame);
+
+    insert(key, std::move(value));
+}
+
+std::shared_ptr<const TransitionCache::Value> TransitionCache::find(const Key& key)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    auto it = m_map.find(key);
+    if (it == m_map.end()) {
+        m_stats.misses++;
+        return nullptr;
+    }
+
+    m_stats.hits++;
+    m_lru.splice(m_lru.begin(), m_lru, it->second);
+    return it->second->value;
+}
+
+void TransitionCache::insert(const Key& key, std::shared_ptr<const Value> value)
+{
+    const size_t bytes = value->delta.size() + value->frame.size() + ENTRY_OVERHEAD;
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    // Another thread may have emulated the same transition meanwhile
+    auto it = m_map.find(key);
+    if (it != m_map.end()) {
+        m_stats.bytes -= it->second->bytes;
+        m_lru.erase(it->second);
+        m_map.erase(it);
+    }
+
+    m_lru.push_front(Entry{ key, std::move(value), bytes });
+    m_map[key] = m_lru.begin();
+    m_stats.bytes += bytes;
+
+    evict();
+}
+
+void TransitionCache::evict()
+{
+    // Keeps the newest entry even when it alone exceeds the budget
+    while (m_stats.bytes > m_budget && m_lru.size() > 1) {
+        Entry& last = m_lru.back();
+        m_stats.bytes -= last.bytes;
+        m_map.erase(last.key);
+        m_lru.pop_back();
+        m_stats.evictions++;
+    }
+    m_stats.entries = m_lru.size();
+}
+
+void TransitionCache::clear()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_lru.clear();
+    m_map.clear();
+    m_stats.bytes = 0;
+    m_stats.entries = 0;
+}
+
+void TransitionCache::setBudget(size_t bytes)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_budget = bytes;
+    evict();
+}
+
+size_t TransitionCache::budget() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_budget;
+}
+
+TransitionCache::Stats TransitionCache::stats() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_stats;
+}
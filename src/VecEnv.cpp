@@ -0,0 +1,173 @@
+#include "header/VecEnv.h"
+#include "header/nes.h"
+#include <algorithm>
+#include <exception>
+
+VecEnv::VecEnv(std::shared_ptr<const RomImage> rom, const Config& config)
+    : m_config(config), m_pool(config.threads)
+{
+    if (m_config.frameSkip < 1) m_config.frameSkip = 1;
+
+    if (m_config.cacheBytes)
+        m_cache = std::make_unique<TransitionCache>(m_config.cacheBytes, m_config.obs == Obs::Gray84);
+
+    m_envs.resize(m_config.numEnvs);
+    for (Env& e : m_envs) {
+        e.n = std::make_unique<nes>();
+        e.n->APU.setOutputEnabled(false);
+        if (!e.n->loadRom(rom)) return;
+    }
+    if (m_envs.empty()) return;
+
+    // Every episode starts from the same snapshot, so resets are a state load
+    nes& first = *m_envs[0].n;
+    first.powerOn();
+    try {
+        for (int i = 0; i < m_config.startFrames; i++) first.runFrame();
+    } catch (const std::exception&) {
+        return;
+    }
+
+    m_startState.resize(first.stateSize());
+    if (first.saveState(m_startState.data(), m_startState.size()) == 0) return;
+
+    m_valid = true;
+}
+
+VecEnv::~VecEnv() = default;
+
+size_t VecEnv::obsSize() const
+{
+    return m_config.obs == Obs::Gray84 ? 84 * 84 : 2048;
+}
+
+const uint8_t* VecEnv::ram(size_t env) const
+{
+    return m_envs[env].n->BUS.ram.data();
+}
+
+uint64_t VecEnv::episodeFrames(size_t env) const
+{
+    return m_envs[env].frames;
+}
+
+void VecEnv::DownsampleGray84(const uint8_t* indexed, uint8_t* out)
+{
+    // Luma of each palette entry (BGRA 0xAARRGGBB)
+    uint8_t luma[64];
+    for (int i = 0; i < 64; i++) {
+        uint32_t c = ppu::paletteColor((uint8_t)i);
+        uint32_t r = (c >> 16) & 0xFF, g = (c >> 8) & 0xFF, b = c & 0xFF;
+        luma[i] = (uint8_t)((r * 299 + g * 587 + b * 114) / 1000);
+    }
+
+    // Box filter: each output pixel averages the source pixels it covers
+    for (int oy = 0; oy < 84; oy++) {
+        int y0 = oy * 240 / 84, y1 = (oy + 1) * 240 / 84;
+
+        for (int ox = 0; ox < 84; ox++) {
+            int x0 = ox * 256 / 84, x1 = (ox + 1) * 256 / 84;
+
+            uint32_t sum = 0;
+            for (int y = y0; y < y1; y++) {
+                const uint8_t* row = indexed + y * 256;
+                for (int x = x0; x < x1; x++) sum += luma[row[x] & 0x3F];
+            }
+            out[oy * 84 + ox] = (uint8_t)(sum / (uint32_t)((y1 - y0) * (x1 - x0)));
+        }
+    }
+}
+
+void VecEnv::resetEnv(Env& e)
+{
+    e.n->loadState(m_startState.data(), m_startState.size());
+    e.frames = 0;
+    e.rendered = false;
+}
+
+void VecEnv::observe(Env& e, uint8_t* out, bool pooled)
+{
+    nes& n = *e.n;
+
+    if (m_config.obs == Obs::Ram) {
+        std::copy(n.BUS.ram.begin(), n.BUS.ram.end(), out);
+        return;
+    }
+
+    if (!e.rendered) n.renderIndexed();
+    DownsampleGray84(n.PPU.frameIndex.data(), out);
+
+    if (pooled) {
+        for (size_t i = 0; i < e.pool.size(); i++)
+            out[i] = std::max(out[i], e.pool[i]);
+    }
+}
+
+void VecEnv::reset(uint8_t* obs)
+{
+    if (!m_valid) return;
+
+    m_pool.parallelFor(m_envs.size(), [&](size_t i) {
+        resetEnv(m_envs[i]);
+        observe(m_envs[i], obs + i * obsSize(), false);
+    });
+}
+
+void VecEnv::stepEnv(size_t i, uint8_t action, uint8_t* obs, float* rewards, uint8_t* dones)
+{
+    Env& e = m_envs[i];
+    nes& n = *e.n;
+    uint8_t* out = obs + i * obsSize();
+
+    const int skip = m_config.frameSkip;
+    const bool pool = m_config.obs == Obs::Gray84 && m_config.maxPool && skip >= 2;
+
+    bool done = false;
+    bool pooled = false;
+
+    try {
+        n.BUS.setControllerState(0, action);
+
+        for (int f = 0; f < skip && !done; f++) {
+            if (m_cache) {
+                m_cache->step(n, action);
+                e.rendered = m_cache->storesFrames();
+            } else {
+                n.runFrame();
+            }
+            e.frames++;
+
+            done = (m_config.done && m_config.done(n.BUS.ram.data())) ||
+                   (m_config.maxEpisodeFrames && e.frames >= m_config.maxEpisodeFrames);
+
+            // Second-to-last frame is kept for max-pooling (flicker removal)
+            if (pool && f == skip - 2 && !done) {
+                e.pool.resize(obsSize());
+                observe(e, e.pool.data(), false);
+                pooled = true;
+            }
+        }
+    } catch (const std::exception&) {
+        // A crashed game (cpu::XXX) simply ends the episode
+        done = true;
+    }
+
+    if (rewards) rewards[i] = m_config.reward ? m_config.reward(n.BUS.ram.data()) : 0.0f;
+    if (dones) dones[i] = done ? 1 : 0;
+
+    if (done) {
+        resetEnv(e);
+        observe(e, out, false);
+    } else {
+        observe(e, out, pooled);
+    }
+}
+
+void VecEnv::step(const uint8_t* actions, uint8_t* obs, float* rewards, uint8_t* dones)
+{
+    if (!m_valid) return;
+
+    m_pool.parallelFor(m_envs.size(), [&](size_t i) {
+        stepEnv(i, actions[i], obs, rewards, dones);
+    });
+}
@@ -1,5 +1,6 @@
 // src/apu.cpp
 #include "header/apu.h"
+#include "header/savestate.h"
 
 // Length counter lookup table (32 entries)
 uint8_t apu::lengthTable(uint8_t idx) {
@@ -34,6 +35,90 @@ void apu::reset() {
     m_samplePhase = 0.0;
 }
 
+// Channel structs are written field by field so padding bytes never reach
+// the snapshot (keeps identical machines byte-identical for delta/hashing).
+template <typename IO, typename P>
+void apu::pulseFields(IO& io, P& p) {
+    io.pod(p.enabled);
+    io.pod(p.duty); io.pod(p.length_halt); io.pod(p.constant_volume); io.pod(p.volume);
+    io.pod(p.env_divider); io.pod(p.env_decay); io.pod(p.env_start);
+    io.pod(p.timer); io.pod(p.timer_counter);
+    io.pod(p.seq_step);
+    io.pod(p.length_counter);
+    io.pod(p.sweep_enabled); io.pod(p.sweep_period); io.pod(p.sweep_negate); io.pod(p.sweep_shift);
+    io.pod(p.sweep_reload); io.pod(p.sweep_divider);
+}
+
+template <typename IO, typename T>
+void apu::triangleFields(IO& io, T& t) {
+    io.pod(t.enabled);
+    io.pod(t.control_flag); io.pod(t.linear_reload);
+    io.pod(t.linear_counter); io.pod(t.linear_reload_flag);
+    io.pod(t.timer); io.pod(t.timer_counter);
+    io.pod(t.seq_step);
+    io.pod(t.length_counter);
+}
+
+template <typename IO, typename N>
+void apu::noiseFields(IO& io, N& n) {
+    io.pod(n.enabled);
+    io.pod(n.length_halt); io.pod(n.constant_volume); io.pod(n.volume);
+    io.pod(n.env_divider); io.pod(n.env_decay); io.pod(n.env_start);
+    io.pod(n.mode); io.pod(n.period);
+    io.pod(n.timer_counter);
+    io.pod(n.lfsr);
+    io.pod(n.length_counter);
+}
+
+template <typename IO, typename D>
+void apu::dmcFields(IO& io, D& d) {
+    io.pod(d.enabled);
+    io.pod(d.irq_enable); io.pod(d.loop); io.pod(d.rate);
+    io.pod(d.output_level);
+    io.pod(d.sample_addr_reg); io.pod(d.sample_len_reg);
+    io.pod(d.current_addr); io.pod(d.bytes_remaining);
+    io.pod(d.shift_reg); io.pod(d.bits_remaining);
+    io.pod(d.sample_buffer); io.pod(d.sample_buffer_empty);
+    io.pod(d.timer_counter);
+    io.pod(d.irq);
+}
+
+void apu::saveState(StateWriter& w) const {
+    w.pod(reg);
+
+    w.pod(frame_counter);
+    w.pod(frame_mode);
+    w.pod(irq_inhibit);
+    w.pod(frame_irq);
+    w.pod(cpu_cycle);
+
+    pulseFields(w, p1);
+    pulseFields(w, p2);
+    triangleFields(w, tri);
+    noiseFields(w, noise);
+    dmcFields(w, dmc);
+
+    w.pod(m_samplePhase);
+}
+
+void apu::loadState(StateReader& r) {
+    r.pod(reg);
+
+    r.pod(frame_counter);
+    r.pod(frame_mode);
+    r.pod(irq_inhibit);
+    r.pod(frame_irq);
+    r.pod(cpu_cycle);
+
+    pulseFields(r, p1);
+    pulseFields(r, p2);
+    triangleFields(r, tri);
+    noiseFields(r, noise);
+    dmcFields(r, dmc);
+
+    r.pod(m_samplePhase);
+}
+
 uint8_t apu::debugReg(uint16_t addr) const {
     if (addr < 0x4000 || addr > 0x4017) return 0x00;
     return reg[addr - 0x4000];
@@ -53,9 +138,10 @@ uint8_t apu::debugStatus4015() const {
 }
 
 uint8_t apu::cpuRead(uint16_t addr, bool readonly) {
-    (void)readonly;
-
     if (addr == 0x4015) {
+        // Peeks (debugger views, conditions) must not acknowledge the IRQ
+        if (readonly) return debugStatus4015();
+
         uint8_t s = 0;
 
         if (p1.length_counter    > 0) s |= (1 << 0);
@@ -457,7 +543,8 @@ void apu::clock() {
 
     while (m_samplePhase >= 1.0) {
         m_samplePhase -= 1.0;
-        pushSample(sample()); // sample() already have (Pulse 1 mix)
+        if (m_outputEnabled)
+            pushSample(sample()); // sample() already have (Pulse 1 mix)
     }
 }
 
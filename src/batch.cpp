@@ -0,0 +1,380 @@
+#include "header/batch.h"
+#include "header/nes.h"
+#include "header/Movie.h"
+#include "header/hash.h"
+#include "header/tracelog.h"
+#include "header/codedatalog.h"
+#include "header/cheats.h"
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cstdio>
+#include <exception>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <memory>
+#include <random>
+
+namespace fs = std::filesystem;
+
+namespace {
+
+std::string lower(std::string s)
+{
+    for (char& c : s) c = (char)std::tolower((unsigned char)c);
+    return s;
+}
+
+std::string fileName(const std::string& path)
+{
+    return fs::path(path).filename().string();
+}
+
+// <dir>/<rom hash>-<prefix hash>.nesstate
+std::string warmPath(const std::string& dir, const nes& n, uint64_t prefixHash)
+{
+    const RomImage& rom = *n.CART->image;
+    char name[64];
+    std::snprintf(name, sizeof(name), "%016llx-%016llx.nesstate",
+                  (unsigned long long)Hash::Hash64(rom.data(), rom.size()),
+                  (unsigned long long)prefixHash);
+    return (fs::path(dir) / name).string();
+}
+
+bool loadWarm(const std::string& path, nes& n)
+{
+    std::ifstream ifs(path, std::ifstream::binary);
+    if (!ifs.is_open()) return false;
+
+    std::vector<uint8_t> data((std::istreambuf_iterator<char>(ifs)), std::istreambuf_iterator<char>());
+    return n.loadState(data.data(), data.size());
+}
+
+// Written under a unique temporary name, then renamed over the final one, so
+// readers only ever see complete files
+bool storeWarm(const std::string& path, const nes& n)
+{
+    std::vector<uint8_t> data(n.stateSize());
+    if (n.saveState(data.data(), data.size()) == 0) return false;
+
+    std::error_code ec;
+    fs::create_directories(fs::path(path).parent_path(), ec);
+
+    char suffix[32];
+    std::snprintf(suffix, sizeof(suffix), ".tmp%08x", (unsigned)std::random_device{}());
+    const std::string tmp = path + suffix;
+
+    {
+        std::ofstream ofs(tmp, std::ofstream::binary | std::ofstream::trunc);
+        if (!ofs.is_open()) return false;
+        ofs.write(reinterpret_cast<const char*>(data.data()), (std::streamsize)data.size());
+        if (!ofs) {
+            ofs.close();
+            fs::remove(tmp, ec);
+            return false;
+        }
+    }
+
+    fs::rename(tmp, path, ec);
+    if (ec) {
+        // Windows will not replace an existing file; another worker got there first
+        fs::remove(tmp, ec);
+        return false;
+    }
+    return true;
+}
+
+// Adds this run's flags to the job's log from earlier runs
+bool storeCdl(const std::string& path, CodeDataLog& cdl)
+{
+    std::error_code ec;
+    fs::create_directories(fs::path(path).parent_path(), ec);
+    if (fs::exists(path, ec)) cdl.merge(path);
+
+    char suffix[32];
+    std::snprintf(suffix, sizeof(suffix), ".tmp%08x", (unsigned)std::random_device{}());
+    const std::string tmp = path + suffix;
+    if (!cdl.save(tmp)) {
+        fs::remove(tmp, ec);
+        return false;
+    }
+    fs::rename(tmp, path, ec);
+    if (ec) fs::remove(tmp, ec);
+    return !ec;
+}
+
+} // namespace
+
+namespace Batch {
+
+std::vector<Job> FindJobs(const std::string& dir, uint64_t frames, bool recursive)
+{
+    std::vector<Job> jobs;
+    std::error_code ec;
+
+    auto consider = [&](const fs::directory_entry& e) {
+        if (!e.is_regular_file(ec) || lower(e.path().extension().string()) != ".nes")
+            return;
+
+        Job job;
+        job.romPath = e.path().string();
+        job.frames = frames;
+
+        for (const char* ext : { "nesmovie", "fm2" }) {
+            std::string movie = Movie::PathFor(job.romPath, ext);
+            if (fs::exists(movie, ec)) {
+                job.moviePath = movie;
+                break;
+            }
+        }
+        jobs.push_back(std::move(job));
+    };
+
+    if (recursive) {
+        for (const auto& e : fs::recursive_directory_iterator(dir, fs::directory_options::skip_permission_denied, ec))
+            consider(e);
+    } else {
+        for (const auto& e : fs::directory_iterator(dir, ec))
+            consider(e);
+    }
+
+    std::sort(jobs.begin(), jobs.end(), [](const Job& a, const Job& b) { return a.romPath < b.romPath; });
+    return jobs;
+}
+
+Result Run(const Job& job, const Options& options)
+{
+    Result r;
+    r.job = job;
+
+    // Heap: a console is a few hundred KB (framebuffers) and pool threads
+    // should not need big stacks
+    auto n = std::make_unique<nes>();
+    n->APU.setOutputEnabled(false);
+
+    auto t0 = std::chrono::steady_clock::now();
+
+    std::string error;
+    if (!n->loadRom(job.romPath, &error)) {
+        r.status = error.rfind("unsupported mapper", 0) == 0 ? Status::BadMapper : Status::LoadFailed;
+        r.message = error.empty() ? "load failed" : error;
+        return r;
+    }
+
+    // Cached states are of unpatched runs
+    const bool warm = !options.warmCacheDir.empty() && options.warmFrames > 0 && options.cdlDir.empty() &&
+                      options.cheats.empty();
+    const uint64_t prefix = options.warmFrames;
+
+    std::unique_ptr<TraceLog> trace;
+    if (!options.traceDir.empty() || options.watchdogMs) {
+        trace = std::make_unique<TraceLog>();
+        trace->attach(n.get());
+        trace->startFlightRecorder(options.traceDir.empty() ? std::string()
+                                   : (fs::path(options.traceDir) / fileName(job.romPath)).string());
+        trace->setWatchdog(options.watchdogMs);
+    }
+
+    std::unique_ptr<CodeDataLog> cdl;
+    if (!options.cdlDir.empty()) {
+        cdl = std::make_unique<CodeDataLog>();
+        cdl->attach(n.get());
+    }
+
+    Cheats cheats;
+    for (const std::string& code : options.cheats) {
+        if (!cheats.add(code, {}, &error)) {
+            r.status = Status::LoadFailed;
+            r.message = error;
+            return r;
+        }
+    }
+    cheats.attach(&n->BUS);
+
+    try {
+        if (!job.moviePath.empty()) {
+            Movie movie;
+            bool fm2 = lower(fs::path(job.moviePath).extension().string()) == ".fm2";
+            bool loaded = fm2 ? movie.importFM2(job.moviePath) : movie.loadFile(job.moviePath);
+
+            if (!loaded || !movie.startPlayback(*n)) {
+                r.status = Status::MovieFailed;
+                r.message = "cannot play " + fileName(job.moviePath);
+                return r;
+            }
+
+            if (warm && movie.frameCount() >= prefix) {
+                std::string path = warmPath(options.warmCacheDir, *n, movie.prefixHash(prefix));
+                if (loadWarm(path, *n) && movie.resumeAt(prefix)) {
+                    r.warmFrames = prefix;
+                } else {
+                    while (r.framesRun < prefix && movie.step(*n)) r.framesRun++;
+                    r.warmStored = storeWarm(path, *n);
+                }
+            }
+
+            while (movie.step(*n)) r.framesRun++;
+
+            if (movie.hasEndHash() && Movie::StateHash(*n) != movie.endHash()) {
+                r.status = Status::MovieFailed;
+                r.message = "desync (end state differs)";
+            }
+        } else {
+            // No input: the prefix is `prefix` idle frames from power-on,
+            // the same key a movie starting that way gets
+            if (warm && job.frames >= prefix) {
+                std::vector<Movie::Frame> idle(prefix);
+                std::string path = warmPath(options.warmCacheDir, *n,
+                                            Movie::PrefixHash(Movie::Anchor::PowerOn, {}, idle.data(), idle.size()));
+                if (loadWarm(path, *n)) {
+                    r.warmFrames = prefix;
+                } else {
+                    for (; r.framesRun < prefix; r.framesRun++)
+                        n->runFrame();
+                    r.warmStored = storeWarm(path, *n);
+                }
+            }
+
+            for (; r.warmFrames + r.framesRun < job.frames; r.framesRun++)
+                n->runFrame();
+        }
+
+        n->renderFrame();
+        r.frameHash = Hash::Hash64(reinterpret_cast<const uint8_t*>(n->PPU.frame.data()),
+                                   n->PPU.frame.size() * sizeof(n->PPU.frame[0]));
+        if (options.keepFrame) r.frame.assign(n->PPU.frame.begin(), n->PPU.frame.end());
+
+        if (cdl) {
+            const std::string name = job.moviePath.empty() ? std::string("idle") : fileName(job.moviePath);
+            storeCdl((fs::path(options.cdlDir) / fileName(job.romPath) / (name + ".cdl")).string(), *cdl);
+        }
+    } catch (const std::exception& e) {
+        r.status = Status::CpuFault;
+        r.message = e.what();
+        while (!r.message.empty() && r.message.back() == '\n') r.message.pop_back();
+        std::replace(r.message.begin(), r.message.end(), '\n', ';');
+        if (trace && !trace->stats().lastDump.empty())
+            r.message += " (trace: " + trace->stats().lastDump + ")";
+    }
+
+    r.instanceBytes = n->instanceBytes();
+    r.romBytes = n->sharedRomBytes();
+    r.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+    r.fps = r.seconds > 0.0 ? (double)r.framesRun / r.seconds : 0.0;
+    r.warmSavedSeconds = r.fps > 0.0 ? (double)r.warmFrames / r.fps : 0.0;
+    return r;
+}
+
+void MergeCoverage(const std::string& cdlDir, const std::vector<Job>& jobs, std::ostream& report)
+{
+    std::vector<std::string> roms;
+    for (const Job& job : jobs) roms.push_back(job.romPath);
+    std::sort(roms.begin(), roms.end());
+    roms.erase(std::unique(roms.begin(), roms.end()), roms.end());
+
+    for (const std::string& rom : roms) {
+        const fs::path dir = fs::path(cdlDir) / fileName(rom);
+        std::error_code ec;
+        if (!fs::is_directory(dir, ec)) continue;
+
+        // The console only sizes the flags for this cartridge
+        auto n = std::make_unique<nes>();
+        if (!n->loadRom(rom)) continue;
+        CodeDataLog cdl;
+        cdl.attach(n.get());
+        cdl.setRunning(false);
+
+        size_t runs = 0;
+        for (const auto& e : fs::directory_iterator(dir, ec)) {
+            if (e.path().extension() == ".cdl" && cdl.merge(e.path().string())) runs++;
+        }
+
+        const std::string out = dir.string() + ".cdl";
+        cdl.save(out);
+        report << fileName(rom) << ": " << runs << " logs -> " << out << "\n";
+        cdl.writeReport(report);
+    }
+}
+
+const char* StatusName(Status s)
+{
+    switch (s) {
+        case Status::Ok:          return "ok";
+        case Status::LoadFailed:  return "load-failed";
+        case Status::BadMapper:   return "bad-mapper";
+        case Status::CpuFault:    return "cpu-fault";
+        case Status::MovieFailed: return "movie-failed";
+        case Status::Crashed:     return "crashed";
+    }
+    return "?";
+}
+
+void WriteReport(std::ostream& os, const std::vector<Result>& results, double wallSeconds)
+{
+    uint64_t totalFrames = 0;
+    double cpuSeconds = 0.0;
+    size_t maxInstance = 0;
+    size_t romTotal = 0;
+    size_t counts[6] = {};
+    size_t warmHits = 0, warmStores = 0;
+    uint64_t warmFrames = 0;
+    double warmSaved = 0.0;
+    char line[512];
+
+    for (const Result& r : results) {
+        std::snprintf(line, sizeof(line), "%-40.40s %-12s %8llu %016llx %9.0f  %s\n",
+                      fileName(r.job.romPath).c_str(), StatusName(r.status),
+                      (unsigned long long)r.framesRun, (unsigned long long)r.frameHash,
+                      r.fps, r.message.c_str());
+        os << line;
+
+        totalFrames += r.framesRun;
+        cpuSeconds += r.seconds;
+        maxInstance = std::max(maxInstance, r.instanceBytes);
+        romTotal += r.romBytes;
+        counts[(int)r.status]++;
+
+        if (r.warmFrames) warmHits++;
+        if (r.warmStored) warmStores++;
+        warmFrames += r.warmFrames;
+        warmSaved += r.warmSavedSeconds;
+    }
+
+    os << "\n";
+    std::snprintf(line, sizeof(line), "%zu jobs: %zu ok, %zu load-failed, %zu bad-mapper, %zu cpu-fault, %zu movie-failed, %zu crashed\n",
+                  results.size(), counts[0], counts[1], counts[2], counts[3], counts[4], counts[5]);
+    os << line;
+    std::snprintf(line, sizeof(line), "%llu frames in %.2f s wall (%.2f s summed): %.0f fps aggregate, %.0f fps per job\n",
+                  (unsigned long long)totalFrames, wallSeconds, cpuSeconds,
+                  wallSeconds > 0.0 ? (double)totalFrames / wallSeconds : 0.0,
+                  cpuSeconds > 0.0 ? (double)totalFrames / cpuSeconds : 0.0);
+    os << line;
+    std::snprintf(line, sizeof(line), "memory: %.1f KB per instance, %.1f KB of ROM images\n",
+                  (double)maxInstance / 1024.0, (double)romTotal / 1024.0);
+    os << line;
+
+    if (warmHits || warmStores) {
+        std::snprintf(line, sizeof(line), "warm start: %zu hits, %zu stored, %llu frames skipped, ~%.2f s saved\n",
+                      warmHits, warmStores, (unsigned long long)warmFrames, warmSaved);
+        os << line;
+    }
+}
+
+void WriteCsv(std::ostream& os, const std::vector<Result>& results)
+{
+    os << "rom,movie,status,frames,frame_hash,seconds,fps,instance_bytes,rom_bytes,warm_frames,message\n";
+    for (const Result& r : results) {
+        std::string msg = r.message;
+        std::replace(msg.begin(), msg.end(), ',', ';');
+
+        char hash[17];
+        std::snprintf(hash, sizeof(hash), "%016llx", (unsigned long long)r.frameHash);
+
+        os << r.job.romPath << ',' << r.job.moviePath << ',' << StatusName(r.status) << ','
+           << r.framesRun << ',' << hash << ',' << r.seconds << ',' << r.fps << ','
+           << r.instanceBytes << ',' << r.romBytes << ',' << r.warmFrames << ',' << msg << "\n";
+    }
+}
+
+} // namespace Batch
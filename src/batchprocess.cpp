@@ -0,0 +1,339 @@
+#include "header/batch.h"
+#include "header/ThreadPool.h"
+
+#include <algorithm>
+#include <thread>
+
+namespace {
+
+std::vector<Batch::Result> runThreaded(const std::vector<Batch::Job>& jobs, size_t workers,
+                                       const Batch::Options& options)
+{
+    std::vector<Batch::Result> results(jobs.size());
+    ThreadPool pool(workers);
+    pool.parallelFor(jobs.size(), [&](size_t i) { results[i] = Batch::Run(jobs[i], options); });
+    return results;
+}
+
+} // namespace
+
+#ifdef _WIN32
+
+namespace Batch {
+
+std::vector<Result> RunIsolated(const std::vector<Job>& jobs, size_t workers, const Options& options)
+{
+    return runThreaded(jobs, workers, options);
+}
+
+} // namespace Batch
+
+#else
+
+#include <cerrno>
+#include <csignal>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+namespace {
+
+constexpr size_t FRAME_PIXELS = 256 * 240;
+
+// One per worker in the shared mapping. The worker fills it in, then sends
+// the job index over its pipe.
+struct Slot {
+    uint8_t  status;
+    uint8_t  warmStored;
+    uint8_t  hasFrame;
+    uint64_t framesRun;
+    uint64_t frameHash;
+    uint64_t warmFrames;
+    uint64_t instanceBytes;
+    uint64_t romBytes;
+    double   seconds;
+    double   fps;
+    double   warmSavedSeconds;
+    char     message[512];
+    uint32_t frame[FRAME_PIXELS];
+};
+
+struct Worker {
+    pid_t pid = -1;
+    int   jobFd = -1;      // supervisor -> worker: job indices
+    int   doneFd = -1;     // worker -> supervisor: finished job indices
+    long  job = -1;        // in flight, -1 = idle
+};
+
+bool writeAll(int fd, const void* data, size_t n)
+{
+    const char* p = static_cast<const char*>(data);
+    while (n > 0) {
+        ssize_t k = ::write(fd, p, n);
+        if (k < 0 && errno == EINTR) continue;
+        if (k <= 0) return false;
+        p += k;
+        n -= (size_t)k;
+    }
+    return true;
+}
+
+bool readAll(int fd, void* data, size_t n)
+{
+    char* p = static_cast<char*>(data);
+    while (n > 0) {
+        ssize_t k = ::read(fd, p, n);
+        if (k < 0 && errno == EINTR) continue;
+        if (k <= 0) return false;
+        p += k;
+        n -= (size_t)k;
+    }
+    return true;
+}
+
+void closeFd(int& fd)
+{
+    if (fd >= 0) ::close(fd);
+    fd = -1;
+}
+
+[[noreturn]] void workerMain(int jobFd, int doneFd, Slot* slot,
+                             const std::vector<Batch::Job>& jobs, const Batch::Options& options)
+{
+    uint32_t index = 0;
+    while (readAll(jobFd, &index, sizeof(index)) && index < jobs.size()) {
+        Batch::Result r = Batch::Run(jobs[index], options);
+
+        slot->status = (uint8_t)r.status;
+        slot->warmStored = r.warmStored ? 1 : 0;
+        slot->framesRun = r.framesRun;
+        slot->frameHash = r.frameHash;
+        slot->warmFrames = r.warmFrames;
+        slot->instanceBytes = r.instanceBytes;
+        slot->romBytes = r.romBytes;
+        slot->seconds = r.seconds;
+        slot->fps = r.fps;
+        slot->warmSavedSeconds = r.warmSavedSeconds;
+        std::snprintf(slot->message, sizeof(slot->message), "%s", r.message.c_str());
+        slot->hasFrame = r.frame.size() == FRAME_PIXELS ? 1 : 0;
+        if (slot->hasFrame)
+            std::copy(r.frame.begin(), r.frame.end(), slot->frame);
+
+        if (!writeAll(doneFd, &index, sizeof(index))) break;
+    }
+
+    std::cout.flush();
+    std::cerr.flush();
+    _exit(0);
+}
+
+void readSlot(const Slot& slot, bool keepFrame, Batch::Result& r)
+{
+    r.status = (Batch::Status)slot.status;
+    r.warmStored = slot.warmStored != 0;
+    r.framesRun = slot.framesRun;
+    r.frameHash = slot.frameHash;
+    r.warmFrames = slot.warmFrames;
+    r.instanceBytes = (size_t)slot.instanceBytes;
+    r.romBytes = (size_t)slot.romBytes;
+    r.seconds = slot.seconds;
+    r.fps = slot.fps;
+    r.warmSavedSeconds = slot.warmSavedSeconds;
+    r.message.assign(slot.message, strnlen(slot.message, sizeof(slot.message)));
+    if (keepFrame && slot.hasFrame) r.frame.assign(slot.frame, slot.frame + FRAME_PIXELS);
+}
+
+std::string describeExit(int status)
+{
+    char text[128];
+    if (WIFSIGNALED(status))
+        std::snprintf(text, sizeof(text), "worker killed by signal %d (%s)", WTERMSIG(status), strsignal(WTERMSIG(status)));
+    else if (WIFEXITED(status))
+        std::snprintf(text, sizeof(text), "worker exited with code %d", WEXITSTATUS(status));
+    else
+        std::snprintf(text, sizeof(text), "worker died");
+    return text;
+}
+
+} // namespace
+
+namespace Batch {
+
+std::vector<Result> RunIsolated(const std::vector<Job>& jobs, size_t workers, const Options& options)
+{
+    if (workers == 0) workers = std::max(1u, std::thread::hardware_concurrency());
+    workers = std::min(workers, jobs.size());
+    if (workers == 0) return {};
+
+    // Result slots. The name is unlinked right away: workers inherit the
+    // mapping through fork(), and nothing is left behind if we crash.
+    const size_t bytes = workers * sizeof(Slot);
+    char name[64];
+    std::snprintf(name, sizeof(name), "/nesemu-batch-%d", (int)getpid());
+
+    int shm = shm_open(name, O_RDWR | O_CREAT | O_EXCL, 0600);
+    if (shm < 0) return runThreaded(jobs, workers, options);
+    shm_unlink(name);
+
+    void* mapping = MAP_FAILED;
+    if (ftruncate(shm, (off_t)bytes) == 0)
+        mapping = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, shm, 0);
+    ::close(shm);
+    if (mapping == MAP_FAILED) return runThreaded(jobs, workers, options);
+
+    Slot* slots = static_cast<Slot*>(mapping);
+
+    // A worker that died mid-job must not take us down on the next write
+    void (*oldPipe)(int) = std::signal(SIGPIPE, SIG_IGN);
+
+    std::vector<Result> results(jobs.size());
+    for (size_t i = 0; i < jobs.size(); i++) results[i].job = jobs[i];
+
+    std::vector<Worker> pool(workers);
+    size_t next = 0;
+    size_t done = 0;
+
+    auto spawn = [&](size_t k) -> bool {
+        int jobPipe[2], donePipe[2];
+        if (pipe(jobPipe) != 0) return false;
+        if (pipe(donePipe) != 0) {
+            ::close(jobPipe[0]);
+            ::close(jobPipe[1]);
+            return false;
+        }
+
+        // Unflushed output would be written twice (by us and by the child)
+        std::cout.flush();
+        std::cerr.flush();
+        std::fflush(nullptr);
+
+        pid_t pid = fork();
+        if (pid == 0) {
+            ::close(jobPipe[1]);
+            ::close(donePipe[0]);
+            // Other workers' pipes would hide their EOF from the supervisor
+            for (Worker& other : pool) {
+                closeFd(other.jobFd);
+                closeFd(other.doneFd);
+            }
+            workerMain(jobPipe[0], donePipe[1], &slots[k], jobs, options);
+        }
+
+        ::close(jobPipe[0]);
+        ::close(donePipe[1]);
+        if (pid < 0) {
+            ::close(jobPipe[1]);
+            ::close(donePipe[0]);
+            return false;
+        }
+
+        pool[k].pid = pid;
+        pool[k].jobFd = jobPipe[1];
+        pool[k].doneFd = donePipe[0];
+        pool[k].job = -1;
+        return true;
+    };
+
+    // Next job to worker k, or end of input so it exits
+    auto dispatch = [&](size_t k) {
+        Worker& w = pool[k];
+        if (next < jobs.size()) {
+            uint32_t index = (uint32_t)next;
+            w.job = (long)next++;
+            writeAll(w.jobFd, &index, sizeof(index));   // a dead worker shows up as EOF below
+        } else {
+            closeFd(w.jobFd);
+        }
+    };
+
+    for (size_t k = 0; k < workers; k++)
+        if (spawn(k)) dispatch(k);
+
+    std::vector<pollfd> fds;
+    std::vector<size_t> owner;
+
+    while (done < jobs.size()) {
+        fds.clear();
+        owner.clear();
+        for (size_t k = 0; k < workers; k++) {
+            if (pool[k].doneFd < 0) continue;
+            fds.push_back(pollfd{ pool[k].doneFd, POLLIN, 0 });
+            owner.push_back(k);
+        }
+
+        // Every worker gone and none could be started: give up on the rest
+        if (fds.empty()) {
+            for (; next < jobs.size(); next++) {
+                results[next].status = Status::Crashed;
+                results[next].message = "no worker process";
+            }
+            break;
+        }
+
+        if (poll(fds.data(), (nfds_t)fds.size(), -1) < 0) {
+            if (errno == EINTR) continue;
+            break;
+        }
+
+        for (size_t f = 0; f < fds.size(); f++) {
+            if (!(fds[f].revents & (POLLIN | POLLHUP | POLLERR))) continue;
+
+            const size_t k = owner[f];
+            Worker& w = pool[k];
+
+            uint32_t index = 0;
+            if (readAll(w.doneFd, &index, sizeof(index))) {
+                if (index < jobs.size()) {
+                    readSlot(slots[k], options.keepFrame, results[index]);
+                    done++;
+                }
+                w.job = -1;
+                dispatch(k);
+                continue;
+            }
+
+            // EOF: the worker is gone, either finished or crashed
+            closeFd(w.doneFd);
+            closeFd(w.jobFd);
+
+            int status = 0;
+            while (waitpid(w.pid, &status, 0) < 0 && errno == EINTR) {}
+            w.pid = -1;
+
+            if (w.job >= 0) {
+                Result& r = results[(size_t)w.job];
+                r.status = Status::Crashed;
+                r.message = describeExit(status);
+                std::cerr << r.job.romPath << ": " << r.message << "\n";
+                w.job = -1;
+                done++;
+            }
+
+            if (next < jobs.size() && spawn(k)) dispatch(k);
+        }
+    }
+
+    for (Worker& w : pool) {
+        closeFd(w.jobFd);
+        closeFd(w.doneFd);
+        if (w.pid > 0) {
+            int status = 0;
+            while (waitpid(w.pid, &status, 0) < 0 && errno == EINTR) {}
+        }
+    }
+
+    munmap(mapping, bytes);
+    std::signal(SIGPIPE, oldPipe);
+    return results;
+}
+
+} // namespace Batch
+
+#endif
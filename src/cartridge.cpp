@@ -3,101 +3,214 @@
 #include "Mappers/Mapper002.h"
 #include "Mappers/Mapper009.h"
 #include "Mappers/Mapper001.h"
-#include <fstream>
+#include "header/savestate.h"
+#include "header/romimage.h"
+#include "header/fingerprint.h"
+#include "header/codedatalog.h"
+#include <algorithm>
+#include <cstring>
 #include <iostream>
 
 
 
 cartridge::cartridge(const std::string& filename)
 {
-    valid = false;
-
-    std::ifstream ifs(filename, std::ifstream::binary);
-    if (!ifs.is_open()) {
+    image = RomImage::Open(filename, &error);
+    if (!image) {
         std::cout << "Cartridge open failed: " << filename << "\n";
         return;
     }
 
-    uint8_t header[16];
-    ifs.read(reinterpret_cast<char*>(header), 16);
+    load();
+}
 
-    // Validate iNES header "NES<EOF>"
-    if (header[0] != 'N' || header[1] != 'E' || header[2] != 'S' || header[3] != 0x1A) {
-        std::cout << "Invalid NES header\n";
+cartridge::cartridge(std::shared_ptr<const RomImage> img)
+    : image(std::move(img))
+{
+    if (!image) {
+        error = "open failed";
         return;
     }
 
-    // PRG/CHR sizes
-    prgBanks = header[4];
-    chrBanks = header[5];
+    load();
+}
+
+namespace {
 
-    // Mapper ID uses high nibble of header[6] and high nibble of header[7]
-    mapperID = ((header[7] & 0xF0) | (header[6] >> 4));
+// Largest sizes the plain NES 2.0 form can express; the exponent form is
+// held to the same limits
+constexpr uint64_t MAX_PRG_ROM = 0xFFFull * 16384;
+constexpr uint64_t MAX_CHR_ROM = 0xFFFull * 8192;
+
+// NES 2.0 ROM size: LSB from byte 4/5, MSB nibble from byte 9. An MSB
+// nibble of $F switches to 2^E * (MM*2+1) bytes, EEEEEEMM in the LSB.
+uint64_t romSize(uint8_t lsb, uint8_t msb, uint64_t unit)
+{
+    if (msb == 0x0F) {
+        const unsigned exponent = lsb >> 2;
+        const uint64_t multiplier = (lsb & 0x03) * 2 + 1;
+        return exponent >= 32 ? UINT64_MAX : (1ull << exponent) * multiplier;
+    }
+    return (((uint64_t)msb << 8) | lsb) * unit;
+}
+
+// NES 2.0 RAM size: 64 << shift bytes, 0 for none
+uint32_t ramSize(uint8_t shift)
+{
+    return shift ? 64u << shift : 0;
+}
+
+} // namespace
+
+bool cartridge::ParseHeader(const uint8_t* data, size_t size, Header& out, std::string* error)
+{
+    out = Header();
+
+    // Validate iNES header "NES<EOF>"
+    if (size < 16 || data[0] != 'N' || data[1] != 'E' || data[2] != 'S' || data[3] != 0x1A) {
+        if (error) *error = "invalid header";
+        return false;
+    }
+
+    const uint8_t* h = data;
+    out.nes20   = (h[7] & 0x0C) == 0x08;
+    out.battery = (h[6] & 0x02) != 0;
+    out.trainer = (h[6] & 0x04) != 0;
 
     // Mirroring flags
-    bool fourScreen = (header[6] & 0x08) != 0;
-    bool vertical   = (header[6] & 0x01) != 0;
+    if (h[6] & 0x08)      out.mirror = Mirror::FOUR_SCREEN;
+    else if (h[6] & 0x01) out.mirror = Mirror::VERTICAL;
+    else                  out.mirror = Mirror::HORIZONTAL;
+
+    uint64_t prgSize = 0, chrSize = 0;
+    if (out.nes20) {
+        out.mapper    = (uint16_t)(((h[8] & 0x0F) << 8) | (h[7] & 0xF0) | (h[6] >> 4));
+        out.submapper = h[8] >> 4;
+        prgSize = romSize(h[4], h[9] & 0x0F, 16384);
+        chrSize = romSize(h[5], h[9] >> 4, 8192);
+
+        out.prgRamSize   = ramSize(h[10] & 0x0F);
+        out.prgNvramSize = ramSize(h[10] >> 4);
+        out.chrRamSize   = ramSize(h[11] & 0x0F);
+        out.chrNvramSize = ramSize(h[11] >> 4);
+        out.region = (Region)(h[12] & 0x03);
+    } else {
+        // Bytes 12-15 are zero in a clean iNES 1.0 header; old dump tools
+        // wrote text ("DiskDude!") from byte 7 on, so byte 7 is junk then
+        const bool dirty = (h[12] | h[13] | h[14] | h[15]) != 0;
+        out.mapper = (uint16_t)((dirty ? 0 : (h[7] & 0xF0)) | (h[6] >> 4));
+        prgSize = (uint64_t)h[4] * 16384;
+        chrSize = (uint64_t)h[5] * 8192;
+
+        (out.battery ? out.prgNvramSize : out.prgRamSize) = 8192;
+        if (chrSize == 0) out.chrRamSize = 8192;
+        if (!dirty && (h[9] & 0x01)) out.region = Region::PAL;
+    }
 
-    if (fourScreen) mirror = Mirror::FOUR_SCREEN;
-    else            mirror = vertical ? Mirror::VERTICAL : Mirror::HORIZONTAL;
+    if (prgSize > MAX_PRG_ROM || chrSize > MAX_CHR_ROM) {
+        if (error) *error = "ROM size in header is too large";
+        return false;
+    }
+    out.prgRomSize = (uint32_t)prgSize;
+    out.chrRomSize = (uint32_t)chrSize;
+    return true;
+}
+
+void cartridge::load()
+{
+    valid = false;
 
-    // Skip trainer if present
-    if (header[6] & 0x04) {
-        ifs.seekg(512, std::ios_base::cur);
+    if (!ParseHeader(image->data(), image->size(), header, &error)) {
+        std::cout << "Invalid NES header: " << error << "\n";
+        return;
     }
 
-    // Allocate PRG/CHR ROM
-    uint32_t prgSize = (uint32_t)prgBanks * 16384;
-    uint32_t chrSize = (uint32_t)chrBanks * 8192;
+    mapperID = header.mapper;
+    prgBanks = (uint16_t)((header.prgRomSize + 16383) / 16384);
+    chrBanks = (uint16_t)((header.chrRomSize + 8191) / 8192);
+    mirror = header.mirror;
+
+    const size_t offset = header.romOffset();
+    const size_t prgSize = header.prgRomSize;
+    const size_t chrSize = header.chrRomSize;
+
+    // Short dumps used to read as zero-filled; keep that by padding a private copy.
+    // Complete files stay mapped and PRG/CHR point straight into the mapping.
+    size_t needed = offset + prgSize + chrSize;
+    if (image->size() < needed) {
+        std::vector<uint8_t> padded(image->data(), image->data() + image->size());
+        padded.resize(needed, 0x00);
+        image = RomImage::FromMemory(std::move(padded), image->path());
+    }
 
-    prgRom.resize(prgSize);
+    // PRG + CHR are views into the shared image
+    prgRom = { image->data() + offset, prgSize };
 
-    // If chrBanks == 0 => CHR RAM (8KB)
+    // No CHR-ROM => CHR-RAM; a NES 2.0 header that gives neither still gets 8KB
     if (chrBanks == 0) {
-        chrRom.resize(8192);
+        const size_t chrRamSize = (size_t)header.chrRamSize + header.chrNvramSize;
+        chrRam.assign(chrRamSize ? chrRamSize : 8192, 0x00);
+        chrRom = { chrRam.data(), chrRam.size() };
     } else {
-        chrRom.resize(chrSize);
+        chrRom = { image->data() + offset + prgSize, chrSize };
     }
 
-    prgRam.resize(8192, 0x00);
+    // Identifies the game in save states and movies; CHR follows PRG in the file
+    romCrc = image->crc32(offset, prgSize + (chrBanks ? chrSize : 0));
 
-    // Read PRG + CHR
-    ifs.read(reinterpret_cast<char*>(prgRom.data()), prgSize);
+    // Volatile part first, then the battery-backed part
+    prgRam.assign((size_t)header.prgRamSize + header.prgNvramSize, 0x00);
 
-    if (chrBanks > 0) {
-        ifs.read(reinterpret_cast<char*>(chrRom.data()), chrSize);
-    }
+    if (!createMapper())
+        return;
 
-    ifs.close();
+    valid = true;
+}
+
+std::shared_ptr<Mapper> cartridge::MakeMapper(uint16_t id, uint16_t prgBanks, uint16_t chrBanks)
+{
+    switch (id) {
+        case 0: return std::make_shared<Mapper000>(prgBanks, chrBanks);
+        case 1: return std::make_shared<Mapper001>(prgBanks, chrBanks);
+        case 2: return std::make_shared<Mapper002>(prgBanks, chrBanks);
+        case 9: return std::make_shared<Mapper009>(prgBanks, chrBanks);
+        default: return nullptr;
+    }
+}
 
-    // Mapper selection
-    switch (mapperID) {
-        case 0:
-            mapper = std::make_shared<Mapper000>(prgBanks, chrBanks);
-            break;
-        case 1:
-            mapper = std::make_shared<Mapper001>(prgBanks, chrBanks);
-            break;
-        case 2:
-            mapper = std::make_shared<Mapper002>(prgBanks, chrBanks);
-            break;
-        case 9:
-            mapper = std::make_shared<Mapper009>(prgBanks, chrBanks);
-            break;
+bool cartridge::SupportsMapper(uint16_t id)
+{
+    return MakeMapper(id, 1, 1) != nullptr;
+}
 
-        default:
-            std::cout << "Unsupported mapper: " << (int)mapperID << "\n";
-            return;
+bool cartridge::createMapper()
+{
+    mapper = MakeMapper(mapperID, prgBanks, chrBanks);
+    if (!mapper) {
+        error = "unsupported mapper " + std::to_string((int)mapperID);
+        std::cout << "Unsupported mapper: " << (int)mapperID << "\n";
+        return false;
     }
 
-    valid = true;
+    return true;
+}
+
+void cartridge::reset()
+{
+    if (valid) createMapper();
+
+    std::fill(prgRam.begin(), prgRam.end(), 0x00);
+    std::fill(chrRam.begin(), chrRam.end(), 0x00);
+
+    mirror = header.mirror;
 }
 
 bool cartridge::cpuRead(uint16_t addr, uint8_t& data)
 {
     // PRG-RAM region is usually $6000-$7FFF (even on NROM/UNROM)
     if (addr >= 0x6000 && addr <= 0x7FFF) {
-        data = prgRam[addr & 0x1FFF];
+        if (prgRam.empty()) return false;
+        data = prgRam[prgRamIndex(addr)];
         return true;
     }
 
@@ -114,6 +227,15 @@ bool cartridge::cpuRead(uint16_t addr, uint8_t& data)
 
 bool cartridge::cpuWrite(uint16_t addr, uint8_t data)
 {
+    // PRG-RAM as on the read side: whatever the header sized, on every mapper
+    if (addr >= 0x6000 && addr <= 0x7FFF) {
+        if (prgRam.empty()) return false;
+        const size_t i = prgRamIndex(addr);
+        FingerprintWrite(fingerprint, Fingerprint::PrgRam, (uint32_t)i, prgRam[i], data);
+        prgRam[i] = data;
+        return true;
+    }
+
     uint32_t mappedAddr = 0;
     if (mapper && mapper->cpuMapWrite(addr, mappedAddr, data)) {
 
@@ -138,17 +260,7 @@ bool cartridge::cpuWrite(uint16_t addr, uint8_t data)
             }
         }
 
-        if (mappedAddr == 0xFFFFFFFF)
-            return true;
-
-        if (addr >= 0x6000 && addr <= 0x7FFF) {
-            prgRam[mappedAddr & 0x1FFF] = data;
-            return true;
-        }
-
-        if (mappedAddr < prgRom.size())
-            prgRom[mappedAddr] = data;
-
+        // Writes into ROM space only ever reach mapper registers
         return true;
     }
     return false;
@@ -160,20 +272,84 @@ bool cartridge::ppuRead(uint16_t addr, uint8_t& data)
     if (mapper && mapper->ppuMapRead(addr, mappedAddr)) {
         if (mappedAddr < chrRom.size()) {
             data = chrRom[mappedAddr];
+            CdlChr(cdl, mappedAddr);
             return true;
         }
     }
     return false;
 }
 
+bool cartridge::ppuPeek(uint16_t addr, uint8_t& data) const
+{
+    uint32_t mappedAddr = 0;
+    if (mapper && mapper->ppuMapPeek(addr, mappedAddr) && mappedAddr < chrRom.size()) {
+        data = chrRom[mappedAddr];
+        return true;
+    }
+    return false;
+}
+
 bool cartridge::ppuWrite(uint16_t addr, uint8_t data)
 {
     uint32_t mappedAddr = 0;
     if (mapper && mapper->ppuMapWrite(addr, mappedAddr)) {
         // Only valid if CHR RAM (chrBanks == 0), mapper enforces this
-        if (mappedAddr < chrRom.size())
-            chrRom[mappedAddr] = data;
+        if (mappedAddr < chrRam.size()) {
+            FingerprintWrite(fingerprint, Fingerprint::ChrRam, mappedAddr, chrRam[mappedAddr], data);
+            chrRam[mappedAddr] = data;
+        }
         return true;
     }
     return false;
 }
+
+size_t cartridge::instanceBytes() const
+{
+    // Mapper registers are a handful of bytes and not counted
+    return sizeof(cartridge) + prgRam.capacity() + chrRam.capacity();
+}
+
+// Save states
+// The identity fields come first so SaveState::Load can reject a state taken
+// with a different cartridge before touching anything.
+void cartridge::saveState(StateWriter& w) const
+{
+    // One byte is enough for every mapper createMapper() knows
+    uint8_t  id = (uint8_t)mapperID;
+    uint32_t prgSize = (uint32_t)prgRom.size();
+    uint32_t chrSize = (uint32_t)chrRom.size();
+    w.pod(id);
+    w.pod(prgSize);
+    w.pod(chrSize);
+    w.pod(romCrc);
+
+    uint8_t mir = (uint8_t)mirror;
+    w.pod(mir);
+
+    w.write(prgRam.data(), prgRam.size());
+
+    // CHR ROM is immutable; only CHR RAM carries state
+    if (chrBanks == 0)
+        w.write(chrRam.data(), chrRam.size());
+}
+
+void cartridge::loadState(StateReader& r)
+{
+    uint8_t  id = 0;
+    uint32_t prgSize = 0;
+    uint32_t chrSize = 0;
+    uint32_t crc = 0;
+    r.pod(id);
+    r.pod(prgSize);
+    r.pod(chrSize);
+    r.pod(crc);
+
+    uint8_t mir = 0;
+    r.pod(mir);
+    mirror = (Mirror)mir;
+
+    r.read(prgRam.data(), prgRam.size());
+
+    if (chrBanks == 0)
+        r.read(chrRam.data(), chrRam.size());
+}
@@ -0,0 +1,214 @@
+#include "header/cheats.h"
+#include "header/Bus.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+
+namespace {
+
+constexpr const char* GG_LETTERS = "APZLGITYEOXUKSVN";
+
+// $0000-$07FF repeats every 2 KB up to $1FFF
+inline uint16_t canonical(uint16_t addr)
+{
+    return addr <= 0x1FFF ? (uint16_t)(addr & 0x07FF) : addr;
+}
+
+bool parseHex(const std::string& text, size_t maxDigits, unsigned& out)
+{
+    if (text.empty() || text.size() > maxDigits) return false;
+    for (char c : text)
+        if (!std::isxdigit((unsigned char)c)) return false;
+    out = (unsigned)std::strtoul(text.c_str(), nullptr, 16);
+    return true;
+}
+
+bool parseGameGenie(const std::string& code, Cheats::Cheat& out)
+{
+    if (code.size() != 6 && code.size() != 8) return false;
+
+    unsigned n[8] = {};
+    for (size_t i = 0; i < code.size(); i++) {
+        const char* p = std::strchr(GG_LETTERS, code[i]);
+        if (!p || !*p) return false;
+        n[i] = (unsigned)(p - GG_LETTERS);
+    }
+
+    // Bits are scattered over the letters; see the nesdev Game Genie page
+    out.addr = (uint16_t)(0x8000 |
+                          ((n[3] & 7) << 12) | ((n[5] & 7) << 8) | ((n[4] & 8) << 8) |
+                          ((n[2] & 7) << 4) | ((n[1] & 8) << 4) | (n[4] & 7) | (n[3] & 8));
+
+    if (code.size() == 6) {
+        out.value = (uint8_t)(((n[1] & 7) << 4) | ((n[0] & 8) << 4) | (n[0] & 7) | (n[5] & 8));
+        out.compare = -1;
+    } else {
+        out.value = (uint8_t)(((n[1] & 7) << 4) | ((n[0] & 8) << 4) | (n[0] & 7) | (n[7] & 8));
+        out.compare = (int16_t)(((n[7] & 7) << 4) | ((n[6] & 8) << 4) | (n[6] & 7) | (n[5] & 8));
+    }
+    return true;
+}
+
+bool parseRaw(const std::string& code, Cheats::Cheat& out)
+{
+    std::vector<std::string> parts;
+    size_t start = 0;
+    for (;;) {
+        const size_t colon = code.find(':', start);
+        parts.push_back(code.substr(start, colon - start));
+        if (colon == std::string::npos) break;
+        start = colon + 1;
+    }
+    if (parts.size() < 2 || parts.size() > 3) return false;
+
+    unsigned addr = 0, value = 0, compare = 0;
+    if (!parseHex(parts[0], 4, addr) || !parseHex(parts[1], 2, value)) return false;
+    if (parts.size() == 3 && !parseHex(parts[2], 2, compare)) return false;
+
+    out.addr = (uint16_t)addr;
+    out.value = (uint8_t)value;
+    out.compare = parts.size() == 3 ? (int16_t)compare : (int16_t)-1;
+    return true;
+}
+
+} // namespace
+
+bool Cheats::Parse(const std::string& code, Cheat& out, std::string* error)
+{
+    std::string text;
+    for (char c : code)
+        if (!std::isspace((unsigned char)c)) text += (char)std::toupper((unsigned char)c);
+
+    out.code = text;
+    const bool ok = text.find(':') != std::string::npos ? parseRaw(text, out) : parseGameGenie(text, out);
+    if (!ok && error)
+        *error = "\"" + code + "\" is not a Game Genie code or AAAA:VV[:CC]";
+    return ok;
+}
+
+void Cheats::attach(bus* b)
+{
+    if (m_bus && m_bus != b) {
+        for (uint8_t& t : m_bus->trapPages) t &= (uint8_t)~bus::TRAP_CHEAT;
+        m_bus->cheats = nullptr;
+    }
+    m_bus = b;
+    rebuild();
+}
+
+bool Cheats::add(const std::string& code, const std::string& name, std::string* error)
+{
+    Cheat c;
+    if (!Parse(code, c, error)) return false;
+    c.name = name;
+    m_cheats.push_back(std::move(c));
+    rebuild();
+    return true;
+}
+
+void Cheats::remove(size_t index)
+{
+    if (index >= m_cheats.size()) return;
+    m_cheats.erase(m_cheats.begin() + (std::ptrdiff_t)index);
+    rebuild();
+}
+
+void Cheats::setEnabled(size_t index, bool enabled)
+{
+    if (index >= m_cheats.size()) return;
+    m_cheats[index].enabled = enabled;
+    rebuild();
+}
+
+void Cheats::clear()
+{
+    m_cheats.clear();
+    rebuild();
+}
+
+bool Cheats::load(const std::string& path, std::string* error)
+{
+    std::ifstream in(path);
+    if (!in) {
+        if (error) *error = "cannot read " + path;
+        return false;
+    }
+
+    std::vector<Cheat> cheats;
+    std::string line;
+    int lineNo = 0;
+    while (std::getline(in, line)) {
+        lineNo++;
+        const size_t first = line.find_first_not_of(" \t\r");
+        if (first == std::string::npos || line[first] == '#') continue;
+
+        size_t at = first;
+        const bool disabled = line[at] == '-';
+        if (disabled) at++;
+        const size_t end = line.find_first_of(" \t\r", at);
+        const std::string code = line.substr(at, end == std::string::npos ? std::string::npos : end - at);
+
+        Cheat c;
+        std::string why;
+        if (!Parse(code, c, &why)) {
+            if (error) *error = path + ":" + std::to_string(lineNo) + ": " + why;
+            return false;
+        }
+        if (end != std::string::npos) {
+            const size_t nameStart = line.find_first_not_of(" \t", end);
+            const size_t nameEnd = line.find_last_not_of(" \t\r");
+            if (nameStart != std::string::npos && nameEnd >= nameStart)
+                c.name = line.substr(nameStart, nameEnd - nameStart + 1);
+        }
+        c.enabled = !disabled;
+        cheats.push_back(std::move(c));
+    }
+
+    m_cheats = std::move(cheats);
+    rebuild();
+    return true;
+}
+
+bool Cheats::save(const std::string& path) const
+{
+    std::ofstream out(path);
+    for (const Cheat& c : m_cheats) {
+        out << (c.enabled ? "" : "-") << c.code;
+        if (!c.name.empty()) out << ' ' << c.name;
+        out << '\n';
+    }
+    return (bool)out;
+}
+
+uint8_t Cheats::onRead(uint16_t addr, uint8_t data) const
+{
+    // Other addresses on a patched page get here too; a game rarely has
+    // more than a handful of codes on
+    const uint16_t a = canonical(addr);
+    for (const Patch& p : m_patches)
+        if (p.addr == a && (p.compare < 0 || p.compare == data)) return p.value;
+    return data;
+}
+
+void Cheats::rebuild()
+{
+    m_patches.clear();
+    for (const Cheat& c : m_cheats)
+        if (c.enabled) m_patches.push_back({ canonical(c.addr), c.value, c.compare });
+
+    if (!m_bus) return;
+
+    for (uint8_t& t : m_bus->trapPages) t &= (uint8_t)~bus::TRAP_CHEAT;
+    m_bus->cheats = m_patches.empty() ? nullptr : this;
+
+    for (const Patch& p : m_patches) {
+        const unsigned page = p.addr >> 8;
+        m_bus->trapPages[page] |= bus::TRAP_CHEAT;
+        if (p.addr <= 0x07FF)
+            for (unsigned mirror = page + 8; mirror < 0x20; mirror += 8)
+                m_bus->trapPages[mirror] |= bus::TRAP_CHEAT;
+    }
+}
@@ -0,0 +1,195 @@
+#include "header/codedatalog.h"
+#include "header/nes.h"
+#include "header/mapper.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+
+namespace {
+
+constexpr uint8_t OP_JMP_IND = 0x6C;
+
+constexpr uint8_t MODE_INDIRECT_DATA = 1;
+constexpr uint8_t MODE_JUMP_INDIRECT = 2;
+
+} // namespace
+
+CodeDataLog::~CodeDataLog()
+{
+    attach(nullptr);
+}
+
+void CodeDataLog::attach(nes* n)
+{
+    if (m_nes && m_nes != n) {
+        m_nes->BUS.cdl = nullptr;
+        m_nes->PPU.cdl = nullptr;
+        if (m_nes->CART) m_nes->CART->cdl = nullptr;
+    }
+    m_nes = n;
+    if (!n) return;
+
+    for (int op = 0; op < 256; op++) {
+        const char* name = n->CPU.opName((uint8_t)op);
+        const cpu::AddrMode mode = n->CPU.opMode((uint8_t)op);
+        if (name[0] == 'X' && name[1] == 'X' && name[2] == 'X')
+            m_len[op] = 1;
+        else if (mode == cpu::AddrMode::IMP)
+            m_len[op] = 1;
+        else if (mode == cpu::AddrMode::ABS || mode == cpu::AddrMode::ABX ||
+                 mode == cpu::AddrMode::ABY || mode == cpu::AddrMode::IND)
+            m_len[op] = 3;
+        else
+            m_len[op] = 2;
+
+        m_mode[op] = (mode == cpu::AddrMode::IZX || mode == cpu::AddrMode::IZY) ? MODE_INDIRECT_DATA : 0;
+    }
+    m_mode[OP_JMP_IND] = MODE_JUMP_INDIRECT;
+
+    // CHR-RAM is not logged (FCEUX leaves the CHR part out)
+    const size_t prgSize = n->CART ? n->CART->prgRom.size() : 0;
+    const size_t chrSize = n->CART && n->CART->chrBanks ? n->CART->chrRom.size() : 0;
+    if (m_prg.size() != prgSize || m_chr.size() != chrSize) {
+        m_prg.assign(prgSize, 0);
+        m_chr.assign(chrSize, 0);
+    }
+
+    m_start = m_end = 0;
+    m_jumpIndirect = false;
+    m_chrAccess = Drawn;
+    setRunning(true);
+}
+
+void CodeDataLog::setRunning(bool running)
+{
+    if (!m_nes) return;
+    CodeDataLog* self = running ? this : nullptr;
+    m_nes->BUS.cdl = self;
+    m_nes->PPU.cdl = self;
+    if (m_nes->CART) m_nes->CART->cdl = self;
+}
+
+bool CodeDataLog::running() const
+{
+    return m_nes && m_nes->BUS.cdl == this;
+}
+
+void CodeDataLog::clear()
+{
+    std::fill(m_prg.begin(), m_prg.end(), 0);
+    std::fill(m_chr.begin(), m_chr.end(), 0);
+}
+
+void CodeDataLog::mark(bus& b, uint16_t addr, uint8_t flags)
+{
+    uint32_t offset = 0;
+    if (addr >= 0x8000 && b.cart && b.cart->mapper && b.cart->mapper->cpuMapRead(addr, offset) && offset < m_prg.size())
+        m_prg[offset] |= flags | ((addr & 0x6000) >> 11);
+}
+
+void CodeDataLog::onFetch(bus& b, uint16_t pc)
+{
+    const uint8_t op = b.read(pc, true);
+    const uint8_t len = m_len[op];
+
+    m_start = pc;
+    m_end = (uint32_t)pc + len;
+    m_indirect = m_mode[op] == MODE_INDIRECT_DATA ? IndirectData : 0;
+
+    mark(b, pc, Code | Opcode | (m_jumpIndirect ? IndirectCode : 0));
+    for (uint8_t i = 1; i < len; i++)
+        mark(b, (uint16_t)(pc + i), Code);
+
+    m_jumpIndirect = m_mode[op] == MODE_JUMP_INDIRECT;
+}
+
+void CodeDataLog::onCpuRead(bus& b, uint16_t addr)
+{
+    // The opcode and operand fetches were marked by onFetch()
+    if (addr >= m_start && addr < m_end) return;
+    mark(b, addr, Data | m_indirect);
+}
+
+void CodeDataLog::onPcm(bus& b, uint16_t addr)
+{
+    mark(b, addr, Pcm);
+}
+
+bool CodeDataLog::save(const std::string& path) const
+{
+    std::ofstream out(path, std::ios::binary);
+    out.write(reinterpret_cast<const char*>(m_prg.data()), (std::streamsize)m_prg.size());
+    out.write(reinterpret_cast<const char*>(m_chr.data()), (std::streamsize)m_chr.size());
+    return (bool)out;
+}
+
+bool CodeDataLog::merge(const std::string& path, std::string* error)
+{
+    std::ifstream in(path, std::ios::binary);
+    if (!in) {
+        if (error) *error = "cannot read " + path;
+        return false;
+    }
+    std::vector<uint8_t> bytes((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+
+    if (bytes.size() != m_prg.size() + m_chr.size()) {
+        if (error) *error = path + " is for a ROM of another size";
+        return false;
+    }
+
+    for (size_t i = 0; i < m_prg.size(); i++) m_prg[i] |= bytes[i];
+    for (size_t i = 0; i < m_chr.size(); i++) m_chr[i] |= bytes[m_prg.size() + i];
+    return true;
+}
+
+CodeDataLog::Coverage CodeDataLog::coverage() const
+{
+    Coverage c;
+    c.prgSize = m_prg.size();
+    c.chrSize = m_chr.size();
+
+    for (uint8_t f : m_prg) {
+        if (f & Code) c.code++;
+        if (f & Data) c.data++;
+        if ((f & Code) && (f & Data)) c.both++;
+        if (f & Opcode) c.opcodes++;
+        if ((f & Pcm) && !(f & (Code | Data))) c.pcm++;
+    }
+    for (uint8_t f : m_chr) {
+        if (f & Drawn) c.drawn++;
+        if (f & Read) c.read++;
+    }
+    return c;
+}
+
+void CodeDataLog::writeReport(std::ostream& os) const
+{
+    const Coverage c = coverage();
+    auto pct = [](size_t n, size_t of) { return of ? 100.0 * (double)n / (double)of : 0.0; };
+
+    char line[160];
+    std::snprintf(line, sizeof(line), "PRG %zu bytes: %.1f%% logged, %.1f%% code (%zu instructions), %.1f%% data, %.1f%% DPCM only\n",
+                  c.prgSize, pct(c.prgLogged(), c.prgSize), pct(c.code, c.prgSize), c.opcodes,
+                  pct(c.data, c.prgSize), pct(c.pcm, c.prgSize));
+    os << line;
+    if (c.chrSize) {
+        std::snprintf(line, sizeof(line), "CHR %zu bytes: %.1f%% drawn, %.1f%% read through $2007\n",
+                      c.chrSize, pct(c.drawn, c.chrSize), pct(c.read, c.chrSize));
+        os << line;
+    }
+
+    constexpr size_t BANK = 0x2000;
+    for (size_t bank = 0; bank * BANK < m_prg.size(); bank++) {
+        size_t code = 0, logged = 0;
+        const size_t end = std::min(m_prg.size(), (bank + 1) * BANK);
+        for (size_t i = bank * BANK; i < end; i++) {
+            if (m_prg[i] & Code) code++;
+            if (m_prg[i] & (Code | Data | Pcm)) logged++;
+        }
+        std::snprintf(line, sizeof(line), "  bank %02zu ($%06zX): %5.1f%% logged, %5.1f%% code\n",
+                      bank, bank * BANK, pct(logged, end - bank * BANK), pct(code, end - bank * BANK));
+        os << line;
+    }
+}
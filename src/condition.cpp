@@ -0,0 +1,524 @@
+#include "header/condition.h"
+#include "header/Bus.h"
+#include "header/cpu.h"
+#include "header/ppu.h"
+
+#include <cctype>
+#include <cstdio>
+#include <stdexcept>
+#include <utility>
+
+namespace {
+
+struct Name {
+    const char* text;
+    uint8_t code;
+    int32_t arg;
+};
+
+bool sameName(const std::string& a, const char* b)
+{
+    size_t i = 0;
+    for (; i < a.size() && b[i]; i++)
+        if (std::tolower((unsigned char)a[i]) != b[i]) return false;
+    return i == a.size() && !b[i];
+}
+
+} // namespace
+
+// Recursive descent straight into postfix bytecode, one level per precedence
+class ConditionParser {
+public:
+    using Op = Condition::Op;
+    using Code = Condition::Code;
+
+    ConditionParser(const std::string& text, std::vector<Op>& code) : m_text(text), m_code(code) {}
+
+    void parse()
+    {
+        skipSpace();
+        logicalOr();
+        if (m_pos < m_text.size()) fail("unexpected '" + m_text.substr(m_pos, 1) + "'");
+    }
+
+private:
+    [[noreturn]] void fail(const std::string& what)
+    {
+        throw std::runtime_error(what + " at column " + std::to_string(m_pos + 1));
+    }
+
+    void skipSpace()
+    {
+        while (m_pos < m_text.size() && std::isspace((unsigned char)m_text[m_pos])) m_pos++;
+    }
+
+    bool accept(const char* token)
+    {
+        size_t n = 0;
+        while (token[n]) n++;
+        if (m_text.compare(m_pos, n, token) != 0) return false;
+
+        // "<" must not match the start of "<=" or "<<", "&" of "&&", and so on
+        if (n == 1 && m_pos + 1 < m_text.size()) {
+            char c = token[0], next = m_text[m_pos + 1];
+            if ((c == '<' || c == '>') && (next == '=' || next == c)) return false;
+            if ((c == '&' || c == '|') && next == c) return false;
+            if (c == '!' && next == '=') return false;
+        }
+
+        m_pos += n;
+        skipSpace();
+        return true;
+    }
+
+    void emit(Code code, int32_t arg = 0)
+    {
+        m_code.push_back(Op{ code, Code::None, arg, 0 });
+
+        switch (code) {
+        case Code::Peek: case Code::Neg: case Code::Not: case Code::BitNot: case Code::Bool:
+        case Code::JumpIfZero: case Code::JumpIfNonZero:
+            break;
+        case Code::Mul: case Code::Add: case Code::Sub: case Code::Shl: case Code::Shr:
+        case Code::BitAnd: case Code::BitXor: case Code::BitOr:
+        case Code::Eq: case Code::Ne: case Code::Lt: case Code::Le: case Code::Gt: case Code::Ge:
+            m_depth--;
+            break;
+        default:
+            if (++m_depth > Condition::MAX_DEPTH) fail("expression too deep");
+            break;
+        }
+    }
+
+    // Instructions before the end of the last && / || may be jumped over,
+    // so the result there is not what they compute: never rewrite them
+    bool rewritable(size_t back) const
+    {
+        return m_code.size() >= back && m_code.size() - back >= m_jumpEnd;
+    }
+
+    bool lastIsConst(size_t back) const
+    {
+        return rewritable(back) && m_code[m_code.size() - back].code == Code::Const;
+    }
+
+    static bool isLeaf(const Op& op) { return op.code >= Code::Const && op.code <= Code::PeekRam; }
+    static bool isCompare(Code code) { return code >= Code::Eq && code <= Code::Ge; }
+
+    // Already 0 or 1, so && and || need no Bool after it
+    static bool isBoolean(const Op& op)
+    {
+        if (isLeaf(op)) return isCompare(op.cmp) || (op.code == Code::Flag && op.cmp == Code::None);
+        return isCompare(op.code) || op.code == Code::Not || op.code == Code::Bool;
+    }
+
+    // Operator with the operands swapped, or None
+    static Code mirror(Code code)
+    {
+        switch (code) {
+        case Code::Add: case Code::Mul: case Code::BitAnd: case Code::BitXor: case Code::BitOr:
+        case Code::Eq: case Code::Ne:
+            return code;
+        case Code::Lt: return Code::Gt;
+        case Code::Gt: return Code::Lt;
+        case Code::Le: return Code::Ge;
+        case Code::Ge: return Code::Le;
+        default:       return Code::None;
+        }
+    }
+
+    void binary(Code code)
+    {
+        if (lastIsConst(1) && lastIsConst(2)) {
+            int32_t b = m_code.back().arg;
+            m_code.pop_back();
+            m_depth--;
+            m_code.back().arg = Condition::fold(code, m_code.back().arg, b);
+            return;
+        }
+
+        // "$40 == A" -> "A == $40"
+        if (lastIsConst(2) && isLeaf(m_code.back()) && m_code.back().cmp == Code::None) {
+            Code mirrored = mirror(code);
+            if (mirrored != Code::None) {
+                std::swap(m_code[m_code.size() - 2], m_code.back());
+                code = mirrored;
+            }
+        }
+
+        // "A == $40" -> one instruction
+        if (lastIsConst(1) && rewritable(2)) {
+            Op& leaf = m_code[m_code.size() - 2];
+            if (isLeaf(leaf) && leaf.cmp == Code::None) {
+                leaf.cmp = code;
+                leaf.imm = m_code.back().arg;
+                m_code.pop_back();
+                m_depth--;
+                return;
+            }
+        }
+
+        emit(code);
+    }
+
+    void unary(Code code)
+    {
+        if (lastIsConst(1)) {
+            int32_t& v = m_code.back().arg;
+            v = code == Code::Neg ? (int32_t)(0u - (uint32_t)v) : code == Code::Not ? (v == 0) : ~v;
+            return;
+        }
+        emit(code);
+    }
+
+    // a && b: a; JumpIfZero end; b; [Bool]; end:
+    void shortCircuit(Code jump, void (ConditionParser::*operand)())
+    {
+        size_t at = m_code.size();
+        emit(jump);
+        m_depth--;      // popped when not taken
+        (this->*operand)();
+        if (!isBoolean(m_code.back())) emit(Code::Bool);
+        m_code[at].arg = (int32_t)m_code.size();
+        m_jumpEnd = m_code.size();
+    }
+
+    void enter()
+    {
+        if (++m_nest > 64) fail("nested too deeply");
+    }
+
+    void logicalOr()
+    {
+        enter();
+        logicalAnd();
+        while (accept("||")) shortCircuit(Code::JumpIfNonZero, &ConditionParser::logicalAnd);
+        m_nest--;
+    }
+
+    void logicalAnd()
+    {
+        comparison();
+        while (accept("&&")) shortCircuit(Code::JumpIfZero, &ConditionParser::comparison);
+    }
+
+    void comparison()
+    {
+        bitOr();
+        for (;;) {
+            Code code;
+            if      (accept("==")) code = Code::Eq;
+            else if (accept("!=")) code = Code::Ne;
+            else if (accept("<=")) code = Code::Le;
+            else if (accept(">=")) code = Code::Ge;
+            else if (accept("<"))  code = Code::Lt;
+            else if (accept(">"))  code = Code::Gt;
+            else return;
+            bitOr();
+            binary(code);
+        }
+    }
+
+    void bitOr()
+    {
+        bitXor();
+        while (accept("|")) { bitXor(); binary(Code::BitOr); }
+    }
+
+    void bitXor()
+    {
+        bitAnd();
+        while (accept("^")) { bitAnd(); binary(Code::BitXor); }
+    }
+
+    void bitAnd()
+    {
+        shift();
+        while (accept("&")) { shift(); binary(Code::BitAnd); }
+    }
+
+    void shift()
+    {
+        additive();
+        for (;;) {
+            if      (accept("<<")) { additive(); binary(Code::Shl); }
+            else if (accept(">>")) { additive(); binary(Code::Shr); }
+            else return;
+        }
+    }
+
+    void additive()
+    {
+        multiplicative();
+        for (;;) {
+            if      (accept("+")) { multiplicative(); binary(Code::Add); }
+            else if (accept("-")) { multiplicative(); binary(Code::Sub); }
+            else return;
+        }
+    }
+
+    void multiplicative()
+    {
+        prefix();
+        while (accept("*")) { prefix(); binary(Code::Mul); }
+    }
+
+    void prefix()
+    {
+        enter();
+        if      (accept("!")) { prefix(); unary(Code::Not); }
+        else if (accept("~")) { prefix(); unary(Code::BitNot); }
+        else if (accept("-")) { prefix(); unary(Code::Neg); }
+        else primary();
+        m_nest--;
+    }
+
+    void primary()
+    {
+        if (m_pos >= m_text.size()) fail("expected a value");
+
+        if (accept("(")) {
+            logicalOr();
+            if (!accept(")")) fail("expected ')'");
+            return;
+        }
+
+        if (accept("[")) {
+            logicalOr();
+            if (!accept("]")) fail("expected ']'");
+            if (lastIsConst(1)) {
+                Op& op = m_code.back();
+                op.arg &= 0xFFFF;
+                if (op.arg <= 0x1FFF) {
+                    op.code = Code::PeekRam;
+                    op.arg &= 0x07FF;
+                } else {
+                    op.code = Code::PeekAbs;
+                }
+            } else {
+                emit(Code::Peek);
+            }
+            return;
+        }
+
+        char c = m_text[m_pos];
+        if (c == '$' || c == '%' || std::isdigit((unsigned char)c)) {
+            number();
+            return;
+        }
+
+        if (std::isalpha((unsigned char)c) || c == '_') {
+            identifier();
+            return;
+        }
+
+        fail("unexpected '" + std::string(1, c) + "'");
+    }
+
+    void number()
+    {
+        int base = 10;
+        if (m_text[m_pos] == '$') { base = 16; m_pos++; }
+        else if (m_text[m_pos] == '%') { base = 2; m_pos++; }
+        else if (m_text.compare(m_pos, 2, "0x") == 0 || m_text.compare(m_pos, 2, "0X") == 0) { base = 16; m_pos += 2; }
+
+        const size_t start = m_pos;
+        uint64_t v = 0;
+        while (m_pos < m_text.size()) {
+            int c = std::tolower((unsigned char)m_text[m_pos]);
+            int d = std::isdigit(c) ? c - '0' : (c >= 'a' && c <= 'f') ? c - 'a' + 10 : 99;
+            if (d >= base) break;
+            v = v * (uint64_t)base + (uint64_t)d;
+            if (v > 0xFFFFFFFFull) fail("number too large");
+            m_pos++;
+        }
+        if (m_pos == start) fail("expected digits");
+        if (m_pos < m_text.size() && (std::isalnum((unsigned char)m_text[m_pos]) || m_text[m_pos] == '_'))
+            fail("bad digit");
+
+        skipSpace();
+        emit(Code::Const, (int32_t)(uint32_t)v);
+    }
+
+    void identifier()
+    {
+        static const Name names[] = {
+            { "a", Code::RegA, 0 }, { "x", Code::RegX, 0 }, { "y", Code::RegY, 0 },
+            { "sp", Code::RegSP, 0 }, { "s", Code::RegSP, 0 }, { "p", Code::RegP, 0 }, { "pc", Code::RegPC, 0 },
+            { "c", Code::Flag, 0 }, { "z", Code::Flag, 1 }, { "i", Code::Flag, 2 }, { "d", Code::Flag, 3 },
+            { "v", Code::Flag, 6 }, { "n", Code::Flag, 7 },
+            { "scanline", Code::Scanline, 0 }, { "dot", Code::Dot, 0 }, { "cycle", Code::Dot, 0 },
+            { "frame", Code::Frame, 0 },
+            { "addr", Code::Addr, 0 }, { "value", Code::Value, 0 },
+        };
+
+        const size_t start = m_pos;
+        while (m_pos < m_text.size() && (std::isalnum((unsigned char)m_text[m_pos]) || m_text[m_pos] == '_')) m_pos++;
+        const std::string word = m_text.substr(start, m_pos - start);
+
+        for (const Name& n : names) {
+            if (!sameName(word, n.text)) continue;
+            skipSpace();
+            emit((Code)n.code, n.arg);
+            return;
+        }
+
+        m_pos = start;
+        fail("unknown name '" + word + "'");
+    }
+
+    const std::string& m_text;
+    std::vector<Op>& m_code;
+    size_t m_pos = 0;
+    int m_depth = 0;    // stack slots in use at this point of the code
+    int m_nest = 0;     // parser recursion
+    size_t m_jumpEnd = 0;   // target of the last short-circuit jump
+};
+
+int32_t Condition::fold(Code code, int32_t a, int32_t b)
+{
+    const uint32_t ua = (uint32_t)a, ub = (uint32_t)b;
+    switch (code) {
+    case Mul:    return (int32_t)(ua * ub);
+    case Add:    return (int32_t)(ua + ub);
+    case Sub:    return (int32_t)(ua - ub);
+    case Shl:    return (int32_t)(ua << (ub & 31));
+    case Shr:    return (int32_t)(ua >> (ub & 31));
+    case BitAnd: return a & b;
+    case BitXor: return a ^ b;
+    case BitOr:  return a | b;
+    case Eq:     return a == b;
+    case Ne:     return a != b;
+    case Lt:     return a < b;
+    case Le:     return a <= b;
+    case Gt:     return a > b;
+    case Ge:     return a >= b;
+    default:     return 0;
+    }
+}
+
+bool Condition::compile(const std::string& text, std::string* error)
+{
+    std::vector<Op> code;
+
+    bool blank = true;
+    for (char c : text) blank = blank && std::isspace((unsigned char)c);
+
+    if (!blank) {
+        try {
+            ConditionParser(text, code).parse();
+        } catch (const std::runtime_error& e) {
+            if (error) *error = e.what();
+            return false;
+        }
+    }
+
+    m_text = blank ? std::string() : text;
+    m_code = std::move(code);
+    return true;
+}
+
+void Condition::clear()
+{
+    m_text.clear();
+    m_code.clear();
+}
+
+int32_t Condition::evaluate(bus& b, uint16_t addr, uint8_t value) const
+{
+    int32_t stack[MAX_DEPTH];
+    int sp = -1;
+
+    const cpu& c = *b.connectedCPU;
+    const ppu& p = *b.connectedPPU;
+    const Op* code = m_code.data();
+    const size_t n = m_code.size();
+
+    for (size_t i = 0; i < n; i++) {
+        const Op& op = code[i];
+        int32_t v;
+
+        switch (op.code) {
+        case Const:    v = op.arg; break;
+        case RegA:     v = c.A; break;
+        case RegX:     v = c.X; break;
+        case RegY:     v = c.Y; break;
+        case RegSP:    v = c.SP; break;
+        case RegP:     v = c.P; break;
+        case RegPC:    v = c.PC; break;
+        case Flag:     v = (c.P >> op.arg) & 1; break;
+        case Scanline: v = p.scanline; break;
+        case Dot:      v = p.cycle; break;
+        case Frame:    v = (int32_t)p.frameCount; break;
+        case Addr:     v = addr; break;
+        case Value:    v = value; break;
+        case PeekAbs:  v = b.read((uint16_t)op.arg, true); break;
+        case PeekRam:  v = b.ram[(size_t)op.arg]; break;
+
+        case Peek: {
+            const uint16_t a = (uint16_t)stack[sp];
+            stack[sp] = a <= 0x1FFF ? b.ram[a & 0x07FF] : b.read(a, true);
+            continue;
+        }
+        case Neg:      stack[sp] = (int32_t)(0u - (uint32_t)stack[sp]); continue;
+        case Not:      stack[sp] = stack[sp] == 0; continue;
+        case BitNot:   stack[sp] = ~stack[sp]; continue;
+        case Bool:     stack[sp] = stack[sp] != 0; continue;
+
+        case JumpIfZero:
+            if (stack[sp] == 0) i = (size_t)op.arg - 1;
+            else sp--;
+            continue;
+        case JumpIfNonZero:
+            if (stack[sp] != 0) { stack[sp] = 1; i = (size_t)op.arg - 1; }
+            else sp--;
+            continue;
+
+        default:
+            sp--;
+            stack[sp] = fold(op.code, stack[sp], stack[sp + 1]);
+            continue;
+        }
+
+        stack[++sp] = op.cmp == None ? v : fold(op.cmp, v, op.imm);
+    }
+
+    return sp >= 0 ? stack[sp] : 1;
+}
+
+std::string Condition::dump() const
+{
+    static const char* names[] = {
+        "-",
+        "const", "a", "x", "y", "sp", "p", "pc", "flag",
+        "scanline", "dot", "frame", "addr", "value", "peek", "peek",
+        "peek", "neg", "not", "bitnot",
+        "mul", "add", "sub", "shl", "shr", "and", "xor", "or",
+        "eq", "ne", "lt", "le", "gt", "ge",
+        "jz", "jnz", "bool",
+    };
+
+    std::string out;
+    char line[64];
+    for (size_t i = 0; i < m_code.size(); i++) {
+        const Op& op = m_code[i];
+        int k = std::snprintf(line, sizeof(line), "%2zu %s", i, names[op.code]);
+
+        switch (op.code) {
+        case Const: case Flag: case JumpIfZero: case JumpIfNonZero:
+            k += std::snprintf(line + k, sizeof(line) - k, " %d", op.arg);
+            break;
+        case PeekAbs: case PeekRam:
+            k += std::snprintf(line + k, sizeof(line) - k, " $%04X", op.arg);
+            break;
+        default:
+            break;
+        }
+        if (op.cmp != None)
+            std::snprintf(line + k, sizeof(line) - k, " %s %d", names[op.cmp], op.imm);
+
+        out += line;
+        out += '\n';
+    }
+    return out;
+}
@@ -1,6 +1,11 @@
 // src/cpu.cpp
 #include "header/cpu.h"
 #include "header/Bus.h"
+#include "header/savestate.h"
+#include "header/tracelog.h"
+#include "header/profiler.h"
+#include "header/codedatalog.h"
+#include "header/eventlog.h"
 #include <iostream>
 #include <sstream>
 
@@ -177,6 +182,7 @@ uint8_t cpu::XXX() {
         << std::hex << prev_PC;
 
     std::cout << oss.str() << "\n";
+    if (trace) trace->fault(oss.str());
     throw std::runtime_error(oss.str());
 }
 
@@ -405,11 +411,15 @@ uint8_t cpu::ROL() {
 void cpu::clock() {
     if (cycles == 0) {
         // Fetch opcode at current PC
+        CdlFetch(bus_ptr->cdl, *bus_ptr, PC);
         opcode = read(PC);
         const Op& ins = lookup[opcode];
         prev_opcode = opcode;
         prev_PC = PC;
 
+        if (trace) trace->record(*this, opcode);
+        if (profiler) profiler->onInstruction(*this, opcode);
+
         //std::cout << ins.name << " - " << std::hex << (int)opcode << std::endl;
         // Run addressing mode (it will advance PC to next instruction by design)
         uint8_t add_cycles_addr = 0;
@@ -423,8 +433,12 @@ void cpu::clock() {
         cycles = ins.cycles + add_cycles_addr + add_cycles_op;
     }
 
-    // consume a cycle
-    if (cycles > 0) cycles--;
+    // consume a cycle; when the next instruction becomes due, exec
+    // watchpoints on its page trap now, so a break leaves it unexecuted
+    if (cycles > 0 && --cycles == 0) {
+        if (bus_ptr && (bus_ptr->trapPages[PC >> 8] & bus::TRAP_EXEC))
+            bus_ptr->trapExec(PC);
+    }
 }
 
 // stepInstruction: execute a single full instruction (blocking until cycles consumed)
@@ -444,10 +458,20 @@ void cpu::reset() {
     A = X = Y = 0x00;
     P = 0x24;
 
+    // Internal latches too, so a power cycle always starts from the same state
+    fetched = 0x00;
+    addr_abs = addr_rel = 0x0000;
+    opcode = 0x00;
+    prev_opcode = 0x00;
+    prev_PC = 0x0000;
+
     cycles = 8; // warmup cycles
 }
 
 void cpu::nmi() {
+    if (profiler) profiler->onInterrupt(*this, true);
+    EventSignal(bus_ptr->events, EventLog::Nmi);
+
     // Push PC to stack (high byte first)
     push((PC >> 8) & 0x00FF);
     push(PC & 0x00FF);
@@ -475,6 +499,9 @@ void cpu::irq() {
     // For your "call irq() every CPU tick" approach, only take it when ready.
     if (cycles != 0) return;
 
+    if (profiler) profiler->onInterrupt(*this, false);
+    EventSignal(bus_ptr->events, EventLog::Irq);
+
     // Push PC (high then low)
     push((PC >> 8) & 0x00FF);
     push(PC & 0x00FF);
@@ -768,6 +795,22 @@ uint8_t cpu::SED() {
     return 0;
 }
 
+cpu::AddrMode cpu::opMode(uint8_t opcode) const {
+    uint8_t (cpu::*mode)() = lookup[opcode].addrmode;
+    if (mode == &cpu::IMM) return AddrMode::IMM;
+    if (mode == &cpu::ZP0) return AddrMode::ZP0;
+    if (mode == &cpu::ZPX) return AddrMode::ZPX;
+    if (mode == &cpu::ZPY) return AddrMode::ZPY;
+    if (mode == &cpu::ABS) return AddrMode::ABS;
+    if (mode == &cpu::ABX) return AddrMode::ABX;
+    if (mode == &cpu::ABY) return AddrMode::ABY;
+    if (mode == &cpu::IND) return AddrMode::IND;
+    if (mode == &cpu::IZX) return AddrMode::IZX;
+    if (mode == &cpu::IZY) return AddrMode::IZY;
+    if (mode == &cpu::REL) return AddrMode::REL;
+    return AddrMode::IMP;
+}
+
 bool cpu::complete() {
     return cycles == 0;
 }
@@ -1016,6 +1059,34 @@ void cpu::buildLookup() {
 }
 
 
+// Save states: registers plus the in-flight instruction (remaining cycles etc.)
+void cpu::saveState(StateWriter& w) const {
+    w.pod(PC); w.pod(SP); w.pod(A); w.pod(X); w.pod(Y); w.pod(P);
+
+    w.pod(fetched);
+    w.pod(addr_abs);
+    w.pod(addr_rel);
+    w.pod(opcode);
+    w.pod(cycles);
+
+    w.pod(prev_opcode);
+    w.pod(prev_PC);
+}
+
+void cpu::loadState(StateReader& r) {
+    r.pod(PC); r.pod(SP); r.pod(A); r.pod(X); r.pod(Y); r.pod(P);
+
+    r.pod(fetched);
+    r.pod(addr_abs);
+    r.pod(addr_rel);
+    r.pod(opcode);
+    r.pod(cycles);
+
+    r.pod(prev_opcode);
+    r.pod(prev_PC);
+}
+
+
 // GUI helpers (unchanged logic, minor cleanup)
 void cpu::drawFlagsGui() const {
     auto draw = [&](const char* label, bool v) {
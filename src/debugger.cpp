@@ -0,0 +1,80 @@
+#include "header/debugger.h"
+#include "header/nes.h"
+
+namespace {
+
+constexpr uint8_t OP_JSR = 0x20;
+constexpr uint8_t OP_RTS = 0x60;
+constexpr uint8_t OP_RTI = 0x40;
+
+} // namespace
+
+void Debugger::stepInto(nes& n)
+{
+    m_goal = Goal::None;
+    do { n.BUS.clock(); } while (n.CPU.complete());
+    do { n.BUS.clock(); } while (!n.CPU.complete());
+}
+
+void Debugger::stepOver(nes& n)
+{
+    if (n.BUS.read(n.CPU.PC, true) != OP_JSR) {
+        stepInto(n);
+        return;
+    }
+
+    // Recursion returns to the same address at a deeper stack, so the depth counts too
+    m_goal = Goal::StepOver;
+    m_target = (uint16_t)(n.CPU.PC + 3);
+    m_sp = n.CPU.SP;
+    m_moved = false;
+}
+
+void Debugger::stepOut(nes& n)
+{
+    m_goal = Goal::StepOut;
+    m_sp = n.CPU.SP;
+    m_moved = false;
+}
+
+void Debugger::runTo(uint16_t addr)
+{
+    m_goal = Goal::RunTo;
+    m_target = addr;
+    m_moved = false;
+}
+
+bool Debugger::reached(const nes& n) const
+{
+    switch (m_goal) {
+    case Goal::StepOver:
+        return n.CPU.PC == m_target && n.CPU.SP >= m_sp;
+    case Goal::StepOut:
+        // Returns from calls made meanwhile (and from NMIs) leave SP at or below m_sp
+        return (n.CPU.prev_opcode == OP_RTS || n.CPU.prev_opcode == OP_RTI) && n.CPU.SP > m_sp;
+    case Goal::RunTo:
+        return n.CPU.PC == m_target;
+    default:
+        return false;
+    }
+}
+
+bool Debugger::run(nes& n)
+{
+    n.PPU.frame_complete = false;
+    n.BUS.breakRequested = false;
+
+    while (!n.PPU.frame_complete && !n.BUS.breakRequested) {
+        n.BUS.clock();
+
+        // Checked between instructions, once the CPU has left where the goal was set
+        if (!n.CPU.complete()) {
+            m_moved = true;
+        } else if (m_moved && reached(n)) {
+            m_goal = Goal::None;
+            n.BUS.breakRequested = true;
+            return true;
+        }
+    }
+    return false;
+}
@@ -0,0 +1,266 @@
+#include "header/disassembly.h"
+#include "header/nes.h"
+#include "header/mapper.h"
+#include "header/symbols.h"
+#include "header/hash.h"
+
+#include <algorithm>
+#include <cstdio>
+
+namespace {
+
+// Listed pages: RAM (not its mirrors), PRG-RAM, PRG-ROM
+struct Region {
+    uint16_t base;
+    uint16_t end;       // exclusive, 0 = $10000
+};
+
+constexpr Region REGIONS[] = {
+    { 0x0000, 0x0800 },
+    { 0x6000, 0x7000 }, { 0x7000, 0x8000 },
+    { 0x8000, 0x9000 }, { 0x9000, 0xA000 }, { 0xA000, 0xB000 }, { 0xB000, 0xC000 },
+    { 0xC000, 0xD000 }, { 0xD000, 0xE000 }, { 0xE000, 0xF000 }, { 0xF000, 0x0000 },
+};
+
+constexpr uint64_t ROM_KEY = 1ull << 48;
+
+uint8_t peek(nes& n, uint16_t addr)
+{
+    if (addr < 0x2000) return n.BUS.ram[addr & 0x07FF];
+    if (addr < 0x6000) return 0x00;
+    return n.BUS.read(addr, true);
+}
+
+uint8_t length(cpu::AddrMode mode)
+{
+    switch (mode) {
+    case cpu::AddrMode::IMP: return 1;
+    case cpu::AddrMode::ABS: case cpu::AddrMode::ABX: case cpu::AddrMode::ABY: case cpu::AddrMode::IND: return 3;
+    default: return 2;
+    }
+}
+
+// Cheats patch what peek() returns without touching the ROM, so a page with
+// a patch is also keyed by the bytes as seen; 0 for unpatched pages
+uint64_t patchedContent(nes& n, uint16_t base, uint32_t end)
+{
+    bool patched = false;
+    for (uint32_t page = base >> 8; page < end >> 8; page++)
+        patched = patched || (n.BUS.trapPages[page] & bus::TRAP_CHEAT);
+    if (!patched) return 0;
+
+    uint8_t bytes[0x1000];
+    for (uint32_t addr = base; addr < end; addr++) bytes[addr - base] = peek(n, (uint16_t)addr);
+    return Hash::Hash64(bytes, end - base) | 1;
+}
+
+} // namespace
+
+void Disassembly::clear()
+{
+    m_pages.clear();
+    m_spans.clear();
+    m_count = 0;
+}
+
+const Disassembly::Page& Disassembly::page(nes& n, uint16_t base, uint32_t end, const std::vector<uint16_t>& syncs)
+{
+    // ROM pages by the PRG offset mapped there; the rest by address and contents
+    uint64_t key = base;
+    uint64_t content = 0;
+    uint32_t offset = 0;
+    if (base >= 0x8000 && n.CART && n.CART->mapper && n.CART->mapper->cpuMapRead(base, offset)) {
+        key = ROM_KEY | ((uint64_t)offset << 16) | base;
+        content = patchedContent(n, base, end);
+    }
+    else if (base < 0x2000)
+        content = Hash::Hash64(n.BUS.ram.data(), n.BUS.ram.size());
+    else if (n.CART && n.CART->prgRam.size() >= end - 0x6000)
+        content = Hash::Hash64(n.CART->prgRam.data() + (base - 0x6000), end - base);
+
+    Page& p = m_pages[key];
+    bool valid = !p.lines.empty() && p.content == content;
+    for (uint16_t s : syncs)
+        valid = valid && startsLine(p, s);
+
+    if (valid) {
+        m_stats.pageHits++;
+        return p;
+    }
+
+    // Earlier sync points still hold unless the bytes changed
+    if (p.content != content) p.syncs.clear();
+    for (uint16_t s : syncs)
+        if (std::find(p.syncs.begin(), p.syncs.end(), s) == p.syncs.end()) p.syncs.push_back(s);
+    std::sort(p.syncs.begin(), p.syncs.end());
+
+    p.content = content;
+    decode(n, p, base, end);
+    m_stats.pagesDecoded++;
+    return p;
+}
+
+bool Disassembly::startsLine(const Page& p, uint16_t addr)
+{
+    auto it = std::lower_bound(p.lines.begin(), p.lines.end(), addr,
+                               [](const Line& l, uint16_t a) { return l.addr < a; });
+    return it != p.lines.end() && it->addr == addr;
+}
+
+void Disassembly::decode(nes& n, Page& p, uint16_t base, uint32_t end)
+{
+    p.lines.clear();
+
+    auto sync = p.syncs.begin();
+    uint32_t addr = base;
+    while (addr < end) {
+        while (sync != p.syncs.end() && *sync <= addr) ++sync;
+        const uint32_t limit = sync != p.syncs.end() ? std::min<uint32_t>(*sync, end) : end;
+
+        Line line;
+        line.addr = (uint16_t)addr;
+        line.bytes[0] = peek(n, (uint16_t)addr);
+
+        const char* name = n.CPU.opName(line.bytes[0]);
+        line.data = name[0] == 'X' && name[1] == 'X' && name[2] == 'X';
+        line.len = line.data ? 1 : length(n.CPU.opMode(line.bytes[0]));
+
+        // An instruction running into a sync point or the next page gives way
+        if (addr + line.len > limit) {
+            line.len = 1;
+            line.data = 1;
+        }
+
+        for (uint8_t i = 1; i < line.len; i++) line.bytes[i] = peek(n, (uint16_t)(addr + i));
+
+        p.lines.push_back(line);
+        addr += line.len;
+    }
+}
+
+void Disassembly::refresh(nes& n, uint16_t pc)
+{
+    m_spans.clear();
+    m_count = 0;
+
+    // Entry points the listing should always line up with
+    uint16_t entries[4] = { pc };
+    for (int v = 0; v < 3; v++)
+        entries[v + 1] = (uint16_t)(n.BUS.read((uint16_t)(0xFFFA + v * 2), true) |
+                                    (n.BUS.read((uint16_t)(0xFFFB + v * 2), true) << 8));
+
+    std::vector<uint16_t> syncs;
+    for (const Region& r : REGIONS) {
+        const uint32_t end = r.end == 0 ? 0x10000 : r.end;
+        if (r.base >= 0x6000 && r.base < 0x8000 && (!n.CART || n.CART->prgRam.size() < end - 0x6000))
+            continue;
+
+        syncs.clear();
+        for (uint16_t e : entries)
+            if (e >= r.base && e < end) syncs.push_back(e);
+
+        const Page& p = page(n, r.base, end, syncs);
+        m_spans.push_back(Span{ &p, m_count });
+        m_count += p.lines.size();
+    }
+}
+
+const Disassembly::Line& Disassembly::line(size_t i) const
+{
+    auto it = std::upper_bound(m_spans.begin(), m_spans.end(), i,
+                               [](size_t k, const Span& s) { return k < s.first; });
+    const Span& s = *(it - 1);
+    return s.page->lines[i - s.first];
+}
+
+size_t Disassembly::find(uint16_t addr) const
+{
+    if (m_count == 0) return 0;
+
+    // Last span starting at or before addr
+    size_t k = 0;
+    for (size_t i = 0; i < m_spans.size(); i++) {
+        const Page& p = *m_spans[i].page;
+        if (!p.lines.empty() && p.lines.front().addr <= addr) k = i;
+    }
+
+    const Span& s = m_spans[k];
+    const std::vector<Line>& lines = s.page->lines;
+    auto it = std::upper_bound(lines.begin(), lines.end(), addr,
+                               [](uint16_t a, const Line& l) { return a < l.addr; });
+    return s.first + (it == lines.begin() ? 0 : (size_t)(it - lines.begin()) - 1);
+}
+
+Disassembly::Stats Disassembly::stats() const
+{
+    Stats s = m_stats;
+    s.cachedPages = m_pages.size();
+    return s;
+}
+
+bool Disassembly::target(const nes& n, const Line& line, uint16_t& addr)
+{
+    if (line.data) return false;
+
+    const uint8_t op = line.bytes[0];
+    if (op == 0x4C || op == 0x20) {     // JMP abs, JSR
+        addr = (uint16_t)(line.bytes[1] | (line.bytes[2] << 8));
+        return true;
+    }
+    if (n.CPU.opMode(op) == cpu::AddrMode::REL) {
+        addr = (uint16_t)(line.addr + 2 + (int8_t)line.bytes[1]);
+        return true;
+    }
+    return false;
+}
+
+std::string Disassembly::format(const nes& n, const Line& line, const Symbols* symbols)
+{
+    char text[96];
+
+    if (line.data) {
+        std::snprintf(text, sizeof(text), ".db $%02X", line.bytes[0]);
+        return text;
+    }
+
+    const uint8_t op = line.bytes[0];
+    const uint8_t lo = line.bytes[1];
+    const uint16_t word = (uint16_t)(lo | (line.bytes[2] << 8));
+    const char* name = n.CPU.opName(op);
+
+    // Operand address as a label when there is one
+    char where[64];
+    auto label = [&](uint16_t addr, bool zp) {
+        const std::string* s = symbols ? symbols->find(n.CART.get(), addr) : nullptr;
+        if (s)       std::snprintf(where, sizeof(where), "%s", s->c_str());
+        else if (zp) std::snprintf(where, sizeof(where), "$%02X", addr);
+        else         std::snprintf(where, sizeof(where), "$%04X", addr);
+        return where;
+    };
+
+    switch (n.CPU.opMode(op)) {
+    case cpu::AddrMode::IMP:
+        if (op == 0x0A || op == 0x2A || op == 0x4A || op == 0x6A)
+            std::snprintf(text, sizeof(text), "%s A", name);
+        else
+            std::snprintf(text, sizeof(text), "%s", name);
+        break;
+    case cpu::AddrMode::IMM:
+        if (op == 0x00) std::snprintf(text, sizeof(text), "%s", name);
+        else            std::snprintf(text, sizeof(text), "%s #$%02X", name, lo);
+        break;
+    case cpu::AddrMode::ZP0: std::snprintf(text, sizeof(text), "%s %s", name, label(lo, true)); break;
+    case cpu::AddrMode::ZPX: std::snprintf(text, sizeof(text), "%s %s,X", name, label(lo, true)); break;
+    case cpu::AddrMode::ZPY: std::snprintf(text, sizeof(text), "%s %s,Y", name, label(lo, true)); break;
+    case cpu::AddrMode::ABS: std::snprintf(text, sizeof(text), "%s %s", name, label(word, false)); break;
+    case cpu::AddrMode::ABX: std::snprintf(text, sizeof(text), "%s %s,X", name, label(word, false)); break;
+    case cpu::AddrMode::ABY: std::snprintf(text, sizeof(text), "%s %s,Y", name, label(word, false)); break;
+    case cpu::AddrMode::IND: std::snprintf(text, sizeof(text), "%s (%s)", name, label(word, false)); break;
+    case cpu::AddrMode::IZX: std::snprintf(text, sizeof(text), "%s (%s,X)", name, label(lo, true)); break;
+    case cpu::AddrMode::IZY: std::snprintf(text, sizeof(text), "%s (%s),Y", name, label(lo, true)); break;
+    case cpu::AddrMode::REL:
+        std::snprintf(text, sizeof(text), "%s %s", name, label((uint16_t)(line.addr + 2 + (int8_t)lo), false));
+        break;
+    }
+    return text;
+}
@@ -0,0 +1,152 @@
+#include "header/eventlog.h"
+#include "header/nes.h"
+#include "header/mapper.h"
+
+#include <algorithm>
+
+namespace {
+
+constexpr uint32_t UNMAPPED = 0xFFFFFFFF;
+
+bool isMapperRegister(uint16_t addr)
+{
+    // $6000-$7FFF is PRG-RAM on every mapper here
+    return (addr >= 0x4020 && addr < 0x6000) || addr >= 0x8000;
+}
+
+} // namespace
+
+EventLog::EventLog()
+    : m_current(CAPACITY), m_shown(CAPACITY)
+{
+}
+
+EventLog::~EventLog()
+{
+    attach(nullptr);
+}
+
+void EventLog::attach(nes* n)
+{
+    if (m_nes && m_nes != n) {
+        m_nes->BUS.events = nullptr;
+        m_nes->PPU.events = nullptr;
+    }
+    m_nes = n;
+    m_ppu = n ? &n->PPU : nullptr;
+    reset();
+    setRunning(n != nullptr);
+}
+
+void EventLog::setRunning(bool running)
+{
+    if (!m_nes) return;
+    EventLog* self = running ? this : nullptr;
+    m_nes->BUS.events = self;
+    m_nes->PPU.events = self;
+}
+
+bool EventLog::running() const
+{
+    return m_nes && m_nes->BUS.events == this;
+}
+
+void EventLog::reset()
+{
+    m_count = m_shownCount = 0;
+    m_counters = m_shownCounters = m_totals = Counters();
+    m_frames = 0;
+}
+
+const char* EventLog::typeName(Type type)
+{
+    switch (type) {
+    case PpuRead:     return "PPU read";
+    case PpuWrite:    return "PPU write";
+    case IoRead:      return "APU/IO read";
+    case IoWrite:     return "APU/IO write";
+    case OamDma:      return "OAM DMA";
+    case MapperWrite: return "Mapper write";
+    case BankSwitch:  return "Bank switch";
+    case Nmi:         return "NMI";
+    case Irq:         return "IRQ";
+    case DmcDma:      return "DMC DMA";
+    case Sprite0Hit:  return "Sprite 0 hit";
+    default:          return "?";
+    }
+}
+
+void EventLog::record(Type type, uint16_t addr, uint8_t value)
+{
+    m_counters.events[type]++;
+    if (m_count == CAPACITY) {
+        m_counters.dropped++;
+        return;
+    }
+
+    Event& e = m_current[m_count++];
+    e.addr = addr;
+    e.value = value;
+    e.type = type;
+    e.scanline = (int16_t)m_ppu->scanline;
+    e.dot = (int16_t)m_ppu->cycle;
+}
+
+void EventLog::onWrite(uint16_t addr, uint8_t value)
+{
+    if (addr >= 0x2000 && addr < 0x4000)
+        record(PpuWrite, (uint16_t)(0x2000 | (addr & 7)), value);
+    else if (addr == 0x4014)
+        record(OamDma, addr, value);
+    else if (addr >= 0x4000 && addr < 0x4018)
+        record(IoWrite, addr, value);
+    else if (isMapperRegister(addr))
+        readBanks(m_banks);
+}
+
+void EventLog::onMapperWrite(uint16_t addr, uint8_t value)
+{
+    if (!isMapperRegister(addr)) return;
+    record(MapperWrite, addr, value);
+
+    uint32_t banks[WINDOWS];
+    readBanks(banks);
+    for (int i = 0; i < WINDOWS; i++) {
+        if (banks[i] == m_banks[i]) continue;
+        const bool prg = i < 4;
+        const uint16_t window = prg ? (uint16_t)(0x8000 + i * 0x2000) : (uint16_t)((i - 4) * 0x400);
+        const uint8_t bank = banks[i] == UNMAPPED ? 0xFF : (uint8_t)(banks[i] / (prg ? 0x2000 : 0x400));
+        record(BankSwitch, window, bank);
+    }
+}
+
+void EventLog::readBanks(uint32_t* banks) const
+{
+    std::fill(banks, banks + WINDOWS, UNMAPPED);
+    const cartridge* cart = m_nes ? m_nes->CART.get() : nullptr;
+    if (!cart || !cart->mapper) return;
+
+    for (int i = 0; i < 4; i++) {
+        uint32_t offset = 0;
+        if (cart->mapper->cpuMapRead((uint16_t)(0x8000 + i * 0x2000), offset)) banks[i] = offset;
+    }
+    for (int i = 0; i < 8; i++) {
+        uint32_t offset = 0;
+        if (cart->mapper->ppuMapPeek((uint16_t)(i * 0x400), offset)) banks[4 + i] = offset;
+    }
+}
+
+void EventLog::endFrame()
+{
+    std::swap(m_current, m_shown);
+    m_shownCount = m_count;
+    m_shownCounters = m_counters;
+
+    for (int t = 0; t < TypeCount; t++) m_totals.events[t] += m_counters.events[t];
+    m_totals.dmaCycles += m_counters.dmaCycles;
+    m_totals.dropped += m_counters.dropped;
+    m_frames++;
+
+    m_count = 0;
+    m_counters = Counters();
+}
@@ -0,0 +1,97 @@
+#include "header/fingerprint.h"
+#include "header/nes.h"
+#include "header/savestate.h"
+#include "header/mapper.h"
+
+#include <vector>
+
+namespace {
+
+uint64_t sumRegion(Fingerprint::Region region, const uint8_t* data, size_t n)
+{
+    uint64_t sum = 0;
+    for (size_t i = 0; i < n; i++)
+        sum += Fingerprint::Term(region, (uint32_t)i, data[i]);
+    return sum;
+}
+
+// Everything in the save state but the memories and the per-scanline dbg_*
+// records (both in the incremental sum). TransitionCache applies deltas to
+// whole states keyed on this value, so any byte left out of both could
+// differ between two states with the same fingerprint.
+void writeRegisters(const nes& n, StateWriter& w)
+{
+    n.CPU.saveState(w);
+    n.APU.saveState(w);
+
+    const ppu& p = n.PPU;
+    w.pod(p.PPUCTRL);
+    w.pod(p.PPUMASK);
+    w.pod(p.PPUSTATUS);
+    w.pod(p.OAMADDR);
+    w.pod(p.addr_latch);
+    w.pod(p.data_buffer);
+    w.pod(p.fine_x);
+    w.pod(p.vram_addr.reg);
+    w.pod(p.tram_addr.reg);
+    w.pod(p.scanline);
+    w.pod(p.cycle);
+    w.pod(p.frame_complete);
+    w.pod(p.nmi);
+    w.pod(p.sprite0_hit_pending);
+    w.pod(p.sprite0_hit_x);
+    w.pod(p.sprite0_hit_y);
+
+    n.BUS.saveRegisters(w);
+
+    if (n.CART) {
+        uint8_t mir = (uint8_t)n.CART->mirror;
+        w.pod(mir);
+        if (n.CART->mapper) n.CART->mapper->saveState(w);
+    }
+}
+
+} // namespace
+
+uint64_t Fingerprint::ScanlineTerm(const ppu& p, int y)
+{
+    const uint64_t record[3] = {
+        (uint64_t)(uint32_t)p.dbg_scrollX[y] | ((uint64_t)(uint32_t)p.dbg_scrollY[y] << 32),
+        (uint64_t)(uint32_t)p.dbg_baseNTX[y] | ((uint64_t)(uint32_t)p.dbg_baseNTY[y] << 32),
+        (uint64_t)p.dbg_bgPatternBase[y] | ((uint64_t)p.dbg_sprPatternBase[y] << 16) |
+            ((uint64_t)p.dbg_sprite8x16[y] << 32) | ((uint64_t)y << 40)
+    };
+    return Hash::Hash64(reinterpret_cast<const uint8_t*>(record), sizeof(record), 0x5C4E);
+}
+
+void Fingerprint::rebuild(const nes& n)
+{
+    uint64_t sum = 0;
+    sum += sumRegion(CpuRam,  n.BUS.ram.data(), n.BUS.ram.size());
+    sum += sumRegion(Vram,    n.PPU.vram.data(), n.PPU.vram.size());
+    sum += sumRegion(Palette, n.PPU.palette.data(), n.PPU.palette.size());
+    sum += sumRegion(Oam,     n.PPU.OAM.data(), n.PPU.OAM.size());
+    for (int y = 0; y < 240; y++)
+        sum += ScanlineTerm(n.PPU, y);
+
+    if (n.CART) {
+        sum += sumRegion(PrgRam, n.CART->prgRam.data(), n.CART->prgRam.size());
+        sum += sumRegion(ChrRam, n.CART->chrRam.data(), n.CART->chrRam.size());
+    }
+
+    m_memory = sum;
+}
+
+uint64_t Fingerprint::value(const nes& n) const
+{
+    uint8_t small[2048];
+    StateWriter w(small, sizeof(small));
+    writeRegisters(n, w);
+    if (w.ok()) return Hash::Hash64(small, w.size(), m_memory);
+
+    // Unusually large mapper state
+    std::vector<uint8_t> big(w.size());
+    StateWriter w2(big.data(), big.size());
+    writeRegisters(n, w2);
+    return Hash::Hash64(big.data(), big.size(), m_memory);
+}
@@ -0,0 +1,166 @@
+#include "header/hash.h"
+#include <array>
+#include <cstring>
+
+#if defined(__ARM_FEATURE_CRC32)
+#include <arm_acle.h>
+#endif
+
+namespace {
+
+// t[0] is the usual byte table; t[k][i] is t[0][i] pushed through k more
+// zero bytes, so eight table lookups consume eight input bytes at once
+std::array<std::array<uint32_t, 256>, 8> makeCrcTables()
+{
+    std::array<std::array<uint32_t, 256>, 8> t{};
+    for (uint32_t i = 0; i < 256; i++) {
+        uint32_t c = i;
+        for (int k = 0; k < 8; k++)
+            c = (c & 1) ? (0xEDB88320u ^ (c >> 1)) : (c >> 1);
+        t[0][i] = c;
+    }
+    for (uint32_t i = 0; i < 256; i++)
+        for (int k = 1; k < 8; k++)
+            t[k][i] = t[0][t[k - 1][i] & 0xFF] ^ (t[k - 1][i] >> 8);
+    return t;
+}
+
+const std::array<std::array<uint32_t, 256>, 8> crcTables = makeCrcTables();
+
+inline uint64_t rotl(uint64_t x, int r) { return (x << r) | (x >> (64 - r)); }
+inline uint32_t rotl32(uint32_t x, int r) { return (x << r) | (x >> (32 - r)); }
+
+inline uint32_t loadBE32(const uint8_t* p)
+{
+    return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | p[3];
+}
+
+} // namespace
+
+namespace Hash {
+
+uint32_t Crc32(const uint8_t* data, size_t n, uint32_t crc)
+{
+    crc = ~crc;
+    size_t i = 0;
+
+#if defined(__ARM_FEATURE_CRC32)
+    for (; i + 8 <= n; i += 8) {
+        uint64_t w;
+        std::memcpy(&w, data + i, 8);
+        crc = __crc32d(crc, w);
+    }
+#else
+    const auto& t = crcTables;
+    for (; i + 8 <= n; i += 8) {
+        // Little-endian byte order of the two words, independent of the host
+        const uint8_t* p = data + i;
+        const uint32_t lo = crc ^ ((uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24));
+        crc = t[7][lo & 0xFF] ^ t[6][(lo >> 8) & 0xFF] ^ t[5][(lo >> 16) & 0xFF] ^ t[4][lo >> 24] ^
+              t[3][p[4]] ^ t[2][p[5]] ^ t[1][p[6]] ^ t[0][p[7]];
+    }
+#endif
+
+    for (; i < n; i++)
+        crc = crcTables[0][(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+    return ~crc;
+}
+
+uint64_t Hash64(const uint8_t* data, size_t n, uint64_t seed)
+{
+    const uint64_t P1 = 0x9E3779B185EBCA87ull;
+    const uint64_t P2 = 0xC2B2AE3D27D4EB4Full;
+
+    uint64_t h = seed ^ (n * P1);
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        uint64_t w;
+        std::memcpy(&w, data + i, 8);
+        h ^= rotl(w * P2, 31) * P1;
+        h = rotl(h, 27) * P1 + P2;
+    }
+
+    uint64_t tail = 0;
+    std::memcpy(&tail, data + i, n - i);
+    h ^= rotl(tail * P2, 31) * P1;
+
+    return Mix64(h);
+}
+
+Sha1::Sha1()
+    : m_h{ 0x67452301u, 0xEFCDAB89u, 0x98BADCFEu, 0x10325476u, 0xC3D2E1F0u }
+{
+}
+
+void Sha1::update(const uint8_t* data, size_t n)
+{
+    m_total += n;
+
+    if (m_used) {
+        const size_t take = n < 64 - m_used ? n : 64 - m_used;
+        std::memcpy(m_buf + m_used, data, take);
+        m_used += take;
+        data += take;
+        n -= take;
+        if (m_used < 64) return;
+        block(m_buf);
+        m_used = 0;
+    }
+
+    for (; n >= 64; data += 64, n -= 64)
+        block(data);
+
+    std::memcpy(m_buf, data, n);
+    m_used = n;
+}
+
+Sha1::Digest Sha1::finish()
+{
+    const uint64_t bits = m_total * 8;
+
+    static const uint8_t pad[64] = { 0x80 };
+    update(pad, m_used < 56 ? 56 - m_used : 120 - m_used);
+
+    uint8_t length[8];
+    for (int i = 0; i < 8; i++) length[i] = (uint8_t)(bits >> (56 - 8 * i));
+    update(length, 8);
+
+    Digest d;
+    for (int i = 0; i < 5; i++)
+        for (int k = 0; k < 4; k++) d[i * 4 + k] = (uint8_t)(m_h[i] >> (24 - 8 * k));
+    return d;
+}
+
+void Sha1::block(const uint8_t* p)
+{
+    uint32_t w[80];
+    for (int i = 0; i < 16; i++) w[i] = loadBE32(p + i * 4);
+    for (int i = 16; i < 80; i++) w[i] = rotl32(w[i - 3] ^ w[i - 8] ^ w[i - 14] ^ w[i - 16], 1);
+
+    uint32_t a = m_h[0], b = m_h[1], c = m_h[2], d = m_h[3], e = m_h[4];
+
+    // Five rounds per step with the variables renamed instead of shuffled
+#define SHA1_STEP(F, K, i)                                              \
+    e += rotl32(a, 5) + F(b, c, d) + K + w[i];     b = rotl32(b, 30);  \
+    d += rotl32(e, 5) + F(a, b, c) + K + w[i + 1]; a = rotl32(a, 30);  \
+    c += rotl32(d, 5) + F(e, a, b) + K + w[i + 2]; e = rotl32(e, 30);  \
+    b += rotl32(c, 5) + F(d, e, a) + K + w[i + 3]; d = rotl32(d, 30);  \
+    a += rotl32(b, 5) + F(c, d, e) + K + w[i + 4]; c = rotl32(c, 30);
+#define SHA1_CH(x, y, z)  ((x & y) | (~x & z))
+#define SHA1_XOR(x, y, z) (x ^ y ^ z)
+#define SHA1_MAJ(x, y, z) ((x & y) | (x & z) | (y & z))
+
+    for (int i = 0; i < 20; i += 5)  { SHA1_STEP(SHA1_CH, 0x5A827999u, i) }
+    for (int i = 20; i < 40; i += 5) { SHA1_STEP(SHA1_XOR, 0x6ED9EBA1u, i) }
+    for (int i = 40; i < 60; i += 5) { SHA1_STEP(SHA1_MAJ, 0x8F1BBCDCu, i) }
+    for (int i = 60; i < 80; i += 5) { SHA1_STEP(SHA1_XOR, 0xCA62C1D6u, i) }
+
+#undef SHA1_STEP
+#undef SHA1_CH
+#undef SHA1_XOR
+#undef SHA1_MAJ
+
+    m_h[0] += a; m_h[1] += b; m_h[2] += c; m_h[3] += d; m_h[4] += e;
+}
+
+} // namespace Hash
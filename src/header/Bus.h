@@ -8,6 +8,13 @@ class cpu;
 class ppu;
 class apu;
 class cartridge;
+class Fingerprint;
+class Watchpoints;
+class CodeDataLog;
+class EventLog;
+class Cheats;
+class StateWriter;
+class StateReader;
 
 
 class bus {
@@ -46,7 +53,46 @@ public:
 
     void reset();
 
+    // Save states
+    void saveState(StateWriter& w) const;
+    void loadState(StateReader& r);
+
+    // Everything saveState() writes except RAM (for Fingerprint)
+    void saveRegisters(StateWriter& w) const;
+
+    // Write hook target; null unless nes::setFingerprinting(true)
+    Fingerprint* fingerprint = nullptr;
+
+    // Code/data logger hook target; null unless a CodeDataLog is attached
+    CodeDataLog* cdl = nullptr;
+
+    // Event viewer hook target; null unless an EventLog is attached
+    EventLog* events = nullptr;
+
+    // Traps per 256-byte CPU page: watchpoints (Watchpoints::Access bits)
+    // and cheat patches. Only accesses to a page with a bit set leave the
+    // fast path.
+    static constexpr uint8_t TRAP_READ  = 0x01;
+    static constexpr uint8_t TRAP_WRITE = 0x02;
+    static constexpr uint8_t TRAP_EXEC  = 0x04;
+    static constexpr uint8_t TRAP_CHEAT = 0x08;
+    static constexpr uint8_t TRAP_WATCH = TRAP_READ | TRAP_WRITE | TRAP_EXEC;
+    std::array<uint8_t, 256> trapPages{};
+    Watchpoints* watchpoints = nullptr;
+    Cheats* cheats = nullptr;
+
+    // Set by a breaking watchpoint; nes::runFrame() returns early
+    bool breakRequested = false;
+
+    // Exec trap slow path (the CPU is about to run the instruction at pc)
+    void trapExec(uint16_t pc);
+
+    // Master clock ticks since power-on (three per CPU cycle)
+    uint64_t clocks() const { return systemClockCounter; }
+
 private:
+    uint8_t readMemory(uint16_t addr, bool readonly);
+
     uint64_t systemClockCounter = 0;
 
     bool     dma_transfer = false;
@@ -54,6 +100,7 @@ private:
     uint8_t  dma_page     = 0x00;
     uint8_t  dma_addr     = 0x00;
     uint8_t  dma_data     = 0x00;
+    uint64_t dma_cycle    = 0;     // CPU-cycle parity used to align DMA reads/writes
 };
 
 #endif
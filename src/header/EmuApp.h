@@ -1,17 +1,29 @@
 #pragma once
+#include <exception>
 #include <memory>
 #include <string>
+#include <vector>
 
 struct GLFWwindow;
 
-#include "cpu.h"
-#include "Bus.h"
-#include "ppu.h"
-#include "apu.h"
-#include "cartridge.h"
-#include "Keybinds.h"
+#include "nes.h"
+#include "KeyBinds.h"
 #include "GLTextures.h"
 #include "AudioOut.h"
+#include "RewindBuffer.h"
+#include "Movie.h"
+#include "MovieIndex.h"
+#include "watchpoints.h"
+#include "debugger.h"
+#include "disassembly.h"
+#include "symbols.h"
+#include "tracelog.h"
+#include "profiler.h"
+#include "codedatalog.h"
+#include "eventlog.h"
+#include "memoryview.h"
+#include "cheats.h"
+#include "romlibrary.h"
 
 class EmuApp {
 public:
@@ -31,18 +43,40 @@ private:
     void drawPanels();
 
     void tickEmulation();
+    void emulateFrame();
+    void runAhead();
+
+    bool saveStateSlot(int slot);
+    bool loadStateSlot(int slot);
+
+    void resetGame();
+    void drawMovieMenu();
+    void replayMovieHeadless();
+
+    void drawWatchpoints();
+    void drawDebugger();
+    void loadSymbols();
+    void drawTraceLogger();
+    void emulationFault(const std::exception& e);
+    void drawProfiler();
+    void drawCodeDataLog();
+    void drawEventViewer();
+    void drawMemoryEditor();
+    void drawCheats();
+    void saveCheats();
+    void drawLibrary();
 
 private:
     GLFWwindow* window = nullptr;
 
-    cpu CPU;
-    ppu PPU;
-    bus BUS;
-    apu APU;
+    nes NES;
+    cpu& CPU = NES.CPU;
+    ppu& PPU = NES.PPU;
+    bus& BUS = NES.BUS;
+    apu& APU = NES.APU;
 
     AudioOut audio;
 
-    std::unique_ptr<cartridge> CART;
     std::string loadedRomPath;
 
     Keybinds binds;
@@ -58,9 +92,118 @@ private:
     bool showMemory = false;
     bool showStack = false;
     bool showPPU = true;
-    bool showVRAM = false;
     bool showPattern = true;
     bool showAPU = false;
+    bool showRewind = false;
+    bool showRunAhead = false;
+    bool showMovie = false;
+    bool showWatchpoints = false;
+    bool showDebugger = false;
+    bool showTraceLogger = false;
+    bool showProfiler = false;
+    bool showCodeDataLog = false;
+    bool showEventViewer = false;
+    bool showCheats = false;
+    bool showLibrary = false;
+
+    int stateSlot = 1;
+
+    // rewind
+    RewindBuffer rewind;
+    bool rewindEnabled = true;
+    bool rewinding = false;
+    int  rewindBudgetMB = 64;
+
+    // run-ahead
+    int  runAheadFrames = 0;
+    bool runAheadSecondInstance = false;
+    std::unique_ptr<nes> runAheadNes;     // second instance (keeps audio continuous)
+    std::vector<uint8_t> runAheadState;
+    bool frameRendered = false;           // PPU.frame already holds the frame to present
+
+    // input movie
+    Movie movie;
+    uint8_t movieFlags = 0x00;            // reset/power events for the next recorded frame
+    std::string movieStatus;
+    MovieIndex movieIndex;
+    int movieIndexBudgetMB = 32;
+    int movieSeekFrame = 0;
+
+    // watchpoints (detached while a movie runs: a mid-frame stop would desync it)
+    Watchpoints watchpoints;
+    char watchRange[16] = "0000";
+    bool watchRead = false;
+    bool watchWrite = true;
+    bool watchExec = false;
+    bool watchBreak = true;
+    char watchCondition[128] = "";
+    std::string watchError;
+    int  watchEditId = 0;                  // watch whose condition is being edited
+    char watchEditCondition[128] = "";
+
+    // debugger window
+    Debugger debugger;
+    Disassembly disassembly;
+    Symbols symbols;
+    bool debuggerFollowPC = true;
+    int  debuggerCursor = -1;             // selected address, -1 = none
+    uint16_t debuggerShownPC = 0;         // PC the listing last scrolled to
+    int  debuggerScrollTo = -1;           // address to bring into view next frame
+
+    // cheats (kept in <rom base>.cht)
+    Cheats cheats;
+    char cheatCode[32] = "";
+    char cheatName[64] = "";
+    std::string cheatStatus;
+
+    // ROM library (index in libraryPath, rescanned in the background at start)
+    RomLibrary romLibrary;
+    std::string libraryPath = "romlibrary.idx";
+    char libraryFolder[256] = "";
+    char librarySearch[64] = "";
+    int  libraryMapper = -1;              // -1 = any
+    bool libraryPlayable = false;
+    std::vector<RomLibrary::Entry> libraryRows;
+    uint64_t libraryRowsGeneration = UINT64_MAX;
+    RomLibrary::Filter libraryRowsFilter; // filter libraryRows was made with
+    std::string libraryStatus;
+
+    // memory editor
+    MemoryView memoryView;
+    int  memorySpace = 0;                 // MemoryView::Space
+    char memoryGoto[8] = "";
+    bool memoryFollowPC = false;
+    uint16_t memoryShownPC = 0;
+    int  memoryScrollTo = -1;             // address to bring into view next frame
+    int  memoryEdit = -1;                 // address being edited, -1 = none
+    char memoryEditText[3] = "";
+    bool memoryEditFocus = false;
+
+    // trace logger (flight recorder unless streaming to a file)
+    TraceLog traceLog;
+    char tracePath[256] = "trace.bin";
+    int  traceFormat = 0;                 // TraceLog::Format
+    std::string traceStatus;
+    std::string emuFault;                 // what stopped emulation, if it threw
+
+    // guest code profiler (off until started from its window)
+    Profiler profiler;
+    int profilerBankSize = 0;             // index into 8/16/32 KB
+    std::string profilerStatus;
+
+    // code/data logger (off until started; saves <rom>.cdl)
+    CodeDataLog cdl;
+    std::string cdlStatus;
+
+    // event viewer (off until started; shows the last complete frame)
+    EventLog eventLog;
+    bool eventShown[EventLog::TypeCount] = { true, true, true, true, true, true, true, true, true, true, true };
+    bool eventPicture = true;             // frame under the grid
+
+    // per-frame cost telemetry (smoothed, milliseconds)
+    double frameCostMs = 0.0;
+    double stateCostMs = 0.0;
+    double runAheadCostMs = 0.0;
 
     // timing
     double lastTime = 0.0;
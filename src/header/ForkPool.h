@@ -0,0 +1,52 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+class nes;
+class RomImage;
+
+// Forks many child consoles from one paused parent state, for bots and
+// search that try a different input sequence in every child.
+//
+// setParent() serializes the parent once; the snapshot and the ROM image
+// are shared read-only by every child. A fork takes a recycled instance
+// and restores the snapshot into it, so the cost is a state load (a few
+// microseconds) rather than building a console. Children are independent
+// and can run on any thread; dropping the last reference returns a child
+// to the pool.
+class ForkPool {
+public:
+    struct MemoryReport {
+        size_t romBytes = 0;        // ROM image, shared by parent and children
+        size_t snapshotBytes = 0;   // fork point, shared by all children
+        size_t childBytes = 0;      // owned by each child (nes::instanceBytes)
+        size_t childStateBytes = 0; // part of that which diverges from the fork point
+        size_t liveChildren = 0;
+        size_t pooledChildren = 0;  // idle instances kept for reuse
+    };
+
+    ForkPool();
+    ~ForkPool();
+
+    ForkPool(const ForkPool&) = delete;
+    ForkPool& operator=(const ForkPool&) = delete;
+
+    // New fork point. Children forked before keep running from the old one.
+    bool setParent(const nes& parent);
+
+    // A child at the fork point, or null when there is no parent.
+    // Thread-safe, like dropping a child.
+    std::shared_ptr<nes> fork();
+
+    // Instances made ahead of time, so the first forks are as fast as the rest
+    void reserve(size_t children);
+
+    MemoryReport memory() const;
+
+private:
+    struct Shared;
+    std::shared_ptr<Shared> m_shared;
+};
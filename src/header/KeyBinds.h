@@ -29,6 +29,9 @@ struct Keybinds {
     ImGuiKey runGame;
     ImGuiKey resetGame;
     ImGuiKey stepGame;
+    ImGuiKey saveState;
+    ImGuiKey loadState;
+    ImGuiKey rewind;      // hold
 
     static Keybinds Defaults() {
         Keybinds k{};
@@ -44,6 +47,9 @@ struct Keybinds {
         k.runGame   = ImGuiKey_F5;
         k.resetGame = ImGuiKey_F1;
         k.stepGame = ImGuiKey_F6;
+        k.saveState = ImGuiKey_F2;
+        k.loadState = ImGuiKey_F3;
+        k.rewind    = ImGuiKey_Backspace;
         return k;
     }
 };
@@ -63,6 +69,9 @@ inline bool SaveKeybinds(const Keybinds& k, const std::string& path) {
     out << "runGame=" << (int)k.runGame << "\n";
     out << "resetGame=" << (int)k.resetGame << "\n";
     out << "stepGame=" << (int)k.stepGame << "\n";
+    out << "saveState=" << (int)k.saveState << "\n";
+    out << "loadState=" << (int)k.loadState << "\n";
+    out << "rewind=" << (int)k.rewind << "\n";
     return true;
 }
 
@@ -84,7 +93,10 @@ inline bool LoadKeybinds(Keybinds& k, const std::string& path) {
         {"select", &k.select},
         {"runGame", &k.runGame},
         {"resetGame", &k.resetGame},
-        {"stepGame", &k.stepGame}
+        {"stepGame", &k.stepGame},
+        {"saveState", &k.saveState},
+        {"loadState", &k.loadState},
+        {"rewind", &k.rewind}
     };
 
     std::string line;
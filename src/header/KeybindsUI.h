@@ -1,6 +1,6 @@
 #pragma once
 #include <string>
-#include "Keybinds.h"
+#include "KeyBinds.h"
 
 namespace KeybindsUI {
     // Call once early
@@ -0,0 +1,95 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <vector>
+
+class nes;
+class cartridge;
+
+// Deterministic input movie.
+// A movie is an anchor (power-on or an embedded save state) plus one record
+// per emulated frame: both controller bytes and reset/power events. Playing
+// it back from the anchor reproduces the recording bit for bit.
+class Movie {
+public:
+    enum class Anchor : uint8_t { PowerOn = 0, SaveState = 1 };
+    enum class Mode { Idle, Recording, Playing };
+
+    // Per-frame events, applied before the frame runs
+    static constexpr uint8_t FRAME_RESET = 0x01;
+    static constexpr uint8_t FRAME_POWER = 0x02;
+
+    struct Frame {
+        uint8_t pad[2] = { 0x00, 0x00 };   // bus::setControllerState byte (bit0 A .. bit7 Right)
+        uint8_t flags = 0x00;
+    };
+
+    // Recording starts from a power cycle, or from the machine's current state
+    bool startRecording(nes& n, Anchor anchor);
+
+    // Puts the machine back at the anchor and rewinds the cursor.
+    // Fails if the movie was made with a different ROM or the state is rejected.
+    bool startPlayback(nes& n);
+
+    // Ends recording (storing the end-state hash) or playback
+    void stop(const nes& n);
+
+    // Runs one frame. Recording: captures the pads currently set on the bus
+    // plus flags. Playing: applies the next movie frame (flags are ignored).
+    // Returns false when playback has run out of frames (the movie stops).
+    bool step(nes& n, uint8_t flags = 0x00);
+
+    // Continue playback from frame `frame` with the machine already at that
+    // point (used by MovieIndex after restoring a keyframe)
+    bool resumeAt(size_t frame);
+
+    // Headless full-speed playback of the whole movie (no rendering, no audio).
+    // True when it completed and, if the movie has one, the end hash matched.
+    bool replay(nes& n);
+
+    // Hash of a machine snapshot, stored at stop() to verify playback
+    static uint64_t StateHash(const nes& n);
+
+    // Identifies the movie contents (anchor, ROM, frames); keys seek indexes
+    uint64_t contentHash() const;
+
+    // Identifies the anchor plus the first `frames` frames (clamped), ROM
+    // aside: two movies with the same prefix reach the same state there
+    uint64_t prefixHash(size_t frames) const;
+    static uint64_t PrefixHash(Anchor anchor, const std::vector<uint8_t>& state,
+                               const Frame* frames, size_t count);
+
+    // CRC-32 of PRG + CHR-ROM, used to match movies to ROMs
+    static uint32_t RomCrc(const cartridge& c);
+
+    // <rom base>.<ext>, next to the ROM
+    static std::string PathFor(const std::string& romPath, const char* ext);
+
+    // Native format (compact, run-length encoded frames)
+    bool saveFile(const std::string& path) const;
+    bool loadFile(const std::string& path);
+
+    // FCEUX text movies. Only power-on anchored movies can be exchanged.
+    bool importFM2(const std::string& path);
+    bool exportFM2(const std::string& path, const std::string& romName) const;
+
+    Mode   mode() const { return m_mode; }
+    bool   active() const { return m_mode != Mode::Idle; }
+    Anchor anchor() const { return m_anchor; }
+    size_t frameCount() const { return m_frames.size(); }
+    size_t cursor() const { return m_cursor; }
+    bool   hasEndHash() const { return m_endHash != 0; }
+    uint64_t endHash() const { return m_endHash; }
+
+private:
+    void clear();
+
+    Mode   m_mode = Mode::Idle;
+    Anchor m_anchor = Anchor::PowerOn;
+    uint32_t m_romCrc = 0;                  // 0 = unknown (imported)
+    uint64_t m_endHash = 0;                 // 0 = not recorded
+    std::vector<uint8_t> m_state;           // anchor snapshot when Anchor::SaveState
+    std::vector<Frame> m_frames;
+    size_t m_cursor = 0;
+};
@@ -0,0 +1,80 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+class nes;
+class Movie;
+class RomImage;
+
+// Keyframe index for seeking inside long movies.
+// build() replays the movie on its own silent instance in a background
+// thread and keeps an RLE'd save state every K frames. Whenever the
+// keyframes outgrow the budget, K doubles and every other keyframe is
+// dropped, so the cadence ends up as dense as the budget allows.
+// seek() restores the nearest keyframe at or before the target and plays
+// the remaining frames.
+class MovieIndex {
+public:
+    MovieIndex() = default;
+    ~MovieIndex();
+
+    MovieIndex(const MovieIndex&) = delete;
+    MovieIndex& operator=(const MovieIndex&) = delete;
+
+    // Starts a background pass over a copy of the movie. Any running pass is
+    // cancelled and the index is cleared first.
+    void build(const Movie& movie, std::shared_ptr<const RomImage> rom);
+    void cancel();
+    void clear();
+
+    // Puts the machine at the start of frame `frame` and leaves the movie
+    // playing from there. Usable while the index is still being built.
+    bool seek(nes& n, Movie& movie, size_t frame);
+
+    // Sidecar file next to the movie
+    bool saveFile(const std::string& path) const;
+    bool loadFile(const std::string& path, const Movie& movie);
+
+    void   setBudget(size_t bytes) { m_budget = bytes; }
+    size_t budget() const { return m_budget; }
+
+    // Stats for the UI
+    bool   building() const { return m_building; }
+    bool   matches(const Movie& movie) const;
+    float  progress() const;
+    size_t keyframeCount() const;
+    size_t usedBytes() const;
+    int    interval() const;
+
+private:
+    struct Keyframe {
+        uint32_t frame = 0;
+        std::vector<uint8_t> data;    // RLE'd save state
+    };
+
+    void worker(Movie movie, std::shared_ptr<const RomImage> rom);
+    void thin();
+
+    mutable std::mutex m_mutex;
+    std::thread m_thread;
+    std::atomic<bool> m_cancel{ false };
+    std::atomic<bool> m_building{ false };
+    std::atomic<size_t> m_done{ 0 };
+
+    // Guarded by m_mutex
+    std::vector<Keyframe> m_keys;     // sorted by frame
+    uint64_t m_movieHash = 0;
+    size_t m_total = 0;
+    size_t m_stateSize = 0;
+    size_t m_used = 0;
+    int    m_interval = 60;
+
+    size_t m_budget = 32u * 1024u * 1024u;
+    std::vector<uint8_t> m_restore;   // decode target for seek()
+};
@@ -0,0 +1,81 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <deque>
+#include <vector>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+
+class bus;
+
+// Per-frame rewind history.
+// capture() snapshots the machine into a pooled buffer and hands it to a
+// worker thread, which stores it as an RLE'd keyframe or as an RLE'd XOR
+// delta against the latest keyframe. Oldest keyframe groups are dropped to
+// stay under the memory budget.
+class RewindBuffer {
+public:
+    RewindBuffer();
+    ~RewindBuffer();
+
+    RewindBuffer(const RewindBuffer&) = delete;
+    RewindBuffer& operator=(const RewindBuffer&) = delete;
+
+    // Drop all history (call after loading a ROM or a save state)
+    void clear();
+
+    // Call once per emulated frame. Never blocks on compression; if the worker
+    // falls behind the frame is skipped.
+    void capture(const bus& b);
+
+    // Restore the most recent stored frame and remove it. False when empty.
+    bool stepBack(bus& b);
+
+    void   setBudget(size_t bytes);
+    size_t budget() const { return m_budget; }
+
+    void setKeyframeInterval(int frames) { m_keyInterval = frames < 1 ? 1 : frames; }
+
+    // Stats for the UI
+    size_t frameCount() const;
+    size_t usedBytes() const;
+    double compressionRatio() const;   // raw bytes represented / bytes stored
+
+private:
+    struct Entry {
+        bool key = false;
+        std::vector<uint8_t> data;     // RLE stream
+    };
+
+    void workerLoop();
+    void store(const std::vector<uint8_t>& raw);
+    void evictToBudget();
+    bool decodeEntry(size_t idx, std::vector<uint8_t>& out);
+    void waitIdle(std::unique_lock<std::mutex>& lock);
+
+    static constexpr size_t POOL_SIZE = 16;
+
+    mutable std::mutex m_mutex;
+    std::condition_variable m_wake;
+    std::condition_variable m_idle;
+    std::thread m_worker;
+    bool m_quit = false;
+    bool m_busy = false;
+
+    size_t m_stateSize = 0;
+    std::vector<std::vector<uint8_t>> m_free;      // raw buffers ready for capture
+    std::deque<std::vector<uint8_t>>  m_pending;   // raw snapshots waiting for the worker
+
+    // Owned by the worker while m_busy, otherwise by whoever holds m_mutex
+    std::deque<Entry> m_history;
+    std::vector<uint8_t> m_keyRaw;   // raw bytes of the newest keyframe
+    std::vector<uint8_t> m_scratch;
+    std::vector<uint8_t> m_restore;  // decode target for stepBack()
+    int  m_sinceKey = 0;
+    bool m_forceKey = true;
+    int  m_keyInterval = 60;
+
+    size_t m_budget = 64u * 1024u * 1024u;
+    size_t m_used = 0;
+};
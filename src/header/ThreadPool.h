@@ -0,0 +1,56 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Work-stealing thread pool.
+// Every worker owns a deque: it pops its own newest task and, when empty,
+// steals the oldest task from another worker. Jobs vary wildly in length
+// (a ROM that crashes on frame 3 vs. one that runs 100k frames), so idle
+// workers keep pulling work instead of waiting on a fixed partition.
+class ThreadPool {
+public:
+    // threads == 0: one per hardware thread
+    explicit ThreadPool(size_t threads = 0);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    // Queue a task. Tasks submitted from a worker go to that worker's deque.
+    void submit(std::function<void()> task);
+
+    // Block until every submitted task has finished (not from inside a task)
+    void wait();
+
+    // Runs fn(i) for i in [0, n) and waits
+    void parallelFor(size_t n, const std::function<void(size_t)>& fn);
+
+    size_t size() const { return m_queues.size(); }
+
+private:
+    struct Queue {
+        std::mutex mutex;
+        std::deque<std::function<void()>> tasks;
+    };
+
+    void workerLoop(size_t self);
+    bool popOrSteal(size_t self, std::function<void()>& task);
+
+    std::vector<std::unique_ptr<Queue>> m_queues;
+    std::vector<std::thread> m_threads;
+
+    std::mutex m_mutex;                   // guards sleeping/waking only
+    std::condition_variable m_wake;
+    std::condition_variable m_idle;
+    std::atomic<size_t> m_queued{ 0 };    // submitted, not yet picked up
+    std::atomic<size_t> m_pending{ 0 };   // submitted, not yet finished
+    std::atomic<size_t> m_next{ 0 };      // round-robin target for outside submits
+    bool m_quit = false;
+};
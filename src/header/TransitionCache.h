@@ -0,0 +1,84 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+class nes;
+
+// Memoizes whole frames: (machine state, pad 0 byte) -> successor state and,
+// optionally, the rendered frame. Tree search and RL exploration revisit the
+// same state/input pairs over and over; a hit replaces a frame of emulation
+// with a state load.
+//
+// Successor states are stored as an RLE'd XOR against the state they came
+// from, which the caller has in hand on every lookup. Entries are evicted
+// least recently used first once the budget is exceeded. Safe to share
+// between threads.
+class TransitionCache {
+public:
+    struct Stats {
+        uint64_t hits = 0;
+        uint64_t misses = 0;
+        uint64_t evictions = 0;
+        size_t   entries = 0;
+        size_t   bytes = 0;
+    };
+
+    // storeFrames: keep PPU.frameIndex of every successor, so observations
+    // come out of the cache too (the PPU does not keep a frame across a state load)
+    explicit TransitionCache(size_t budgetBytes = 64u * 1024u * 1024u, bool storeFrames = false);
+
+    TransitionCache(const TransitionCache&) = delete;
+    TransitionCache& operator=(const TransitionCache&) = delete;
+
+    // One frame of n with pad 0 set to input, from the cache when possible.
+    // With storeFrames, PPU.frameIndex holds that frame afterwards either way.
+    // Exceptions from the core propagate and nothing is cached.
+    void step(nes& n, uint8_t input);
+
+    void clear();
+
+    void   setBudget(size_t bytes);
+    size_t budget() const;
+    bool   storesFrames() const { return m_storeFrames; }
+
+    Stats stats() const;
+
+private:
+    struct Key {
+        uint64_t state;
+        uint8_t  input;
+        bool operator==(const Key& o) const { return state == o.state && input == o.input; }
+    };
+
+    struct KeyHash {
+        size_t operator()(const Key& k) const;
+    };
+
+    struct Value {
+        std::vector<uint8_t> delta;     // successor ^ predecessor, RLE'd
+        std::vector<uint8_t> frame;     // RLE'd frameIndex (storeFrames only)
+    };
+
+    struct Entry {
+        Key key;
+        std::shared_ptr<const Value> value;
+        size_t bytes;
+    };
+
+    std::shared_ptr<const Value> find(const Key& key);
+    void insert(const Key& key, std::shared_ptr<const Value> value);
+    void evict();
+
+    const bool m_storeFrames;
+
+    mutable std::mutex m_mutex;
+    std::list<Entry> m_lru;             // most recently used first
+    std::unordered_map<Key, std::list<Entry>::iterator, KeyHash> m_map;
+    size_t m_budget;
+    Stats  m_stats;
+};
@@ -0,0 +1,89 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include "ThreadPool.h"
+#include "TransitionCache.h"
+
+class nes;
+class RomImage;
+
+// N instances of one game stepped in lockstep for reinforcement learning.
+// step() applies one controller byte per instance, runs frameSkip frames
+// with it, and writes every observation into one caller-owned tensor
+// (N x obsSize() bytes, instance-major). Instances run on a thread pool and
+// all share the ROM image.
+class VecEnv {
+public:
+    enum class Obs {
+        Gray84,   // 84x84 grayscale, box-filtered from the palette-index frame
+        Ram       // the 2 KB of CPU RAM
+    };
+
+    // Predicates and rewards look at CPU RAM only (2 KB)
+    using DoneFn   = std::function<bool(const uint8_t* ram)>;
+    using RewardFn = std::function<float(const uint8_t* ram)>;
+
+    struct Config {
+        size_t   numEnvs = 8;
+        int      frameSkip = 4;          // frames per step, same action each frame
+        bool     maxPool = true;         // Gray84: pixel-wise max of the last two frames
+        Obs      obs = Obs::Gray84;
+        DoneFn   done;                   // episode end; instance auto-resets
+        RewardFn reward;                 // evaluated after the last skipped frame
+        uint64_t maxEpisodeFrames = 0;   // 0 = no limit
+        int      startFrames = 0;        // frames run after power-on for the start state
+        size_t   threads = 0;            // 0 = one per hardware thread
+        size_t   cacheBytes = 0;         // frame memoization budget (TransitionCache), 0 = off
+    };
+
+    VecEnv(std::shared_ptr<const RomImage> rom, const Config& config);
+    ~VecEnv();
+
+    VecEnv(const VecEnv&) = delete;
+    VecEnv& operator=(const VecEnv&) = delete;
+
+    bool   valid() const { return m_valid; }
+    size_t numEnvs() const { return m_envs.size(); }
+    size_t obsSize() const;                    // bytes per instance
+
+    // Puts every instance at the start state and writes first observations
+    void reset(uint8_t* obs);
+
+    // actions: numEnvs controller bytes (bit0 A .. bit7 Right).
+    // rewards/dones may be null. An instance that finishes is reset, and its
+    // observation is the first one of the new episode.
+    void step(const uint8_t* actions, uint8_t* obs, float* rewards, uint8_t* dones);
+
+    // Read-only access for custom metrics
+    const uint8_t* ram(size_t env) const;
+    uint64_t episodeFrames(size_t env) const;
+
+    // Null unless Config::cacheBytes is set
+    const TransitionCache* cache() const { return m_cache.get(); }
+
+    // 256x240 palette indices -> 84x84 luma, written to out
+    static void DownsampleGray84(const uint8_t* indexed, uint8_t* out);
+
+private:
+    struct Env {
+        std::unique_ptr<nes> n;
+        uint64_t frames = 0;
+        std::vector<uint8_t> pool;      // previous frame's observation for max-pooling
+        bool rendered = false;          // PPU.frameIndex already holds the current frame
+    };
+
+    void resetEnv(Env& e);
+    void observe(Env& e, uint8_t* out, bool pooled);
+    void stepEnv(size_t i, uint8_t action, uint8_t* obs, float* rewards, uint8_t* dones);
+
+    Config m_config;
+    bool m_valid = false;
+    std::vector<Env> m_envs;
+    std::vector<uint8_t> m_startState;
+    std::unique_ptr<TransitionCache> m_cache;
+    ThreadPool m_pool;
+};
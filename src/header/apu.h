@@ -6,6 +6,9 @@
 #include <array>
 #include <functional>
 
+class StateWriter;
+class StateReader;
+
 class apu {
 public:
     apu() = default;
@@ -37,8 +40,16 @@ public:
 
     void setDmcReader(std::function<uint8_t(uint16_t)> fn) { m_dmcRead = std::move(fn); }
 
+    // When disabled, samples are still timed but not pushed to the ring
+    // (run-ahead frames must not be heard)
+    void setOutputEnabled(bool on) { m_outputEnabled = on; }
+
     bool irqLine() const;
 
+    // Save states (channel/sequencer state only, not the audio ring)
+    void saveState(StateWriter& w) const;
+    void loadState(StateReader& r);
+
 
 
 private:
@@ -185,6 +196,7 @@ private:
 
     uint32_t m_sampleRate = 48000;
     double   m_samplePhase = 0.0; // fractional accumulator
+    bool     m_outputEnabled = true;
 
     void pushSample(float s);
     uint32_t availableSamples() const;
@@ -230,4 +242,10 @@ private:
     void clockDMC();
     uint8_t dmcOutput() const;
     void refillDmcSampleBuffer();
+
+    // Save-state field lists (shared by save and load)
+    template <typename IO, typename P> static void pulseFields(IO& io, P& p);
+    template <typename IO, typename T> static void triangleFields(IO& io, T& t);
+    template <typename IO, typename N> static void noiseFields(IO& io, N& n);
+    template <typename IO, typename D> static void dmcFields(IO& io, D& d);
 };
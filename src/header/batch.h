@@ -0,0 +1,96 @@
+#ifndef BATCH_H
+#define BATCH_H
+
+#include <cstdint>
+#include <cstddef>
+#include <ostream>
+#include <string>
+#include <vector>
+
+// Headless runs of many ROMs (used by the nesemu-batch tool).
+// Every job owns its own nes instance, so jobs can run on any thread.
+namespace Batch {
+
+    struct Job {
+        std::string romPath;
+        std::string moviePath;     // empty: run `frames` frames with no input
+        uint64_t frames = 0;
+    };
+
+    enum class Status {
+        Ok,            // ran to the end
+        LoadFailed,    // missing file or bad header
+        BadMapper,     // cartridge rejected the mapper ID
+        CpuFault,      // exception from the core (cpu::XXX on an unknown opcode)
+        MovieFailed,   // movie missing, for another ROM, or desynced
+        Crashed        // took down its worker process (RunIsolated)
+    };
+
+    // Warm start: the state after the first `warmFrames` frames of a job is
+    // kept in warmCacheDir, keyed by ROM hash and the hash of those frames'
+    // input. Jobs that share the prefix (same movie start, or no input)
+    // restore it instead of emulating the boot. Files are written to a
+    // temporary name and renamed, so workers and processes can share a directory.
+    struct Options {
+        std::string warmCacheDir;   // empty: off
+        uint64_t warmFrames = 300;
+        bool keepFrame = false;     // return the last frame in Result::frame
+
+        // Flight recorder: on a CpuFault the last instructions and a save
+        // state go to traceDir/<rom name>/, named in Result::message
+        std::string traceDir;       // empty: off
+        unsigned watchdogMs = 0;    // fault a job whose frame takes longer (0: off)
+
+        // Code/data log of every job, ORed into cdlDir/<rom name>/<movie
+        // name or "idle">.cdl, so coverage accumulates over runs. Turns the
+        // warm start off: the boot code has to run to be logged.
+        std::string cdlDir;         // empty: off
+
+        // Cheat codes (Game Genie or AAAA:VV[:CC]) applied to every job,
+        // e.g. to measure throughput with patched pages
+        std::vector<std::string> cheats;
+    };
+
+    struct Result {
+        Job job;
+        Status status = Status::Ok;
+        std::string message;       // error text for anything but Ok
+        uint64_t framesRun = 0;
+        uint64_t frameHash = 0;    // Hash64 of the last rendered frame
+        double seconds = 0.0;
+        double fps = 0.0;
+        size_t instanceBytes = 0;  // nes::instanceBytes()
+        size_t romBytes = 0;       // ROM image (shared between instances of the same game)
+        uint64_t warmFrames = 0;   // frames restored from the warm-start cache (not in framesRun)
+        bool warmStored = false;   // this job wrote the cache entry
+        double warmSavedSeconds = 0.0; // warmFrames at this job's fps
+        std::vector<uint32_t> frame;   // last frame (BGRA), with Options::keepFrame
+    };
+
+    // *.nes files in dir (optionally recursive), sorted. A ROM with a
+    // <rom base>.nesmovie or .fm2 next to it plays that movie instead.
+    std::vector<Job> FindJobs(const std::string& dir, uint64_t frames, bool recursive);
+
+    // Never throws
+    Result Run(const Job& job, const Options& options = Options());
+
+    // Runs every job in `workers` child processes fed over pipes, with
+    // results (and frames) coming back through POSIX shared memory. A job
+    // that kills its worker (segfault, abort, corrupted heap) is reported as
+    // Crashed and the worker is replaced. workers == 0: one per hardware
+    // thread. Without fork() (Windows) the jobs run on a ThreadPool instead.
+    std::vector<Result> RunIsolated(const std::vector<Job>& jobs, size_t workers,
+                                    const Options& options = Options());
+
+    // Merges the per-job code/data logs of each ROM in jobs into
+    // cdlDir/<rom name>.cdl and writes its coverage report
+    void MergeCoverage(const std::string& cdlDir, const std::vector<Job>& jobs, std::ostream& report);
+
+    const char* StatusName(Status s);
+
+    // Per-job table plus totals; aggregate fps is frames / wall-clock seconds
+    void WriteReport(std::ostream& os, const std::vector<Result>& results, double wallSeconds);
+    void WriteCsv(std::ostream& os, const std::vector<Result>& results);
+}
+
+#endif
@@ -7,37 +7,133 @@
 #include <memory>
 
 class Mapper;   // forward declaration
+class StateWriter;
+class StateReader;
+class RomImage;
+class Fingerprint;
+class CodeDataLog;
+
+// Read-only window into a RomImage
+struct RomSpan {
+    const uint8_t* ptr = nullptr;
+    size_t len = 0;
+
+    const uint8_t* data() const { return ptr; }
+    size_t size() const { return len; }
+    uint8_t operator[](size_t i) const { return ptr[i]; }
+};
 
 class cartridge {
 public:
+    enum class Mirror {
+        HORIZONTAL,
+        VERTICAL,
+        FOUR_SCREEN
+    };
+
+    enum class Region : uint8_t {
+        NTSC,
+        PAL,
+        MULTI,      // runs on either
+        DENDY
+    };
+
+    // iNES / NES 2.0 header. Sizes are in bytes; an iNES 1.0 header has no
+    // RAM sizes, so it gets the customary 8 KB of PRG-RAM (battery-backed
+    // when flagged) and 8 KB of CHR-RAM when there is no CHR-ROM.
+    struct Header {
+        bool     nes20 = false;
+        uint16_t mapper = 0;
+        uint8_t  submapper = 0;
+        uint32_t prgRomSize = 0;
+        uint32_t chrRomSize = 0;
+        uint32_t prgRamSize = 0;    // volatile
+        uint32_t prgNvramSize = 0;  // battery-backed
+        uint32_t chrRamSize = 0;
+        uint32_t chrNvramSize = 0;
+        bool     battery = false;
+        bool     trainer = false;
+        Mirror   mirror = Mirror::HORIZONTAL;
+        Region   region = Region::NTSC;
+
+        size_t romOffset() const { return trainer ? 16 + 512 : 16; }
+    };
+
+    // False (error set) when data does not start with a usable header
+    static bool ParseHeader(const uint8_t* data, size_t size, Header& out, std::string* error = nullptr);
+
+    // True when this build has the mapper
+    static bool SupportsMapper(uint16_t id);
+
     cartridge(const std::string& filename);
 
-    bool valid = false;
+    // Shares an already loaded image; many cartridges can use one image
+    explicit cartridge(std::shared_ptr<const RomImage> image);
 
-    std::vector<uint8_t> prgRom;
-    std::vector<uint8_t> chrRom;
+    // chrRom may point into chrRam
+    cartridge(const cartridge&) = delete;
+    cartridge& operator=(const cartridge&) = delete;
 
-    std::vector<uint8_t> prgRam; // 8KB PRG RAM (battery-backed on many carts)
+    bool valid = false;
+    std::string error;   // why loading failed (empty when valid)
 
-    uint8_t mapperID = 0;
-    uint8_t prgBanks = 0;
-    uint8_t chrBanks = 0;
+    // ROM contents live in the shared image and are never written.
+    // On CHR-RAM carts chrRom views this instance's chrRam instead.
+    std::shared_ptr<const RomImage> image;
+    RomSpan prgRom;
+    RomSpan chrRom;
+    uint32_t romCrc = 0;         // CRC-32 of PRG-ROM then CHR-ROM (none on CHR-RAM carts)
 
-    enum class Mirror {
-        HORIZONTAL,
-        VERTICAL,
-        FOUR_SCREEN
-    };
+    std::vector<uint8_t> chrRam; // CHR-RAM (+ CHR-NVRAM) when the cart has no CHR ROM
+    std::vector<uint8_t> prgRam; // PRG-RAM then PRG-NVRAM, sized from the header; may be empty
+
+    Header header;
+    uint16_t mapperID = 0;
+    uint16_t prgBanks = 0;       // 16 KB units, rounded up
+    uint16_t chrBanks = 0;       // 8 KB units, rounded up; 0 means CHR-RAM
 
     Mirror mirror = Mirror::HORIZONTAL;
 
     std::shared_ptr<Mapper> mapper;
 
+    // Write hook target; null unless nes::setFingerprinting(true)
+    Fingerprint* fingerprint = nullptr;
+
+    // CHR-ROM read hook target; null unless a CodeDataLog is attached
+    CodeDataLog* cdl = nullptr;
+
+    // Power-on state: fresh mapper registers, cleared PRG-RAM/CHR-RAM,
+    // header mirroring
+    void reset();
+
+    // prgRam index for $6000-$7FFF; RAM smaller than 8 KB repeats. Only
+    // meaningful when prgRam is not empty.
+    size_t prgRamIndex(uint32_t addr) const
+    {
+        const size_t i = addr & 0x1FFF;
+        return i < prgRam.size() ? i : i % prgRam.size();
+    }
+
     bool cpuRead(uint16_t addr, uint8_t& data);
     bool cpuWrite(uint16_t addr, uint8_t data);
 
     bool ppuRead(uint16_t addr, uint8_t& data);
+
+    // ppuRead() for debugger views: no mapper side effects, not logged
+    bool ppuPeek(uint16_t addr, uint8_t& data) const;
     bool ppuWrite(uint16_t addr, uint8_t data);
+
+    // Memory owned by this instance (RAM, mapper), excluding the shared image
+    size_t instanceBytes() const;
+
+    // Save states (PRG-RAM, CHR-RAM, mirroring and mapper registers)
+    void saveState(StateWriter& w) const;
+    void loadState(StateReader& r);
+
+private:
+    void load();
+    bool createMapper();
+    static std::shared_ptr<Mapper> MakeMapper(uint16_t id, uint16_t prgBanks, uint16_t chrBanks);
 };
 
 #endif
@@ -0,0 +1,63 @@
+#ifndef CHEATS_H
+#define CHEATS_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+class bus;
+
+// Game Genie (6 and 8 letter) and raw "AAAA:VV" / "AAAA:VV:CC" cheats.
+// Like watchpoints, nothing is checked per access: each patched 256-byte
+// page gets bus::TRAP_CHEAT in trapPages, and only reads from those pages
+// reach onRead(). A compare value is checked against the byte the read
+// actually returned, so a code follows bank switches (and state loads)
+// without any bookkeeping. Patches apply to peeks as well, as on the real
+// cartridge pass-through.
+class Cheats {
+public:
+    struct Cheat {
+        std::string code;           // as entered, upper case
+        std::string name;
+        uint16_t addr = 0;
+        uint8_t  value = 0;
+        int16_t  compare = -1;      // -1: none
+        bool     enabled = true;
+    };
+
+    // Game Genie or raw code; false (error set) when it is neither
+    static bool Parse(const std::string& code, Cheat& out, std::string* error = nullptr);
+
+    // Null detaches (and clears the cheat trap bits of the previous bus)
+    void attach(bus* b);
+
+    bool add(const std::string& code, const std::string& name = {}, std::string* error = nullptr);
+    void remove(size_t index);
+    void setEnabled(size_t index, bool enabled);
+    void clear();
+
+    const std::vector<Cheat>& list() const { return m_cheats; }
+
+    // One code per line, then an optional name; "-" in front disables it
+    // and "#" starts a comment. load() replaces the list.
+    bool load(const std::string& path, std::string* error = nullptr);
+    bool save(const std::string& path) const;
+
+    // Slow path, from the bus for reads of patched pages
+    uint8_t onRead(uint16_t addr, uint8_t data) const;
+
+private:
+    struct Patch {
+        uint16_t addr;
+        uint8_t  value;
+        int16_t  compare;
+    };
+
+    void rebuild();
+
+    bus* m_bus = nullptr;
+    std::vector<Cheat> m_cheats;
+    std::vector<Patch> m_patches;   // enabled cheats
+};
+
+#endif
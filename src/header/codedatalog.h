@@ -0,0 +1,151 @@
+#ifndef CODEDATALOG_H
+#define CODEDATALOG_H
+
+#include <cstdint>
+#include <cstddef>
+#include <ostream>
+#include <string>
+#include <vector>
+
+class nes;
+class bus;
+
+// Code/Data Logger: one flag byte per PRG-ROM and CHR-ROM byte, in the
+// FCEUX .cdl layout (PRG flags, then CHR flags; no CHR part for CHR-RAM).
+//
+// The devices call the Cdl*() hooks below from their access paths. Without
+// NESEMU_CDL the hooks are empty; with it, a detached logger costs one null
+// check per access. Side-effect-free peeks (debugger, trace, DMA) are not
+// logged.
+class CodeDataLog {
+public:
+    // PRG flags. Bit 7 is unused by FCEUX; here it marks the first byte of
+    // an instruction, so disassemblers can tell opcodes from operands.
+    enum PrgFlag : uint8_t {
+        Code         = 0x01,
+        Data         = 0x02,
+        BankMask     = 0x0C,   // CPU address bits 13-14 when accessed ($8000 = 0)
+        IndirectCode = 0x10,   // target of JMP ($nnnn)
+        IndirectData = 0x20,   // read through ($nn,X) / ($nn),Y
+        Pcm          = 0x40,   // fetched by the DMC
+        Opcode       = 0x80
+    };
+
+    enum ChrFlag : uint8_t {
+        Drawn = 0x01,          // fetched by the PPU while rendering
+        Read  = 0x02           // read by the CPU through $2007
+    };
+
+    struct Coverage {
+        size_t prgSize = 0, code = 0, data = 0, both = 0, opcodes = 0, pcm = 0;
+        size_t chrSize = 0, drawn = 0, read = 0;
+
+        size_t prgLogged() const { return code + data - both + pcm; }
+    };
+
+    CodeDataLog() = default;
+    ~CodeDataLog();
+
+    CodeDataLog(const CodeDataLog&) = delete;
+    CodeDataLog& operator=(const CodeDataLog&) = delete;
+
+    // Hooks the console's devices and sizes the flags for its cartridge
+    // (clearing them when the sizes change). Call again after loading
+    // another ROM. null detaches.
+    void attach(nes* n);
+
+    // Stop and resume logging; the flags stay
+    void setRunning(bool running);
+    bool running() const;
+
+    void clear();
+
+    const std::vector<uint8_t>& prg() const { return m_prg; }
+    const std::vector<uint8_t>& chr() const { return m_chr; }
+
+    // FCEUX .cdl file
+    bool save(const std::string& path) const;
+
+    // ORs a .cdl file (from an earlier run of the same ROM) into the flags
+    bool merge(const std::string& path, std::string* error = nullptr);
+
+    Coverage coverage() const;
+
+    // Totals plus PRG coverage per 8 KB bank
+    void writeReport(std::ostream& os) const;
+
+    // Accesses, from the hooks
+    void onFetch(bus& b, uint16_t pc);
+    void onCpuRead(bus& b, uint16_t addr);
+    void onPcm(bus& b, uint16_t addr);
+    void onChr(uint32_t offset) { if (offset < m_chr.size()) m_chr[offset] |= m_chrAccess; }
+    void setCpuChrAccess(bool cpu) { m_chrAccess = cpu ? Read : Drawn; }
+
+private:
+    void mark(bus& b, uint16_t addr, uint8_t flags);
+
+    nes* m_nes = nullptr;
+    std::vector<uint8_t> m_prg;
+    std::vector<uint8_t> m_chr;
+
+    uint8_t  m_len[256] = {};
+    uint8_t  m_mode[256] = {};      // 1: indirect data reads, 2: JMP ($nnnn)
+
+    // The instruction being executed: reads inside it are code
+    uint32_t m_start = 0, m_end = 0;
+    uint8_t  m_indirect = 0;
+    bool     m_jumpIndirect = false;
+    uint8_t  m_chrAccess = Drawn;
+};
+
+// Before the CPU fetches an opcode
+inline void CdlFetch(CodeDataLog* cdl, bus& b, uint16_t pc)
+{
+#ifdef NESEMU_CDL
+    if (cdl) cdl->onFetch(b, pc);
+#else
+    (void)cdl; (void)b; (void)pc;
+#endif
+}
+
+// After a CPU read (not a peek) of a cartridge address
+inline void CdlCpuRead(CodeDataLog* cdl, bus& b, uint16_t addr)
+{
+#ifdef NESEMU_CDL
+    if (cdl && addr >= 0x8000) cdl->onCpuRead(b, addr);
+#else
+    (void)cdl; (void)b; (void)addr;
+#endif
+}
+
+// DMC sample fetch
+inline void CdlPcm(CodeDataLog* cdl, bus& b, uint16_t addr)
+{
+#ifdef NESEMU_CDL
+    if (cdl) cdl->onPcm(b, addr);
+#else
+    (void)cdl; (void)b; (void)addr;
+#endif
+}
+
+// A CHR-ROM byte was read, at its mapped offset
+inline void CdlChr(CodeDataLog* cdl, uint32_t offset)
+{
+#ifdef NESEMU_CDL
+    if (cdl) cdl->onChr(offset);
+#else
+    (void)cdl; (void)offset;
+#endif
+}
+
+// Around $2007 reads, which count as Read instead of Drawn
+inline void CdlCpuChrAccess(CodeDataLog* cdl, bool cpu)
+{
+#ifdef NESEMU_CDL
+    if (cdl) cdl->setCpuChrAccess(cpu);
+#else
+    (void)cdl; (void)cpu;
+#endif
+}
+
+#endif
@@ -0,0 +1,73 @@
+#ifndef CONDITION_H
+#define CONDITION_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+class bus;
+
+// Breakpoint/watchpoint condition such as
+//     A == $40 && [$0075] > 3 && scanline < 20
+//
+// Operands: numbers ($hex, 0xhex, %binary, decimal), registers A X Y SP P PC,
+// flags C Z I D V N (0/1), [expr] for a side-effect-free CPU bus read,
+// scanline, dot, frame (PPU.frameCount), and addr/value of the access that
+// triggered the check. Operators, loosest first:
+//     ||   &&   == != < <= > >=   |   ^   &   << >>   + -   *   unary ! ~ -
+// Values are 32-bit signed; comparisons and logic give 0 or 1.
+//
+// compile() parses once into a flat stack bytecode: constants are folded,
+// "leaf op constant" becomes a single instruction, RAM reads at a fixed
+// address skip the bus, and && / || short-circuit. The example above is five
+// instructions.
+class Condition {
+public:
+    // Empty text gives an empty condition, which always passes
+    bool compile(const std::string& text, std::string* error = nullptr);
+    void clear();
+
+    bool empty() const { return m_code.empty(); }
+    const std::string& text() const { return m_text; }
+
+    // b must be connected to its CPU and PPU (as in nes)
+    int32_t evaluate(bus& b, uint16_t addr, uint8_t value) const;
+    bool test(bus& b, uint16_t addr, uint8_t value) const { return empty() || evaluate(b, addr, value) != 0; }
+
+    // Disassembly of the bytecode, for the debugger
+    std::string dump() const;
+
+private:
+    enum Code : uint8_t {
+        None,
+        // Leaves: push a value, or with Op::cmp set, push (value cmp Op::imm)
+        Const, RegA, RegX, RegY, RegSP, RegP, RegPC, Flag,
+        Scanline, Dot, Frame, Addr, Value, PeekAbs, PeekRam,
+        // Operate on the stack
+        Peek, Neg, Not, BitNot,
+        Mul, Add, Sub, Shl, Shr, BitAnd, BitXor, BitOr,
+        Eq, Ne, Lt, Le, Gt, Ge,
+        JumpIfZero,     // top == 0: jump, keeping 0; else pop
+        JumpIfNonZero,  // top != 0: make it 1 and jump; else pop
+        Bool,
+    };
+
+    struct Op {
+        Code    code;
+        Code    cmp;    // leaves only: binary operator against imm, fused in
+        int32_t arg;    // constant, address, flag bit or jump target
+        int32_t imm;
+    };
+
+    static constexpr int MAX_DEPTH = 32;
+
+    // Binary operators, shared by the constant folder and the interpreter
+    static int32_t fold(Code code, int32_t a, int32_t b);
+
+    friend class ConditionParser;
+
+    std::string     m_text;
+    std::vector<Op> m_code;
+};
+
+#endif
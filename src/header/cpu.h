@@ -6,6 +6,10 @@
 #include <string>
 
 class bus;
+class StateWriter;
+class StateReader;
+class TraceLog;
+class Profiler;
 
 
 // Optional legacy struct (unused at runtime)
@@ -69,10 +73,26 @@ public:
 
     bool complete();
 
+    // Save states
+    void saveState(StateWriter& w) const;
+    void loadState(StateReader& r);
+
     //debug helpers
     uint8_t  prev_opcode = 0x00;
     uint16_t prev_PC     = 0x0000;
 
+    // Instruction trace; null unless a TraceLog is attached
+    TraceLog* trace = nullptr;
+
+    // Cycle profiler; null unless one is attached
+    Profiler* profiler = nullptr;
+
+    // Disassembly: mnemonic ("XXX" for unsupported opcodes) and addressing
+    // mode of an opcode. IMP also covers the accumulator forms (ASL A).
+    enum class AddrMode : uint8_t { IMP, IMM, ZP0, ZPX, ZPY, ABS, ABX, ABY, IND, IZX, IZY, REL };
+    const char* opName(uint8_t opcode) const { return lookup[opcode].name; }
+    AddrMode    opMode(uint8_t opcode) const;
+
 
 private:
 
@@ -0,0 +1,42 @@
+#ifndef DEBUGGER_H
+#define DEBUGGER_H
+
+#include <cstdint>
+
+class nes;
+
+// Run control for the debugger window. stepInto() runs one instruction
+// right away. The others set a goal that run() pursues in place of
+// nes::runFrame(): it stops at the end of the frame (call again next frame),
+// on a watchpoint break, or when the goal is reached, in which case it sets
+// BUS.breakRequested like a watchpoint so the caller pauses.
+class Debugger {
+public:
+    enum class Goal { None, StepOver, StepOut, RunTo };
+
+    void stepInto(nes& n);
+
+    // Over a JSR: until it returns (same stack depth). Anything else: stepInto
+    void stepOver(nes& n);
+
+    // Until the current subroutine or interrupt handler returns
+    void stepOut(nes& n);
+
+    void runTo(uint16_t addr);
+
+    void cancel() { m_goal = Goal::None; }
+    Goal goal() const { return m_goal; }
+
+    // True when the goal was reached
+    bool run(nes& n);
+
+private:
+    bool reached(const nes& n) const;
+
+    Goal     m_goal = Goal::None;
+    uint16_t m_target = 0;
+    uint8_t  m_sp = 0;      // stack pointer when the goal was set
+    bool     m_moved = false;
+};
+
+#endif
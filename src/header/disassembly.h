@@ -0,0 +1,84 @@
+#ifndef DISASSEMBLY_H
+#define DISASSEMBLY_H
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+class nes;
+class Symbols;
+
+// Listing of the CPU address space for the debugger: RAM ($0000-$07FF),
+// PRG-RAM ($6000-$7FFF) and PRG-ROM ($8000-$FFFF). The registers in between
+// are left out, since reading them can have side effects.
+//
+// Decoded instructions are cached per 4 KB page, keyed by (bank, address):
+// a ROM page is identified by the PRG offset mapped there, so bank switches
+// select other cache entries and ROM pages never need decoding twice. RAM
+// pages, and ROM pages with a cheat patch, are re-decoded when their bytes
+// (as peeked) have changed. Pages decode
+// independently: an instruction that would cross into the next page is shown
+// as data. refresh() costs a few map lookups per frame, so the whole space
+// scrolls without decoding.
+class Disassembly {
+public:
+    struct Line {
+        uint16_t addr = 0;
+        uint8_t  len = 1;
+        uint8_t  data = 0;      // not decoded as an instruction (.db)
+        uint8_t  bytes[3] = {};
+    };
+
+    struct Stats {
+        uint64_t pagesDecoded = 0;
+        uint64_t pageHits = 0;
+        size_t   cachedPages = 0;
+    };
+
+    // Bring the listing up to the current mapping and memory. Lines are
+    // aligned so that one starts at pc and at each interrupt vector target.
+    void refresh(nes& n, uint16_t pc);
+
+    // Drop every cached page (new cartridge)
+    void clear();
+
+    size_t      lineCount() const { return m_count; }
+    const Line& line(size_t i) const;
+
+    // Index of the line holding addr, or the nearest one before it
+    size_t find(uint16_t addr) const;
+
+    // "LDA $0300,X", with labels from symbols (may be null) for operands
+    static std::string format(const nes& n, const Line& line, const Symbols* symbols);
+
+    // Address an instruction jumps or branches to, if it has a fixed one
+    static bool target(const nes& n, const Line& line, uint16_t& addr);
+
+    Stats stats() const;
+
+private:
+    struct Page {
+        uint64_t content = 0;           // hash of the bytes (RAM pages only)
+        std::vector<uint16_t> syncs;    // addresses lines were forced to start at
+        std::vector<Line> lines;
+    };
+
+    // The listing is the pages of the current mapping in address order
+    struct Span {
+        const Page* page;
+        size_t      first;              // index of its first line
+    };
+
+    const Page& page(nes& n, uint16_t base, uint32_t end, const std::vector<uint16_t>& syncs);
+    static bool startsLine(const Page& p, uint16_t addr);
+    static void decode(nes& n, Page& p, uint16_t base, uint32_t end);
+
+    std::unordered_map<uint64_t, Page> m_pages;
+    std::vector<Span> m_spans;
+    size_t m_count = 0;
+    Stats  m_stats;
+};
+
+#endif
@@ -0,0 +1,178 @@
+#ifndef EVENTLOG_H
+#define EVENTLOG_H
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+class nes;
+class ppu;
+
+// Event viewer: register accesses ($2000-$3FFF, $4000-$4017, mapper
+// registers), NMI, IRQ, DMA, sprite 0 hits and bank switches, stamped with
+// the PPU scanline and dot. One frame is recorded into a fixed-capacity
+// buffer while the previous, complete frame is shown.
+//
+// The devices call the Event*() hooks below. Without NESEMU_EVENTS they are
+// empty; with it, a detached log costs one null check per access. The CPU
+// runs an instruction at once, so its accesses carry the dot the instruction
+// started at.
+class EventLog {
+public:
+    enum Type : uint8_t {
+        PpuRead, PpuWrite,      // $2000-$3FFF
+        IoRead, IoWrite,        // $4000-$4017 except $4014
+        OamDma,                 // $4014 write
+        MapperWrite,            // $4020-$5FFF, $8000-$FFFF
+        BankSwitch,             // addr: CPU ($8000...) or PPU ($0000...) window,
+                                // value: its new 8 KB PRG / 1 KB CHR bank
+        Nmi, Irq,
+        DmcDma,                 // DMC sample fetch
+        Sprite0Hit,
+        TypeCount
+    };
+
+    struct Event {
+        uint16_t addr = 0;
+        uint8_t  value = 0;
+        Type     type = PpuRead;
+        int16_t  scanline = 0;  // 0-239 visible, 241 vblank starts, 261 pre-render
+        int16_t  dot = 0;
+    };
+
+    struct Counters {
+        uint64_t events[TypeCount] = {};
+        uint64_t dmaCycles = 0;     // CPU cycles stalled by OAM DMA
+        uint64_t dropped = 0;       // past CAPACITY in a frame
+
+        uint64_t writes() const { return events[PpuWrite] + events[IoWrite] + events[OamDma] + events[MapperWrite]; }
+    };
+
+    static constexpr size_t CAPACITY = 16384;   // events per frame
+    static constexpr int    DOTS = 341;
+    static constexpr int    SCANLINES = 262;
+
+    EventLog();
+    ~EventLog();
+
+    EventLog(const EventLog&) = delete;
+    EventLog& operator=(const EventLog&) = delete;
+
+    // Hooks the console's devices and clears everything. Call again after
+    // loading another ROM. null detaches.
+    void attach(nes* n);
+
+    void setRunning(bool running);
+    bool running() const;
+
+    void reset();
+
+    static const char* typeName(Type type);
+
+    // The last complete frame
+    const Event* events() const { return m_shown.data(); }
+    size_t count() const { return m_shownCount; }
+    const Counters& frameCounters() const { return m_shownCounters; }
+
+    // Summed over frames() complete frames since reset()
+    const Counters& totals() const { return m_totals; }
+    uint64_t frames() const { return m_frames; }
+
+    // From the hooks
+    void onRead(uint16_t addr, uint8_t value);
+    void onWrite(uint16_t addr, uint8_t value);
+    void onMapperWrite(uint16_t addr, uint8_t value);
+    void onDmaCycle() { m_counters.dmaCycles++; }
+    void record(Type type, uint16_t addr = 0, uint8_t value = 0);
+    void endFrame();
+
+private:
+    // PRG 8 KB windows at $8000-$E000, then CHR 1 KB windows
+    static constexpr int WINDOWS = 4 + 8;
+
+    void readBanks(uint32_t* banks) const;
+
+    nes* m_nes = nullptr;
+    const ppu* m_ppu = nullptr;
+
+    std::vector<Event> m_current;
+    size_t   m_count = 0;
+    Counters m_counters;
+
+    std::vector<Event> m_shown;
+    size_t   m_shownCount = 0;
+    Counters m_shownCounters;
+
+    Counters m_totals;
+    uint64_t m_frames = 0;
+
+    uint32_t m_banks[WINDOWS] = {};     // before the mapper write in progress
+};
+
+inline void EventLog::onRead(uint16_t addr, uint8_t value)
+{
+    if (addr >= 0x2000 && addr < 0x4000) record(PpuRead, (uint16_t)(0x2000 | (addr & 7)), value);
+    else if (addr >= 0x4000 && addr < 0x4018) record(IoRead, addr, value);
+}
+
+// A CPU read (not a peek)
+inline void EventRead(EventLog* ev, uint16_t addr, uint8_t value)
+{
+#ifdef NESEMU_EVENTS
+    if (ev) ev->onRead(addr, value);
+#else
+    (void)ev; (void)addr; (void)value;
+#endif
+}
+
+// Before a CPU write is carried out
+inline void EventWrite(EventLog* ev, uint16_t addr, uint8_t value)
+{
+#ifdef NESEMU_EVENTS
+    if (ev && addr >= 0x2000) ev->onWrite(addr, value);
+#else
+    (void)ev; (void)addr; (void)value;
+#endif
+}
+
+// After the cartridge saw a CPU write
+inline void EventMapperWrite(EventLog* ev, uint16_t addr, uint8_t value)
+{
+#ifdef NESEMU_EVENTS
+    if (ev && addr >= 0x4020) ev->onMapperWrite(addr, value);
+#else
+    (void)ev; (void)addr; (void)value;
+#endif
+}
+
+// NMI, IRQ, DMC fetch, sprite 0 hit
+inline void EventSignal(EventLog* ev, EventLog::Type type, uint16_t addr = 0, uint8_t value = 0)
+{
+#ifdef NESEMU_EVENTS
+    if (ev) ev->record(type, addr, value);
+#else
+    (void)ev; (void)type; (void)addr; (void)value;
+#endif
+}
+
+// A CPU cycle taken by OAM DMA
+inline void EventDmaCycle(EventLog* ev)
+{
+#ifdef NESEMU_EVENTS
+    if (ev) ev->onDmaCycle();
+#else
+    (void)ev;
+#endif
+}
+
+// The PPU finished a frame
+inline void EventFrame(EventLog* ev)
+{
+#ifdef NESEMU_EVENTS
+    if (ev) ev->endFrame();
+#else
+    (void)ev;
+#endif
+}
+
+#endif
@@ -0,0 +1,43 @@
+#ifndef HASH_H
+#define HASH_H
+
+#include <array>
+#include <cstdint>
+#include <cstddef>
+
+namespace Hash {
+    // Standard CRC-32 (IEEE, as used by ROM databases and FCEUX).
+    // ARMv8 CRC instructions when built for them, slicing-by-8 otherwise.
+    uint32_t Crc32(const uint8_t* data, size_t n, uint32_t crc = 0);
+
+    // SHA-1, fed in pieces (No-Intro and friends list it next to the CRC)
+    class Sha1 {
+    public:
+        using Digest = std::array<uint8_t, 20>;
+
+        Sha1();
+        void update(const uint8_t* data, size_t n);
+        Digest finish();
+
+    private:
+        void block(const uint8_t* p);
+
+        uint32_t m_h[5];
+        uint8_t  m_buf[64];
+        size_t   m_used = 0;
+        uint64_t m_total = 0;
+    };
+
+    // Fast non-cryptographic 64-bit hash (8 bytes per step, avalanche finish)
+    uint64_t Hash64(const uint8_t* data, size_t n, uint64_t seed = 0);
+
+    // 64-bit finalizer (splitmix64); good for hashing small integers
+    inline uint64_t Mix64(uint64_t x) {
+        x ^= x >> 30; x *= 0xBF58476D1CE4E5B9ull;
+        x ^= x >> 27; x *= 0x94D049BB133111EBull;
+        x ^= x >> 31;
+        return x;
+    }
+}
+
+#endif
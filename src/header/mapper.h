@@ -3,9 +3,12 @@
 
 #include <cstdint>
 
+class StateWriter;
+class StateReader;
+
 class Mapper {
 public:
-    Mapper(uint8_t prgBanks, uint8_t chrBanks)
+    Mapper(uint16_t prgBanks, uint16_t chrBanks)
         : prgBanks(prgBanks), chrBanks(chrBanks) {}
 
     virtual ~Mapper() = default;
@@ -18,9 +21,16 @@ public:
     virtual bool ppuMapRead(uint16_t addr, uint32_t& mappedAddr) = 0;
     virtual bool ppuMapWrite(uint16_t addr, uint32_t& mappedAddr) = 0;
 
+    // ppuMapRead() without side effects (MMC2 latches), for debugger views
+    virtual bool ppuMapPeek(uint16_t addr, uint32_t& mappedAddr) { return ppuMapRead(addr, mappedAddr); }
+
+    // Internal registers for save states (stateless mappers keep the defaults)
+    virtual void saveState(StateWriter& w) const { (void)w; }
+    virtual void loadState(StateReader& r) { (void)r; }
+
 protected:
-    uint8_t prgBanks = 0;
-    uint8_t chrBanks = 0;
+    uint16_t prgBanks = 0;   // 16 KB units, rounded up
+    uint16_t chrBanks = 0;   // 8 KB units, rounded up; 0 means CHR-RAM
 };
 
 #endif
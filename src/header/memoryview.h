@@ -0,0 +1,60 @@
+#ifndef MEMORYVIEW_H
+#define MEMORYVIEW_H
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+class nes;
+
+// Byte access to every address space for the memory editor. peek() has no
+// side effects: register reads do not acknowledge anything, $2007 does not
+// advance the VRAM address, MMC2 latches stay put and nothing is logged.
+// poke() stores into memory directly (never into a register) and keeps the
+// state fingerprint current; ROM is read-only.
+//
+// Change highlighting compares each byte with the value it had when it was
+// last drawn, so it costs nothing for rows out of view.
+class MemoryView {
+public:
+    enum class Space : uint8_t {
+        CpuBus,         // $0000-$FFFF as the CPU sees it
+        CpuRam,         // 2 KB
+        PrgRam,
+        PrgRom,
+        Chr,            // CHR-ROM, or CHR-RAM
+        PpuBus,         // $0000-$3FFF as the PPU sees it
+        Nametables,     // 2 KB VRAM
+        Palette,
+        Oam,
+        Count
+    };
+
+    static const char* name(Space space);
+    static size_t size(const nes& n, Space space);
+
+    static uint8_t peek(nes& n, Space space, uint32_t addr);
+    static bool writable(const nes& n, Space space, uint32_t addr);
+    static bool poke(nes& n, Space space, uint32_t addr, uint8_t value);
+
+    // Once per UI frame
+    void tick() { m_tick++; }
+
+    // UI frames since a byte in view changed (UINT32_MAX: not since it was
+    // first seen); records value as seen
+    uint32_t age(const nes& n, Space space, uint32_t addr, uint8_t value);
+
+    // Forget the values seen (new cartridge)
+    void clear();
+
+private:
+    struct Shadow {
+        std::vector<uint8_t>  value;
+        std::vector<uint32_t> changed;  // tick of the last change; 0 unseen, 1 unchanged
+    };
+
+    Shadow   m_shadow[(size_t)Space::Count];
+    uint32_t m_tick = 2;
+};
+
+#endif
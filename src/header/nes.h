@@ -0,0 +1,82 @@
+#ifndef NES_H
+#define NES_H
+
+#include <cstdint>
+#include <cstddef>
+#include <memory>
+#include <string>
+
+#include "cpu.h"
+#include "ppu.h"
+#include "apu.h"
+#include "Bus.h"
+#include "cartridge.h"
+#include "romimage.h"
+#include "fingerprint.h"
+
+// One complete console: the devices, wired to each other, plus its cartridge.
+// The GUI owns one; run-ahead and headless tools create more.
+// Not copyable or movable (devices hold pointers to each other).
+class nes {
+public:
+    nes();
+
+    nes(const nes&) = delete;
+    nes& operator=(const nes&) = delete;
+
+    cpu CPU;
+    ppu PPU;
+    apu APU;
+    bus BUS;
+
+    std::unique_ptr<cartridge> CART;
+
+    // Loads and inserts a ROM, then resets. Keeps the old cartridge on failure
+    // and reports why through `error` when given.
+    bool loadRom(const std::string& path, std::string* error = nullptr);
+
+    // Same, from an image that other instances may already share
+    bool loadRom(std::shared_ptr<const RomImage> image, std::string* error = nullptr);
+
+    // Bytes owned by this instance (devices, framebuffers, cartridge RAM).
+    // The ROM image is shared and reported separately by sharedRomBytes().
+    size_t instanceBytes() const;
+    size_t sharedRomBytes() const;
+
+    // Console reset button (CPU/APU restart, RAM cleared)
+    void reset();
+
+    // Full power cycle: every device and the cartridge back to power-on state.
+    // Movies anchored to power-on start from here, so it must be deterministic.
+    void powerOn();
+
+    // Emulate until the PPU completes a frame, or a watchpoint breaks
+    // (BUS.breakRequested; calling again resumes the same frame)
+    void runFrame();
+
+    // Rasterize PPU.frame from the current PPU state
+    void renderFrame();
+
+    // Rasterize palette indices only (PPU.frameIndex), skipping the BGRA pass
+    void renderIndexed();
+
+    // In-memory save states (see savestate.h)
+    size_t stateSize() const;
+    size_t saveState(uint8_t* out, size_t capacity) const;
+    bool   loadState(const uint8_t* data, size_t size);
+
+    // Incremental state fingerprint (fingerprint.h), off by default.
+    // fingerprint() is 0 while off. Code that writes device memory directly
+    // (not through the bus or the PPU) calls refreshFingerprint() afterwards.
+    void     setFingerprinting(bool on);
+    bool     fingerprinting() const { return m_fingerprint != nullptr; }
+    uint64_t fingerprint() const;
+    void     refreshFingerprint();
+
+private:
+    void attachFingerprint();
+
+    std::unique_ptr<Fingerprint> m_fingerprint;
+};
+
+#endif
@@ -6,30 +6,59 @@
 #include <vector>
 
 class cartridge;
+class Fingerprint;
+class CodeDataLog;
+class EventLog;
+class StateWriter;
+class StateReader;
 
 class ppu {
 public:
     ppu();
 
+    // Power-on state (registers, VRAM, OAM, palette, timing)
+    void reset();
+
     uint8_t cpuRead(uint16_t addr, bool readonly = false);
     void    cpuWrite(uint16_t addr, uint8_t data);
 
     uint8_t ppuRead(uint16_t addr);
     void    ppuWrite(uint16_t addr, uint8_t data);
 
+    // ppuRead() without side effects (mapper latches, CDL), for debugger views
+    uint8_t ppuPeek(uint16_t addr) const;
+
     void updatePatternTable();
     void clock();
 
     void ppu_prefetch_bg_tiles_for_mmc2(ppu* self, int y, int scrollX, int scrollY,
                                         int baseNTX, int baseNTY, uint16_t patternBase);
 
+    // Rasterize into frameIndex (palette indices); resolveFrame() converts to BGRA
     void renderBackground();
     void renderSprites();
+    void resolveFrame();
+
+    // BGRA color of a 6-bit palette index
+    static uint32_t paletteColor(uint8_t index);
 
     bool nmi = false;
 
     void connectCartridge(cartridge* cart);
 
+    // Write hook target; null unless nes::setFingerprinting(true)
+    Fingerprint* fingerprint = nullptr;
+
+    // Code/data logger ($2007 CHR reads); null unless one is attached
+    CodeDataLog* cdl = nullptr;
+
+    // Event viewer (sprite 0 hit, frame end); null unless one is attached
+    EventLog* events = nullptr;
+
+    // Save states
+    void saveState(StateWriter& w) const;
+    void loadState(StateReader& r);
+
     bool bgPixelNonZeroAt(int x, int y);
     bool sprite0PixelNonZeroAt(int x, int y);
 
@@ -37,6 +66,7 @@ public:
     std::array<uint8_t, 2048> vram{};
     std::array<uint8_t, 32>   palette{};
     std::array<uint32_t, 256 * 240> frame{};
+    std::array<uint8_t, 256 * 240>  frameIndex{};  // palette index (0-63) per pixel
     std::array<uint8_t, 256>  OAM{};
     std::vector<uint32_t> patternTable[2];
 
@@ -84,6 +114,10 @@ public:
 
     bool frame_complete = false;
 
+    // Frames completed since reset. Debugger only: not part of save states or
+    // hashes, so it keeps counting across state loads.
+    uint64_t frameCount = 0;
+
     bool sprite0_hit_pending = false;
     int  sprite0_hit_x = -1;
     int  sprite0_hit_y = -1;
@@ -93,6 +127,9 @@ private:
 
     uint16_t mapNametableAddr(uint16_t addr) const;
 
+    // Records scroll and pattern selects for scanline y (fingerprinted)
+    void snapshotScanline(int y);
+
     // helpers for snapshots
     inline uint16_t bgPatternBaseForScanline(int y) const {
         if (y < 0 || y >= 240) return (PPUCTRL & 0x10) ? 0x1000 : 0x0000;
@@ -0,0 +1,176 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <cstdint>
+#include <cstddef>
+#include <ostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "cpu.h"
+#include "Bus.h"
+#include "cartridge.h"
+#include "mapper.h"
+
+class nes;
+class Symbols;
+
+// Guest code profiler. cpu::clock() calls onInstruction() at every opcode
+// fetch; the CPU cycles since the previous fetch (DMA stalls included) are
+// added to that instruction's counter, one array slot per PRG-ROM offset
+// (or per CPU address below $8000), and to the current call tree node.
+//
+// The call tree follows JSR/RTS, BRK and interrupts/RTI by stack pointer:
+// a return pops every frame it returns past, so RTS jump tables and
+// discarded return addresses do not leave it unbalanced. NMI handler time is
+// kept per NMI, from entry to its RTI.
+class Profiler {
+public:
+    enum class Kind : uint8_t { Root, Call, Nmi, Irq };
+
+    struct Node {
+        uint32_t parent = 0;
+        uint32_t key = 0;           // ROM_KEY | PRG offset, or CPU address
+        uint16_t addr = 0;          // CPU address it was entered at
+        Kind     kind = Kind::Root;
+        uint64_t calls = 0;
+        uint64_t self = 0;          // cycles, callees excluded
+        uint64_t inclusive = 0;     // filled in by callTree()
+    };
+
+    struct NmiStats {
+        uint64_t count = 0;
+        uint32_t last = 0;          // cycles
+        uint32_t max = 0;
+        double   average = 0.0;
+    };
+
+    static constexpr uint32_t ROM_KEY = 0x10000000;
+    static constexpr size_t   NMI_HISTORY = 128;
+
+    // Longest plausible gap between two fetches (a DMA stall plus an interrupt)
+    static constexpr uint64_t MAX_STEP = 1024;
+
+    Profiler() = default;
+    ~Profiler();
+
+    Profiler(const Profiler&) = delete;
+    Profiler& operator=(const Profiler&) = delete;
+
+    // Sizes the counters for the loaded cartridge, resets them and starts
+    // profiling. Call again after loading another ROM. null detaches.
+    void attach(nes* n);
+    bool attached() const { return m_nes != nullptr; }
+
+    // Pause and resume without losing the counters
+    void setRunning(bool running);
+    bool running() const;
+
+    // Clears every counter and the call tree
+    void reset();
+
+    // Hot path, from cpu::clock()
+    void onInstruction(const cpu& c, uint8_t opcode);
+
+    // From cpu::nmi() / cpu::irq() before the CPU pushes anything
+    void onInterrupt(const cpu& c, bool nmi);
+
+    uint64_t totalCycles() const { return m_total; }
+    uint64_t frames() const;
+
+    // Cycles spent on instructions at a CPU address under the current mapping
+    uint64_t cyclesAt(uint16_t addr) const;
+
+    // Per PRG-ROM offset, and per CPU address below $8000 (RAM, PRG-RAM code)
+    const std::vector<uint64_t>& prgCycles() const { return m_prg; }
+    const std::vector<uint64_t>& lowCycles() const { return m_low; }
+
+    // PRG-ROM cycles summed per bank of bankSize bytes
+    std::vector<uint64_t> bankCycles(uint32_t bankSize) const;
+
+    // Nodes with inclusive cycles; node 0 is the root, parents come first
+    std::vector<Node> callTree() const;
+
+    NmiStats nmiStats() const;
+
+    // Oldest first
+    std::vector<uint32_t> nmiHistory() const;
+
+    // "main;NMI nmi;$C123 12345" lines for flamegraph.pl / speedscope
+    void writeCollapsed(std::ostream& os, const Symbols* symbols) const;
+
+    // "nmi_handler", "$C123" or "$8123:05" (8 KB bank) for banked ROMs
+    std::string nodeName(const Node& node, const Symbols* symbols) const;
+
+private:
+    // What an opcode does to the call depth
+    enum Flow : uint8_t { None, Jsr, Brk, Return };
+
+    struct Frame {
+        uint32_t node;
+        uint8_t  sp;                // SP before the call pushed anything
+        uint64_t start;             // cycle it was entered
+    };
+
+    uint64_t* counter(const cpu& c, uint16_t addr);
+    void settle(const cpu& c, uint64_t now);
+    void discontinuity();
+    void push(Kind kind, uint32_t key, uint16_t addr, uint8_t sp, uint64_t now);
+    void popTo(uint8_t sp, uint64_t now);
+    uint32_t keyOf(uint16_t addr) const;
+
+    nes* m_nes = nullptr;
+
+    std::vector<uint64_t> m_prg = std::vector<uint64_t>(1);  // + 1 slot for unmapped fetches
+    std::vector<uint64_t> m_low = std::vector<uint64_t>(0x8000);
+    uint64_t  m_total = 0;
+    uint64_t* m_counter = nullptr;      // slot of the instruction in progress
+    uint64_t  m_last = 0;               // CPU cycle of the last fetch
+    Flow      m_pending = None;         // of the instruction in progress
+    Flow      m_flow[256] = {};
+    uint64_t  m_startFrame = 0;
+
+    std::vector<Node>  m_nodes;
+    std::vector<Frame> m_stack;
+    uint32_t m_current = 0;
+    std::unordered_map<uint64_t, uint32_t> m_children;  // parent << 32 | kind, key -> node
+
+    uint32_t m_nmi[NMI_HISTORY] = {};
+    uint64_t m_nmiCount = 0;
+    uint64_t m_nmiSum = 0;
+    uint32_t m_nmiMax = 0;
+};
+
+inline uint64_t* Profiler::counter(const cpu& c, uint16_t addr)
+{
+    if (addr < 0x8000) return &m_low[addr];
+
+    const cartridge* cart = c.bus_ptr->cart;
+    uint32_t offset = 0;
+    if (cart && cart->mapper && cart->mapper->cpuMapRead(addr, offset) && offset < m_prg.size() - 1)
+        return &m_prg[offset];
+    return &m_prg.back();
+}
+
+inline void Profiler::onInstruction(const cpu& c, uint8_t opcode)
+{
+    const uint64_t now = c.bus_ptr->clocks() / 3;
+    const uint64_t delta = now - m_last;
+    m_last = now;
+
+    // Anything else (state load, reset) is a jump in time, not CPU work
+    if (delta <= MAX_STEP) {
+        *m_counter += delta;
+        m_nodes[m_current].self += delta;
+        m_total += delta;
+        if (m_pending) settle(c, now);
+    } else {
+        discontinuity();
+    }
+
+    m_counter = counter(c, c.PC);
+    m_pending = m_flow[opcode];
+}
+
+#endif
@@ -0,0 +1,54 @@
+#ifndef ROMIMAGE_H
+#define ROMIMAGE_H
+
+#include <cstdint>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Read-only bytes of a ROM file, shared by every cartridge made from it.
+// The file is memory-mapped where the OS allows (pages are shared with the
+// page cache and with other processes), otherwise read into one buffer.
+// Hand the same shared_ptr to many instances to load a game once.
+class RomImage {
+public:
+    static std::shared_ptr<const RomImage> Open(const std::string& path, std::string* error = nullptr);
+    static std::shared_ptr<const RomImage> FromMemory(std::vector<uint8_t> bytes, const std::string& name = "");
+
+    ~RomImage();
+
+    RomImage(const RomImage&) = delete;
+    RomImage& operator=(const RomImage&) = delete;
+
+    const uint8_t* data() const { return m_data; }
+    size_t size() const { return m_size; }
+    bool mapped() const { return m_mapped; }
+    const std::string& path() const { return m_path; }
+
+    // CRC-32 of size bytes at offset. The last range asked for is kept, so
+    // every cartridge sharing the image hashes it once.
+    uint32_t crc32(size_t offset, size_t size) const;
+
+private:
+    RomImage() = default;
+
+    const uint8_t* m_data = nullptr;
+    size_t m_size = 0;
+    bool m_mapped = false;
+    std::string m_path;
+
+    std::vector<uint8_t> m_buffer;   // when not mapped
+
+    mutable std::mutex m_crcMutex;
+    mutable size_t   m_crcOffset = 0;
+    mutable size_t   m_crcSize = 0;
+    mutable uint32_t m_crc = 0;      // of [m_crcOffset, +m_crcSize)
+#ifdef _WIN32
+    void* m_file = nullptr;
+    void* m_mapping = nullptr;
+#endif
+};
+
+#endif
@@ -0,0 +1,93 @@
+#ifndef ROMLIBRARY_H
+#define ROMLIBRARY_H
+
+#include "cartridge.h"
+#include "hash.h"
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Index of the .nes files under a set of folders, kept in one binary file.
+// scan() walks the folders on a thread pool (one task per directory) and
+// only opens files whose size or mtime differ from the index: those are
+// mapped, their header parsed and PRG+CHR hashed (CRC-32 matches
+// Movie::RomCrc). Everything else costs one stat, so rescanning a large,
+// mostly unchanged library is quick. Scans run in the background; the
+// accessors return snapshots.
+class RomLibrary {
+public:
+    struct Entry {
+        std::string path;
+        uint64_t size = 0;
+        int64_t  mtime = 0;             // filesystem clock ticks
+        uint32_t crc32 = 0;             // PRG+CHR (whole file without a header)
+        Hash::Sha1::Digest sha1{};
+        bool     headerOk = false;
+        cartridge::Header header;
+
+        std::string name() const;       // file name without folders
+        bool playable() const { return headerOk && cartridge::SupportsMapper(header.mapper); }
+    };
+
+    struct Filter {
+        std::string text;               // in the file name or CRC-32, any case
+        int  mapper = -1;               // -1: any
+        bool playableOnly = false;
+    };
+
+    RomLibrary() = default;
+    ~RomLibrary();
+
+    RomLibrary(const RomLibrary&) = delete;
+    RomLibrary& operator=(const RomLibrary&) = delete;
+
+    // Loads the index at path (a missing file is an empty library) and
+    // writes it back after every completed scan
+    bool open(const std::string& path);
+    bool save() const;
+
+    // Folders scanned recursively; takes effect on the next scan
+    void setRoots(std::vector<std::string> roots);
+    std::vector<std::string> roots() const;
+
+    // Rescan the roots; a running scan is cancelled first
+    void scan();
+    void cancel();
+    void wait();
+
+    bool     scanning() const { return m_scanning; }
+    size_t   filesSeen() const { return m_seen; }
+    size_t   filesHashed() const { return m_hashed; }
+    double   lastScanMs() const { return m_lastScanMs; }
+
+    // Bumped whenever the entries change
+    uint64_t generation() const { return m_generation; }
+
+    size_t size() const;
+    std::vector<Entry> search(const Filter& filter) const;   // by path
+    std::vector<uint16_t> mappers() const;                   // distinct, sorted
+
+private:
+    void worker(std::vector<std::string> roots, std::vector<Entry> previous);
+    bool saveLocked() const;
+
+    mutable std::mutex m_mutex;
+    std::thread m_thread;
+    std::atomic<bool> m_cancel{ false };
+    std::atomic<bool> m_scanning{ false };
+    std::atomic<size_t> m_seen{ 0 };
+    std::atomic<size_t> m_hashed{ 0 };
+    std::atomic<double> m_lastScanMs{ 0.0 };
+    std::atomic<uint64_t> m_generation{ 0 };
+
+    // Guarded by m_mutex
+    std::string m_path;
+    std::vector<std::string> m_roots;
+    std::vector<Entry> m_entries;       // sorted by path
+};
+
+#endif
@@ -0,0 +1,129 @@
+#ifndef SAVESTATE_H
+#define SAVESTATE_H
+
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <string>
+
+class bus;
+class nes;
+
+// Save-state layout:
+//   "NESS" | u32 version | chunks...
+//   chunk = 4-char tag | u32 payload length | payload
+// Every device writes its own chunk, so a reader can skip tags it does not know.
+// Bump STATE_VERSION whenever a chunk payload changes shape.
+static constexpr uint32_t STATE_VERSION = 2;
+
+// Writes into a caller-owned buffer (no allocations).
+// A null buffer just measures the size needed.
+class StateWriter {
+public:
+    StateWriter(uint8_t* buf, size_t capacity) : buf(buf), cap(capacity) {}
+
+    void write(const void* src, size_t n) {
+        if (buf && pos + n <= cap) std::memcpy(buf + pos, src, n);
+        else if (buf) overflow = true;
+        pos += n;
+    }
+
+    template <typename T>
+    void pod(const T& v) { write(&v, sizeof(T)); }
+
+    void beginChunk(const char tag[4]) {
+        write(tag, 4);
+        chunkStart = pos;
+        uint32_t placeholder = 0;
+        pod(placeholder);
+    }
+
+    void endChunk() {
+        uint32_t len = (uint32_t)(pos - chunkStart - 4);
+        if (buf && !overflow) std::memcpy(buf + chunkStart, &len, 4);
+    }
+
+    size_t size() const { return pos; }
+    bool   ok()   const { return !overflow; }
+
+private:
+    uint8_t* buf = nullptr;
+    size_t   cap = 0;
+    size_t   pos = 0;
+    size_t   chunkStart = 0;
+    bool     overflow = false;
+};
+
+// Reads chunks back out of a buffer. openChunk() scopes reads to one chunk;
+// any read past its end marks the reader as failed.
+class StateReader {
+public:
+    StateReader(const uint8_t* buf, size_t size) : buf(buf), total(size) {}
+
+    bool readHeader(uint32_t& version) {
+        if (total < 8 || std::memcmp(buf, "NESS", 4) != 0) return false;
+        std::memcpy(&version, buf + 4, 4);
+        return true;
+    }
+
+    bool openChunk(const char tag[4]) {
+        size_t p = 8;
+        while (p + 8 <= total) {
+            uint32_t len = 0;
+            std::memcpy(&len, buf + p + 4, 4);
+            if (p + 8 + len > total) break;
+
+            if (std::memcmp(buf + p, tag, 4) == 0) {
+                pos = p + 8;
+                end = pos + len;
+                failed = false;
+                return true;
+            }
+            p += 8 + len;
+        }
+        failed = true;
+        return false;
+    }
+
+    void read(void* dst, size_t n) {
+        if (failed || pos + n > end) { failed = true; return; }
+        std::memcpy(dst, buf + pos, n);
+        pos += n;
+    }
+
+    template <typename T>
+    void pod(T& v) { read(&v, sizeof(T)); }
+
+    bool ok() const { return !failed; }
+
+    // Unread bytes of the open chunk
+    size_t remaining() const { return failed ? 0 : end - pos; }
+
+private:
+    const uint8_t* buf = nullptr;
+    size_t total = 0;
+    size_t pos = 0;
+    size_t end = 0;
+    bool   failed = false;
+};
+
+namespace SaveState {
+    // Whole-machine snapshot of everything hanging off the bus.
+    // Returns bytes written, or 0 if the buffer was too small.
+    size_t Save(const bus& b, uint8_t* out, size_t capacity);
+
+    // Bytes a Save() of this machine needs (constant for a given cartridge).
+    size_t Measure(const bus& b);
+
+    // Returns false (machine untouched) on a bad header, version or cartridge
+    // mismatch, or when any chunk is missing or not the size this machine writes.
+    bool Load(bus& b, const uint8_t* data, size_t size);
+
+    // File slots live next to the ROM: game.nes -> game.ss1, game.ss2, ...
+    std::string SlotPath(const std::string& romPath, int slot);
+    bool SaveToFile(const bus& b, const std::string& path);
+    // Through nes::loadState, so the fingerprint follows the loaded state
+    bool LoadFromFile(nes& n, const std::string& path);
+}
+
+#endif
@@ -0,0 +1,23 @@
+#ifndef STATECODEC_H
+#define STATECODEC_H
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+// Helpers for storing many snapshots cheaply.
+// Consecutive save states differ in a few hundred bytes, so a snapshot is
+// XORed against a keyframe (mostly zeros) and then run-length encoded.
+namespace StateCodec {
+    // out[i] = a[i] ^ b[i]; safe to call with out == a or out == b
+    void XorDelta(const uint8_t* a, const uint8_t* b, uint8_t* out, size_t n);
+
+    // RLE stream: [0x00 varint n, n literal bytes] | [0x01 varint n, byte] (byte repeated n times)
+    // Appends to out; returns the number of bytes appended.
+    size_t Compress(const uint8_t* in, size_t n, std::vector<uint8_t>& out);
+
+    // Decodes exactly outSize bytes; false on a malformed or short stream.
+    bool Decompress(const uint8_t* in, size_t n, uint8_t* out, size_t outSize);
+}
+
+#endif
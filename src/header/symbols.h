@@ -0,0 +1,41 @@
+#ifndef SYMBOLS_H
+#define SYMBOLS_H
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+
+class cartridge;
+
+// Labels for the debugger, from FCEUX .nl files or a ca65/ld65 .dbg file.
+// ROM labels are kept by PRG-ROM offset, so they follow bank switches;
+// everything below $8000 (RAM, registers, PRG-RAM), and ROM labels whose
+// offset is unknown, by CPU address.
+class Symbols {
+public:
+    // <rom>.ram.nl plus one <rom>.N.nl per 16 KB bank (N in hex), the
+    // FCEUX layout. True when at least one file was read.
+    bool loadNl(const std::string& romPath);
+
+    // ld65 --dbgfile output. Segments with an output offset ("ooffs") are
+    // taken to be in an iNES file after its 16-byte header.
+    bool loadDbg(const std::string& path, std::string* error = nullptr);
+
+    void clear();
+    size_t size() const { return m_cpu.size() + m_prg.size(); }
+
+    // Label of a CPU address under the cartridge's current mapping, or null
+    const std::string* find(const cartridge* cart, uint16_t addr) const;
+
+    // Label of a PRG-ROM offset, or null
+    const std::string* findPrg(uint32_t offset) const;
+
+private:
+    bool readNl(const std::string& path, long bank);
+    void add(bool rom, uint32_t key, const std::string& name);
+
+    std::unordered_map<uint32_t, std::string> m_cpu;    // by CPU address
+    std::unordered_map<uint32_t, std::string> m_prg;    // by PRG-ROM offset
+};
+
+#endif
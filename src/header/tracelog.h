@@ -0,0 +1,180 @@
+#ifndef TRACELOG_H
+#define TRACELOG_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstddef>
+#include <cstdio>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "cpu.h"
+#include "Bus.h"
+#include "ppu.h"
+
+class nes;
+
+// CPU instruction trace. cpu::clock() calls record() at every instruction
+// fetch, which fills one fixed-size entry of a single-producer ring:
+//   - FlightRecorder keeps the last `capacity` instructions in RAM. When
+//     cpu::XXX throws or the watchdog fires, they are dumped as text next to
+//     a save state.
+//   - Stream hands entries to a background thread that appends them to a
+//     binary file. The emulation thread only waits when the writer falls a
+//     whole ring behind.
+// Text export (nestest.log or Mesen layout) is done on demand, from the ring
+// or from a streamed file.
+class TraceLog {
+public:
+    enum class Mode { Off, FlightRecorder, Stream };
+    enum class Format { Nestest, Mesen };
+
+    // Register state before the instruction ran. No padding holes, so
+    // streamed files are the raw ring contents.
+    struct Entry {
+        uint64_t cycle;         // CPU cycles since power-on
+        uint16_t pc;
+        int16_t  scanline;
+        int16_t  dot;
+        uint8_t  bytes[3];      // opcode and operands
+        uint8_t  a, x, y, p, sp;
+        uint8_t  len;
+        uint8_t  reserved = 0;
+    };
+
+    struct Stats {
+        uint64_t recorded = 0;  // instructions since start
+        uint64_t written = 0;   // entries on disk (Stream)
+        uint64_t stalls = 0;    // times the CPU waited for the writer
+        std::string lastDump;   // text file of the last flight recorder dump
+    };
+
+    // Capacity is rounded up to a power of two
+    explicit TraceLog(size_t capacity = 100000);
+    ~TraceLog();
+
+    TraceLog(const TraceLog&) = delete;
+    TraceLog& operator=(const TraceLog&) = delete;
+
+    // The console to trace; null detaches
+    void attach(nes* n);
+
+    // Dumps go to dumpDir (created when needed)
+    void startFlightRecorder(const std::string& dumpDir);
+    bool startStream(const std::string& path, std::string* error = nullptr);
+    void stop();
+
+    Mode mode() const { return m_mode; }
+    const std::string& dumpDir() const { return m_dumpDir; }
+
+    // No frame completed in `ms` of emulation (wall clock, pauses left out):
+    // dump and throw std::runtime_error from the CPU, like an unknown opcode.
+    // This catches the emulator stalling, not a hung game: the PPU keeps
+    // finishing frames while the CPU spins. 0 turns it off.
+    void setWatchdog(unsigned ms) { m_watchdogMs = ms; }
+
+    // Hung game: for `frames` whole frames the PC stayed within 32 bytes (no
+    // NMI or IRQ handler ran) and the controllers did not change. Dumps and
+    // throws like setWatchdog(). A game that wanders through garbage code
+    // without faulting, or spins through a larger loop, is not caught.
+    // 0 turns it off.
+    void setHangWatchdog(unsigned frames) { m_hangFrames = frames; }
+
+    // Hot path, from cpu::clock()
+    void record(const cpu& c, uint8_t opcode);
+
+    // From cpu::XXX before it throws
+    void fault(const std::string& reason);
+
+    // Ring contents, oldest first (FlightRecorder; the unwritten tail in Stream)
+    std::vector<Entry> snapshot() const;
+
+    // <dumpDir>/trace-<time>.txt (nestest layout) and .state.
+    // Returns the text path, or empty on failure.
+    std::string dump(const std::string& reason);
+
+    Stats stats() const;
+
+    static void WriteText(std::ostream& os, const nes& n, const Entry* entries, size_t count, Format format);
+
+    // Streamed binary file -> text
+    static bool ExportFile(const nes& n, const std::string& binaryPath, const std::string& textPath,
+                           Format format, std::string* error = nullptr);
+
+private:
+    void waitForSpace(uint64_t head);
+    void checkWatchdog();
+    void resetWatchdog();
+    void writerMain();
+
+    const size_t m_capacity;
+    const uint64_t m_mask;
+    std::unique_ptr<Entry[]> m_ring;
+
+    nes* m_nes = nullptr;
+    Mode m_mode = Mode::Off;
+    uint8_t m_len[256] = {};        // instruction lengths, from the CPU's table
+
+    // Producer (emulation thread) and consumer (writer) on separate lines
+    alignas(64) std::atomic<uint64_t> m_head{ 0 };
+    uint64_t m_tailSeen = 0;        // producer's last look at m_tail
+    uint64_t m_start = 0;           // m_head when the mode started
+    uint64_t m_stalls = 0;
+    alignas(64) std::atomic<uint64_t> m_tail{ 0 };
+
+    std::FILE* m_file = nullptr;
+    std::thread m_writer;
+    std::atomic<bool> m_stopWriter{ false };
+
+    std::string m_dumpDir;
+    std::string m_lastDump;
+    unsigned m_dumps = 0;
+
+    unsigned m_watchdogMs = 0;
+    uint64_t m_watchdogFrame = 0;
+    std::chrono::steady_clock::duration m_watchdogStuck{};   // emulated time in this frame
+    std::chrono::steady_clock::time_point m_watchdogCheck;
+
+    unsigned m_hangFrames = 0;
+    unsigned m_hangCount = 0;       // frames spent in one small PC range
+    uint16_t m_pcLo = 0xFFFF;       // PC range since the last frame change
+    uint16_t m_pcHi = 0x0000;
+    uint16_t m_hangInput = 0;       // controllers when the count started
+};
+
+inline void TraceLog::record(const cpu& c, uint8_t opcode)
+{
+    const uint64_t h = m_head.load(std::memory_order_relaxed);
+    if (m_mode == Mode::Stream && h - m_tailSeen >= m_capacity) waitForSpace(h);
+
+    Entry& e = m_ring[h & m_mask];
+    const bus& b = *c.bus_ptr;
+    const ppu& p = *b.connectedPPU;
+
+    e.cycle = b.clocks() / 3;
+    e.pc = c.PC;
+    e.scanline = p.scanline;
+    e.dot = p.cycle;
+    e.len = m_len[opcode];
+    e.bytes[0] = opcode;
+    e.bytes[1] = e.len > 1 ? c.bus_ptr->read((uint16_t)(c.PC + 1), true) : 0;
+    e.bytes[2] = e.len > 2 ? c.bus_ptr->read((uint16_t)(c.PC + 2), true) : 0;
+    e.a = c.A;
+    e.x = c.X;
+    e.y = c.Y;
+    e.p = c.P;
+    e.sp = c.SP;
+
+    m_head.store(h + 1, std::memory_order_release);
+
+    if (c.PC < m_pcLo) m_pcLo = c.PC;
+    if (c.PC > m_pcHi) m_pcHi = c.PC;
+
+    if ((m_watchdogMs || m_hangFrames) && (h & 0xFFF) == 0) checkWatchdog();
+}
+
+#endif
@@ -0,0 +1,137 @@
+#include "header/memoryview.h"
+#include "header/nes.h"
+#include "header/mapper.h"
+
+#include <algorithm>
+
+const char* MemoryView::name(Space space)
+{
+    switch (space) {
+    case Space::CpuBus:     return "CPU memory";
+    case Space::CpuRam:     return "CPU RAM";
+    case Space::PrgRam:     return "PRG-RAM";
+    case Space::PrgRom:     return "PRG-ROM";
+    case Space::Chr:        return "CHR";
+    case Space::PpuBus:     return "PPU memory";
+    case Space::Nametables: return "Nametable RAM";
+    case Space::Palette:    return "Palette";
+    case Space::Oam:        return "OAM";
+    default:                return "?";
+    }
+}
+
+size_t MemoryView::size(const nes& n, Space space)
+{
+    const cartridge* cart = n.CART.get();
+    switch (space) {
+    case Space::CpuBus:     return 0x10000;
+    case Space::CpuRam:     return n.BUS.ram.size();
+    case Space::PrgRam:     return cart ? cart->prgRam.size() : 0;
+    case Space::PrgRom:     return cart ? cart->prgRom.size() : 0;
+    case Space::Chr:        return cart ? cart->chrRom.size() : 0;
+    case Space::PpuBus:     return 0x4000;
+    case Space::Nametables: return n.PPU.vram.size();
+    case Space::Palette:    return n.PPU.palette.size();
+    case Space::Oam:        return n.PPU.OAM.size();
+    default:                return 0;
+    }
+}
+
+uint8_t MemoryView::peek(nes& n, Space space, uint32_t addr)
+{
+    if (addr >= size(n, space)) return 0x00;
+
+    const cartridge* cart = n.CART.get();
+    switch (space) {
+    case Space::CpuBus:     return n.BUS.read((uint16_t)addr, true);
+    case Space::CpuRam:     return n.BUS.ram[addr];
+    case Space::PrgRam:     return cart->prgRam[addr];
+    case Space::PrgRom:     return cart->prgRom[addr];
+    case Space::Chr:        return cart->chrRom[addr];
+    case Space::PpuBus:     return n.PPU.ppuPeek((uint16_t)addr);
+    case Space::Nametables: return n.PPU.vram[addr];
+    case Space::Palette:    return n.PPU.palette[addr];
+    case Space::Oam:        return n.PPU.OAM[addr];
+    default:                return 0x00;
+    }
+}
+
+bool MemoryView::writable(const nes& n, Space space, uint32_t addr)
+{
+    if (addr >= size(n, space)) return false;
+
+    const bool chrRam = n.CART && n.CART->chrBanks == 0;
+    switch (space) {
+    case Space::CpuBus:
+        // Registers would act on the write; ROM is shared and immutable
+        return addr < 0x2000 || (n.CART && !n.CART->prgRam.empty() && addr >= 0x6000 && addr < 0x8000);
+    case Space::PrgRom:
+        return false;
+    case Space::Chr:
+        return chrRam;
+    case Space::PpuBus:
+        return addr >= 0x2000 || chrRam;
+    default:
+        return true;
+    }
+}
+
+bool MemoryView::poke(nes& n, Space space, uint32_t addr, uint8_t value)
+{
+    if (!writable(n, space, addr)) return false;
+
+    cartridge* cart = n.CART.get();
+    switch (space) {
+    case Space::CpuBus:
+        if (addr < 0x2000) n.BUS.ram[addr & 0x07FF] = value;
+        else cart->prgRam[cart->prgRamIndex(addr)] = value;
+        break;
+    case Space::CpuRam:     n.BUS.ram[addr] = value; break;
+    case Space::PrgRam:     cart->prgRam[addr] = value; break;
+    case Space::Chr:        cart->chrRam[addr] = value; break;
+    case Space::PpuBus:
+        if (addr >= 0x2000) {
+            n.PPU.ppuWrite((uint16_t)addr, value);
+        } else {
+            uint32_t mapped = 0;
+            if (!cart->mapper->ppuMapPeek((uint16_t)addr, mapped) || mapped >= cart->chrRam.size()) return false;
+            cart->chrRam[mapped] = value;
+        }
+        break;
+    case Space::Nametables: n.PPU.vram[addr] = value; break;
+    case Space::Palette:    n.PPU.palette[addr] = value & 0x3F; break;
+    case Space::Oam:        n.PPU.OAM[addr] = value; break;
+    default:                return false;
+    }
+
+    n.refreshFingerprint();
+    return true;
+}
+
+uint32_t MemoryView::age(const nes& n, Space space, uint32_t addr, uint8_t value)
+{
+    Shadow& s = m_shadow[(size_t)space];
+    const size_t bytes = size(n, space);
+    if (s.value.size() != bytes) {
+        s.value.assign(bytes, 0);
+        s.changed.assign(bytes, 0);
+    }
+    if (addr >= bytes) return UINT32_MAX;
+
+    uint32_t& changed = s.changed[addr];
+    if (changed == 0) {
+        changed = 1;
+    } else if (s.value[addr] != value) {
+        changed = m_tick;
+    }
+    s.value[addr] = value;
+    return changed == 1 ? UINT32_MAX : m_tick - changed;
+}
+
+void MemoryView::clear()
+{
+    for (Shadow& s : m_shadow) {
+        s.value.clear();
+        s.changed.clear();
+    }
+}
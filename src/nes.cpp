@@ -0,0 +1,134 @@
+#include "header/nes.h"
+#include "header/savestate.h"
+#include <iostream>
+
+nes::nes()
+{
+    CPU.connectBus(&BUS);
+    BUS.connectCpu(&CPU);
+    BUS.connectPPU(&PPU);
+    BUS.connectAPU(&APU);
+}
+
+bool nes::loadRom(const std::string& path, std::string* error)
+{
+    if (path.empty()) return false;
+
+    auto image = RomImage::Open(path, error);
+    if (!image) {
+        std::cout << "Cartridge open failed: " << path << "\n";
+        return false;
+    }
+    return loadRom(std::move(image), error);
+}
+
+bool nes::loadRom(std::shared_ptr<const RomImage> image, std::string* error)
+{
+    auto newCart = std::make_unique<cartridge>(std::move(image));
+    if (!newCart->valid) {
+        if (error) *error = newCart->error;
+        return false;
+    }
+
+    CART = std::move(newCart);
+    BUS.insertCartridge(CART.get());
+    attachFingerprint();
+
+    reset();
+    return true;
+}
+
+void nes::reset()
+{
+    BUS.reset();
+    PPU.frame_complete = false;
+    refreshFingerprint();
+}
+
+void nes::powerOn()
+{
+    if (CART) CART->reset();
+    PPU.reset();
+    APU.reset();
+
+    BUS.controller[0] = BUS.controller[1] = 0x00;
+    BUS.controller_state[0] = BUS.controller_state[1] = 0x00;
+    BUS.controller_strobe = 0x00;
+
+    reset();
+}
+
+void nes::runFrame()
+{
+    PPU.frame_complete = false;
+    BUS.breakRequested = false;
+    while (!PPU.frame_complete && !BUS.breakRequested) {
+        BUS.clock();
+    }
+}
+
+void nes::renderFrame()
+{
+    renderIndexed();
+    PPU.resolveFrame();
+}
+
+void nes::renderIndexed()
+{
+    PPU.renderBackground();
+    PPU.renderSprites();
+}
+
+size_t nes::instanceBytes() const
+{
+    return sizeof(nes) + (CART ? CART->instanceBytes() : 0);
+}
+
+size_t nes::sharedRomBytes() const
+{
+    return CART && CART->image ? CART->image->size() : 0;
+}
+
+size_t nes::stateSize() const
+{
+    return SaveState::Measure(BUS);
+}
+
+size_t nes::saveState(uint8_t* out, size_t capacity) const
+{
+    return SaveState::Save(BUS, out, capacity);
+}
+
+bool nes::loadState(const uint8_t* data, size_t size)
+{
+    bool ok = SaveState::Load(BUS, data, size);
+    refreshFingerprint();
+    return ok;
+}
+
+void nes::setFingerprinting(bool on)
+{
+    if (on == fingerprinting()) return;
+
+    m_fingerprint = on ? std::make_unique<Fingerprint>() : nullptr;
+    attachFingerprint();
+    refreshFingerprint();
+}
+
+void nes::attachFingerprint()
+{
+    Fingerprint* fp = m_fingerprint.get();
+    BUS.fingerprint = fp;
+    PPU.fingerprint = fp;
+    if (CART) CART->fingerprint = fp;
+}
+
+uint64_t nes::fingerprint() const
+{
+    return m_fingerprint ? m_fingerprint->value(*this) : 0;
+}
+
+void nes::refreshFingerprint()
+{
+    if (m_fingerprint) m_fingerprint->rebuild(*this);
+}
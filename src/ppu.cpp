@@ -1,5 +1,9 @@
 #include "header/ppu.h"
 #include "header/cartridge.h"
+#include "header/savestate.h"
+#include "header/fingerprint.h"
+#include "header/codedatalog.h"
+#include "header/eventlog.h"
 #include <cstdint>
 
 static const uint32_t nes_colors[64] = {
@@ -43,10 +47,118 @@ ppu::ppu() {
     }
 }
 
+void ppu::reset() {
+    PPUCTRL = PPUMASK = PPUSTATUS = OAMADDR = 0x00;
+    addr_latch = 0;
+    data_buffer = 0;
+    fine_x = 0;
+    vram_addr.reg = 0x0000;
+    tram_addr.reg = 0x0000;
+
+    scanline = 0;
+    cycle = 0;
+    frame_complete = false;
+    frameCount = 0;
+    nmi = false;
+
+    sprite0_hit_pending = false;
+    sprite0_hit_x = -1;
+    sprite0_hit_y = -1;
+
+    vram.fill(0x00);
+    palette.fill(0x00);
+    OAM.fill(0x00);
+    frame.fill(0x00000000);
+    frameIndex.fill(0x00);
+
+    dbg_scrollX.fill(0);
+    dbg_scrollY.fill(0);
+    dbg_baseNTX.fill(0);
+    dbg_baseNTY.fill(0);
+    dbg_bgPatternBase.fill(0x0000);
+    dbg_sprPatternBase.fill(0x0000);
+    dbg_sprite8x16.fill(false);
+}
+
 void ppu::connectCartridge(cartridge* c) {
     cart = c;
 }
 
+// -----------------------------
+// Save states
+// -----------------------------
+// The BGRA frame and pattern-table views are derived data and are not saved;
+// the per-scanline snapshots are, because the frame renderer reads them.
+void ppu::saveState(StateWriter& w) const
+{
+    w.pod(PPUCTRL);
+    w.pod(PPUMASK);
+    w.pod(PPUSTATUS);
+    w.pod(OAMADDR);
+
+    w.pod(addr_latch);
+    w.pod(data_buffer);
+    w.pod(fine_x);
+    w.pod(vram_addr.reg);
+    w.pod(tram_addr.reg);
+
+    w.pod(scanline);
+    w.pod(cycle);
+    w.pod(frame_complete);
+    w.pod(nmi);
+
+    w.pod(sprite0_hit_pending);
+    w.pod(sprite0_hit_x);
+    w.pod(sprite0_hit_y);
+
+    w.pod(vram);
+    w.pod(palette);
+    w.pod(OAM);
+
+    w.pod(dbg_scrollX);
+    w.pod(dbg_scrollY);
+    w.pod(dbg_baseNTX);
+    w.pod(dbg_baseNTY);
+    w.pod(dbg_bgPatternBase);
+    w.pod(dbg_sprPatternBase);
+    w.pod(dbg_sprite8x16);
+}
+
+void ppu::loadState(StateReader& r)
+{
+    r.pod(PPUCTRL);
+    r.pod(PPUMASK);
+    r.pod(PPUSTATUS);
+    r.pod(OAMADDR);
+
+    r.pod(addr_latch);
+    r.pod(data_buffer);
+    r.pod(fine_x);
+    r.pod(vram_addr.reg);
+    r.pod(tram_addr.reg);
+
+    r.pod(scanline);
+    r.pod(cycle);
+    r.pod(frame_complete);
+    r.pod(nmi);
+
+    r.pod(sprite0_hit_pending);
+    r.pod(sprite0_hit_x);
+    r.pod(sprite0_hit_y);
+
+    r.pod(vram);
+    r.pod(palette);
+    r.pod(OAM);
+
+    r.pod(dbg_scrollX);
+    r.pod(dbg_scrollY);
+    r.pod(dbg_baseNTX);
+    r.pod(dbg_baseNTY);
+    r.pod(dbg_bgPatternBase);
+    r.pod(dbg_sprPatternBase);
+    r.pod(dbg_sprite8x16);
+}
+
 // -----------------------------
 // Pixel helpers for sprite0 hit
 // -----------------------------
@@ -198,8 +310,14 @@ uint8_t ppu::cpuRead(uint16_t addr, bool readonly) {
         case 0x0007: { // PPUDATA
             uint16_t a = vram_addr.reg & 0x3FFF;
 
+            // A peek sees what the read would return, without the read
+            if (readonly)
+                return a >= 0x3F00 ? ppuPeek(a) : data_buffer;
+
             data = data_buffer;
+            CdlCpuChrAccess(cdl, true);
             data_buffer = ppuRead(a);
+            CdlCpuChrAccess(cdl, false);
 
             if (a >= 0x3F00)
                 data = data_buffer;
@@ -234,6 +352,7 @@ void ppu::cpuWrite(uint16_t addr, uint8_t data) {
         } break;
 
         case 0x0004: { // OAMDATA
+            FingerprintWrite(fingerprint, Fingerprint::Oam, OAMADDR, OAM[OAMADDR], data);
             OAM[OAMADDR] = data;
             OAMADDR++;
         } break;
@@ -298,7 +417,10 @@ void ppu::clock()
                 {
                     if (bgPixelNonZeroAt(x, y) && sprite0PixelNonZeroAt(x, y))
                     {
-                        if (x != 255) PPUSTATUS |= 0x40;
+                        if (x != 255) {
+                            PPUSTATUS |= 0x40;
+                            EventSignal(events, EventLog::Sprite0Hit);
+                        }
                     }
                 }
             }
@@ -322,30 +444,12 @@ void ppu::clock()
     if (scanline >= 0 && scanline < 240 && cycle == 257)
     {
         int next = scanline + 1;
-        if (next < 240) {
-            dbg_scrollX[next] = (int)tram_addr.coarse_x * 8 + (int)fine_x;
-            dbg_scrollY[next] = (int)tram_addr.coarse_y * 8 + (int)tram_addr.fine_y;
-            dbg_baseNTX[next] = tram_addr.nametable_x ? 1 : 0;
-            dbg_baseNTY[next] = tram_addr.nametable_y ? 1 : 0;
-
-            dbg_bgPatternBase[next]  = (PPUCTRL & 0x10) ? 0x1000 : 0x0000;
-            dbg_sprPatternBase[next] = (PPUCTRL & 0x08) ? 0x1000 : 0x0000;
-            dbg_sprite8x16[next]     = (PPUCTRL & 0x20) != 0;
-        }
+        if (next < 240) snapshotScanline(next);
     }
 
     // Seed scanline 0 at end of pre-render
     if (scanline == 261 && cycle == 257)
-    {
-        dbg_scrollX[0] = (int)tram_addr.coarse_x * 8 + (int)fine_x;
-        dbg_scrollY[0] = (int)tram_addr.coarse_y * 8 + (int)tram_addr.fine_y;
-        dbg_baseNTX[0] = tram_addr.nametable_x ? 1 : 0;
-        dbg_baseNTY[0] = tram_addr.nametable_y ? 1 : 0;
-
-        dbg_bgPatternBase[0]  = (PPUCTRL & 0x10) ? 0x1000 : 0x0000;
-        dbg_sprPatternBase[0] = (PPUCTRL & 0x08) ? 0x1000 : 0x0000;
-        dbg_sprite8x16[0]     = (PPUCTRL & 0x20) != 0;
-    }
+        snapshotScanline(0);
 
     // advance dot/scanline
     cycle++;
@@ -356,6 +460,8 @@ void ppu::clock()
         if (scanline >= 262) {
             scanline = 0;
             frame_complete = true;
+            frameCount++;
+            EventFrame(events);
         }
     }
 }
@@ -390,6 +496,27 @@ uint8_t ppu::ppuRead(uint16_t addr) {
     return 0x00;
 }
 
+uint8_t ppu::ppuPeek(uint16_t addr) const {
+    addr &= 0x3FFF;
+    uint8_t data = 0x00;
+
+    if (cart && cart->ppuPeek(addr, data))
+        return data;
+
+    if (addr >= 0x2000 && addr <= 0x3EFF) {
+        if (addr >= 0x3000) addr -= 0x1000;
+        return vram[mapNametableAddr(addr)];
+    }
+
+    if (addr >= 0x3F00) {
+        addr &= 0x001F;
+        if ((addr & 0x13) == 0x10) addr &= 0x0F;
+        return palette[addr];
+    }
+
+    return 0x00;
+}
+
 void ppu::ppuWrite(uint16_t addr, uint8_t data) {
     addr &= 0x3FFF;
 
@@ -399,6 +526,7 @@ void ppu::ppuWrite(uint16_t addr, uint8_t data) {
     if (addr >= 0x2000 && addr <= 0x3EFF) {
         if (addr >= 0x3000) addr -= 0x1000;
         uint16_t idx = mapNametableAddr(addr);
+        FingerprintWrite(fingerprint, Fingerprint::Vram, idx, vram[idx], data);
         vram[idx] = data;
         return;
     }
@@ -411,11 +539,28 @@ void ppu::ppuWrite(uint16_t addr, uint8_t data) {
         if (addr == 0x18) addr = 0x08;
         if (addr == 0x1C) addr = 0x0C;
 
+        FingerprintWrite(fingerprint, Fingerprint::Palette, addr, palette[addr], data);
         palette[addr] = data;
         return;
     }
 }
 
+void ppu::snapshotScanline(int y)
+{
+    const uint64_t before = FingerprintScanline(fingerprint, *this, y);
+
+    dbg_scrollX[y] = (int)tram_addr.coarse_x * 8 + (int)fine_x;
+    dbg_scrollY[y] = (int)tram_addr.coarse_y * 8 + (int)tram_addr.fine_y;
+    dbg_baseNTX[y] = tram_addr.nametable_x ? 1 : 0;
+    dbg_baseNTY[y] = tram_addr.nametable_y ? 1 : 0;
+
+    dbg_bgPatternBase[y]  = (PPUCTRL & 0x10) ? 0x1000 : 0x0000;
+    dbg_sprPatternBase[y] = (PPUCTRL & 0x08) ? 0x1000 : 0x0000;
+    dbg_sprite8x16[y]     = (PPUCTRL & 0x20) != 0;
+
+    FingerprintScanlineWrite(fingerprint, *this, y, before);
+}
+
 // -----------------------------
 // Pattern table viewer
 // -----------------------------
@@ -429,16 +574,17 @@ void ppu::updatePatternTable() {
                 int tileIndex = tileY * 16 + tileX;
                 uint16_t tileAddr = (uint16_t)table * 0x1000 + (uint16_t)tileIndex * 16;
 
+                // Peeks: the viewer must not move mapper latches or mark CHR in the CDL
                 for (int row = 0; row < 8; row++) {
-                    uint8_t plane0 = ppuRead(tileAddr + row);
-                    uint8_t plane1 = ppuRead(tileAddr + row + 8);
+                    uint8_t plane0 = ppuPeek(tileAddr + row);
+                    uint8_t plane1 = ppuPeek(tileAddr + row + 8);
 
                     for (int col = 0; col < 8; col++) {
                         uint8_t bit0 = (plane0 >> (7 - col)) & 1;
                         uint8_t bit1 = (plane1 >> (7 - col)) & 1;
                         uint8_t pixel = (bit1 << 1) | bit0;
 
-                        uint8_t pal = ppuRead(0x3F00 + pixel) & 0x3F;
+                        uint8_t pal = ppuPeek(0x3F00 + pixel) & 0x3F;
                         uint32_t color = nes_colors[pal];
 
                         int x = tileX * 8 + col;
@@ -494,9 +640,20 @@ void ppu::ppu_prefetch_bg_tiles_for_mmc2(ppu* self, int y, int scrollX, int scro
 // -----------------------------
 // Background renderer (frame-based)
 // -----------------------------
+uint32_t ppu::paletteColor(uint8_t index)
+{
+    return nes_colors[index & 0x3F];
+}
+
+void ppu::resolveFrame()
+{
+    for (size_t i = 0; i < frame.size(); i++)
+        frame[i] = nes_colors[frameIndex[i]];
+}
+
 void ppu::renderBackground() {
-    uint32_t bgColor = nes_colors[ppuRead(0x3F00) & 0x3F];
-    frame.fill(bgColor);
+    uint8_t bgIndex = ppuRead(0x3F00) & 0x3F;
+    frameIndex.fill(bgIndex);
 
     if (!(PPUMASK & 0x08))
         return;
@@ -558,7 +715,7 @@ void ppu::renderBackground() {
                 palIndex = ppuRead(0x3F00 + palSelect * 4 + pixel) & 0x3F;
             }
 
-            frame[y * 256 + x] = nes_colors[palIndex];
+            frameIndex[y * 256 + x] = palIndex;
         }
 
         ppu_prefetch_bg_tiles_for_mmc2(this, y, scrollX, scrollY, baseNTX, baseNTY, patternBase);
@@ -648,13 +805,15 @@ void ppu::renderSprites()
                 if (in_left8 && !spr_left8)
                     continue;
 
-                if (behindBG && frame[y * 256 + x] != bgColor)
+                const uint32_t under = nes_colors[frameIndex[y * 256 + x]];
+
+                if (behindBG && under != bgColor)
                     continue;
 
                 if (i == 0 && bg_enabled && spr_enabled) {
                     const bool bg_visible_here = !in_left8 || bg_left8;
                     if (bg_visible_here) {
-                        if (frame[y * 256 + x] != bgColor) {
+                        if (under != bgColor) {
                             if (x != 255) {
                                 if (!sprite0_hit_pending) {
                                     sprite0_hit_pending = true;
@@ -667,7 +826,7 @@ void ppu::renderSprites()
                 }
 
                 const uint8_t palIndex = ppuRead((uint16_t)(0x3F10 + palSel * 4 + pixel)) & 0x3F;
-                frame[y * 256 + x] = nes_colors[palIndex];
+                frameIndex[y * 256 + x] = palIndex;
             }
         }
     }
@@ -0,0 +1,265 @@
+#include "header/profiler.h"
+#include "header/nes.h"
+#include "header/symbols.h"
+
+#include <algorithm>
+#include <cstdio>
+
+namespace {
+
+constexpr uint8_t OP_BRK = 0x00;
+constexpr uint8_t OP_JSR = 0x20;
+constexpr uint8_t OP_RTI = 0x40;
+constexpr uint8_t OP_RTS = 0x60;
+
+// Call tree size limit; deeper paths are charged to the caller
+constexpr size_t MAX_NODES = 1 << 20;
+
+} // namespace
+
+void Profiler::attach(nes* n)
+{
+    if (m_nes && m_nes != n) m_nes->CPU.profiler = nullptr;
+    m_nes = n;
+
+    m_flow[OP_JSR] = Jsr;
+    m_flow[OP_BRK] = Brk;
+    m_flow[OP_RTS] = m_flow[OP_RTI] = Return;
+
+    m_prg.assign((n && n->CART ? n->CART->prgRom.size() : 0) + 1, 0);
+    reset();
+
+    if (n) n->CPU.profiler = this;
+}
+
+Profiler::~Profiler()
+{
+    attach(nullptr);
+}
+
+void Profiler::setRunning(bool running)
+{
+    if (!m_nes) return;
+    if (running && !this->running()) {
+        // Time spent paused is nobody's
+        m_last = m_nes->BUS.clocks() / 3;
+        m_counter = &m_prg.back();
+        m_pending = None;
+    }
+    m_nes->CPU.profiler = running ? this : nullptr;
+}
+
+bool Profiler::running() const
+{
+    return m_nes && m_nes->CPU.profiler == this;
+}
+
+void Profiler::reset()
+{
+    std::fill(m_prg.begin(), m_prg.end(), 0);
+    std::fill(m_low.begin(), m_low.end(), 0);
+    m_total = 0;
+    m_counter = &m_prg.back();
+    m_last = m_nes ? m_nes->BUS.clocks() / 3 : 0;
+    m_pending = None;
+    m_startFrame = m_nes ? m_nes->PPU.frameCount : 0;
+
+    m_nodes.assign(1, Node());
+    m_stack.clear();
+    m_children.clear();
+    m_current = 0;
+
+    std::fill(std::begin(m_nmi), std::end(m_nmi), 0);
+    m_nmiCount = m_nmiSum = 0;
+    m_nmiMax = 0;
+}
+
+uint64_t Profiler::frames() const
+{
+    return m_nes ? m_nes->PPU.frameCount - m_startFrame : 0;
+}
+
+uint32_t Profiler::keyOf(uint16_t addr) const
+{
+    uint32_t offset = 0;
+    const cartridge* cart = m_nes ? m_nes->CART.get() : nullptr;
+    if (addr >= 0x8000 && cart && cart->mapper && cart->mapper->cpuMapRead(addr, offset))
+        return ROM_KEY | offset;
+    return addr;
+}
+
+void Profiler::push(Kind kind, uint32_t key, uint16_t addr, uint8_t sp, uint64_t now)
+{
+    // Frames at or below the new one's stack level were abandoned
+    // (return address pulled off, or the stack reset)
+    popTo(sp, now);
+
+    const uint64_t id = (uint64_t)m_current << 32 | (uint64_t)kind << 29 | key;
+    auto it = m_children.find(id);
+    uint32_t node;
+    if (it != m_children.end()) {
+        node = it->second;
+    } else if (m_nodes.size() < MAX_NODES) {
+        node = (uint32_t)m_nodes.size();
+        Node n;
+        n.parent = m_current;
+        n.key = key;
+        n.addr = addr;
+        n.kind = kind;
+        m_nodes.push_back(n);
+        m_children.emplace(id, node);
+    } else {
+        node = m_current;
+    }
+
+    m_nodes[node].calls++;
+    m_stack.push_back({ m_current, sp, now });
+    m_current = node;
+}
+
+void Profiler::popTo(uint8_t sp, uint64_t now)
+{
+    // The stack grows down, so live frames were entered at a higher SP
+    while (!m_stack.empty() && m_stack.back().sp <= sp) {
+        const Frame f = m_stack.back();
+        m_stack.pop_back();
+
+        if (m_nodes[m_current].kind == Kind::Nmi) {
+            const uint32_t cycles = (uint32_t)std::min<uint64_t>(now - f.start, UINT32_MAX);
+            m_nmi[m_nmiCount % NMI_HISTORY] = cycles;
+            m_nmiCount++;
+            m_nmiSum += cycles;
+            m_nmiMax = std::max(m_nmiMax, cycles);
+        }
+        m_current = f.node;
+    }
+}
+
+// The previous instruction changed the call depth; c is the state after it
+void Profiler::settle(const cpu& c, uint64_t now)
+{
+    const Flow flow = m_pending;
+    m_pending = None;
+
+    if (flow == Jsr)
+        push(Kind::Call, keyOf(c.PC), c.PC, (uint8_t)(c.SP + 2), now);
+    else if (flow == Brk)
+        push(Kind::Irq, keyOf(c.PC), c.PC, (uint8_t)(c.SP + 3), now);
+    else if (flow == Return)
+        popTo(c.SP, now);
+}
+
+void Profiler::onInterrupt(const cpu& c, bool nmi)
+{
+    // Charge the interrupted instruction up to here; the entry sequence goes
+    // to the handler's first instruction
+    const uint64_t now = c.bus_ptr->clocks() / 3;
+    const uint64_t delta = now - m_last;
+    m_last = now;
+    if (delta > MAX_STEP) {
+        discontinuity();
+    } else {
+        *m_counter += delta;
+        m_nodes[m_current].self += delta;
+        m_total += delta;
+        if (m_pending) settle(c, now);
+    }
+
+    const uint16_t vector = nmi ? 0xFFFA : 0xFFFE;
+    const uint16_t handler = (uint16_t)(c.bus_ptr->read(vector, true) | c.bus_ptr->read(vector + 1, true) << 8);
+    push(nmi ? Kind::Nmi : Kind::Irq, keyOf(handler), handler, c.SP, now);
+    m_counter = counter(c, handler);
+}
+
+void Profiler::discontinuity()
+{
+    // The old call stack means nothing after a state load or reset
+    m_stack.clear();
+    m_current = 0;
+    m_pending = None;
+}
+
+uint64_t Profiler::cyclesAt(uint16_t addr) const
+{
+    if (addr < 0x8000) return m_low[addr];
+    const uint32_t key = keyOf(addr);
+    return (key & ROM_KEY) && (key & ~ROM_KEY) < m_prg.size() - 1 ? m_prg[key & ~ROM_KEY] : 0;
+}
+
+std::vector<uint64_t> Profiler::bankCycles(uint32_t bankSize) const
+{
+    const size_t size = m_prg.size() - 1;
+    std::vector<uint64_t> banks(bankSize ? (size + bankSize - 1) / bankSize : 0, 0);
+    for (size_t i = 0; i < size; i++)
+        if (m_prg[i]) banks[i / bankSize] += m_prg[i];
+    return banks;
+}
+
+std::vector<Profiler::Node> Profiler::callTree() const
+{
+    std::vector<Node> nodes = m_nodes;
+    for (Node& n : nodes) n.inclusive = n.self;
+
+    // Children always come after their parent
+    for (size_t i = nodes.size(); i-- > 1;)
+        nodes[nodes[i].parent].inclusive += nodes[i].inclusive;
+    return nodes;
+}
+
+Profiler::NmiStats Profiler::nmiStats() const
+{
+    NmiStats s;
+    s.count = m_nmiCount;
+    s.max = m_nmiMax;
+    if (m_nmiCount) {
+        s.last = m_nmi[(m_nmiCount - 1) % NMI_HISTORY];
+        s.average = (double)m_nmiSum / (double)m_nmiCount;
+    }
+    return s;
+}
+
+std::vector<uint32_t> Profiler::nmiHistory() const
+{
+    std::vector<uint32_t> out;
+    const uint64_t n = std::min<uint64_t>(m_nmiCount, NMI_HISTORY);
+    for (uint64_t i = m_nmiCount - n; i < m_nmiCount; i++)
+        out.push_back(m_nmi[i % NMI_HISTORY]);
+    return out;
+}
+
+std::string Profiler::nodeName(const Node& node, const Symbols* symbols) const
+{
+    if (node.kind == Kind::Root) return "main";
+
+    const bool rom = (node.key & ROM_KEY) != 0;
+    const std::string* label = nullptr;
+    if (symbols) label = rom ? symbols->findPrg(node.key & ~ROM_KEY) : symbols->find(nullptr, node.addr);
+
+    std::string name;
+    if (label) {
+        name = *label;
+    } else {
+        char buf[16];
+        // Past 32 KB the address alone is ambiguous; add the 8 KB bank
+        if (rom && m_prg.size() - 1 > 0x8000)
+            std::snprintf(buf, sizeof(buf), "$%04X:%02X", node.addr, (node.key & ~ROM_KEY) >> 13);
+        else
+            std::snprintf(buf, sizeof(buf), "$%04X", node.addr);
+        name = buf;
+    }
+
+    if (node.kind == Kind::Nmi) return "NMI " + name;
+    if (node.kind == Kind::Irq) return "IRQ " + name;
+    return name;
+}
+
+void Profiler::writeCollapsed(std::ostream& os, const Symbols* symbols) const
+{
+    std::vector<std::string> paths(m_nodes.size());
+    for (size_t i = 0; i < m_nodes.size(); i++) {
+        std::string name = nodeName(m_nodes[i], symbols);
+        std::replace(name.begin(), name.end(), ';', '_');
+        paths[i] = i == 0 ? name : paths[m_nodes[i].parent] + ";" + name;
+        if (m_nodes[i].self) os << paths[i] << ' ' << m_nodes[i].self << '\n';
+    }
+}
@@ -0,0 +1,116 @@
+#include "header/romimage.h"
+#include "header/hash.h"
+#include <algorithm>
+#include <fstream>
+#include <iterator>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+void setError(std::string* error, const char* msg)
+{
+    if (error) *error = msg;
+}
+
+} // namespace
+
+std::shared_ptr<const RomImage> RomImage::FromMemory(std::vector<uint8_t> bytes, const std::string& name)
+{
+    std::shared_ptr<RomImage> img(new RomImage());
+    img->m_buffer = std::move(bytes);
+    img->m_data = img->m_buffer.data();
+    img->m_size = img->m_buffer.size();
+    img->m_path = name;
+    return img;
+}
+
+std::shared_ptr<const RomImage> RomImage::Open(const std::string& path, std::string* error)
+{
+    std::shared_ptr<RomImage> img(new RomImage());
+    img->m_path = path;
+
+#ifdef _WIN32
+    HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+                              OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file != INVALID_HANDLE_VALUE) {
+        LARGE_INTEGER size;
+        if (GetFileSizeEx(file, &size) && size.QuadPart > 0) {
+            HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+            void* view = mapping ? MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) : nullptr;
+            if (view) {
+                img->m_file = file;
+                img->m_mapping = mapping;
+                img->m_data = static_cast<const uint8_t*>(view);
+                img->m_size = (size_t)size.QuadPart;
+                img->m_mapped = true;
+                return img;
+            }
+            if (mapping) CloseHandle(mapping);
+        }
+        CloseHandle(file);
+    }
+#else
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd >= 0) {
+        struct stat st;
+        if (fstat(fd, &st) == 0 && st.st_size > 0) {
+            void* view = mmap(nullptr, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+            if (view != MAP_FAILED) {
+                ::close(fd); // the mapping keeps the file alive
+                img->m_data = static_cast<const uint8_t*>(view);
+                img->m_size = (size_t)st.st_size;
+                img->m_mapped = true;
+                return img;
+            }
+        }
+        ::close(fd);
+    }
+#endif
+
+    // Fallback: plain read (empty files, pipes, filesystems without mmap)
+    std::ifstream ifs(path, std::ifstream::binary);
+    if (!ifs.is_open()) {
+        setError(error, "open failed");
+        return nullptr;
+    }
+
+    img->m_buffer.assign(std::istreambuf_iterator<char>(ifs), std::istreambuf_iterator<char>());
+    img->m_data = img->m_buffer.data();
+    img->m_size = img->m_buffer.size();
+    return img;
+}
+
+RomImage::~RomImage()
+{
+    if (!m_mapped) return;
+
+#ifdef _WIN32
+    UnmapViewOfFile(m_data);
+    CloseHandle(m_mapping);
+    CloseHandle(m_file);
+#else
+    munmap(const_cast<uint8_t*>(m_data), m_size);
+#endif
+}
+
+uint32_t RomImage::crc32(size_t offset, size_t size) const
+{
+    if (offset > m_size) return 0;
+    size = std::min(size, m_size - offset);
+
+    std::lock_guard<std::mutex> lock(m_crcMutex);
+    if (offset != m_crcOffset || size != m_crcSize) {
+        m_crc = Hash::Crc32(m_data + offset, size);
+        m_crcOffset = offset;
+        m_crcSize = size;
+    }
+    return m_crc;
+}
@@ -0,0 +1,388 @@
+#include "header/romlibrary.h"
+#include "header/romimage.h"
+#include "header/ThreadPool.h"
+
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <iterator>
+#include <unordered_map>
+
+namespace fs = std::filesystem;
+
+namespace {
+
+constexpr uint32_t INDEX_VERSION = 1;
+
+template <typename T>
+void putPod(std::vector<uint8_t>& out, const T& v)
+{
+    const uint8_t* p = reinterpret_cast<const uint8_t*>(&v);
+    out.insert(out.end(), p, p + sizeof(T));
+}
+
+template <typename T>
+bool getPod(const std::vector<uint8_t>& in, size_t& pos, T& v)
+{
+    if (sizeof(T) > in.size() - pos) return false;
+    std::memcpy(&v, in.data() + pos, sizeof(T));
+    pos += sizeof(T);
+    return true;
+}
+
+void putString(std::vector<uint8_t>& out, const std::string& s)
+{
+    putPod(out, (uint32_t)s.size());
+    out.insert(out.end(), s.begin(), s.end());
+}
+
+bool getString(const std::vector<uint8_t>& in, size_t& pos, std::string& s)
+{
+    uint32_t len = 0;
+    if (!getPod(in, pos, len) || len > in.size() - pos) return false;
+    s.assign(reinterpret_cast<const char*>(in.data() + pos), len);
+    pos += len;
+    return true;
+}
+
+std::string lower(std::string s)
+{
+    for (char& c : s) c = (char)std::tolower((unsigned char)c);
+    return s;
+}
+
+// Header fields, then the hashes of the bytes a cartridge would load
+// (zero-padded when the dump is short, as cartridge does)
+bool indexFile(RomLibrary::Entry& e)
+{
+    std::shared_ptr<const RomImage> img = RomImage::Open(e.path);
+    if (!img) return false;
+
+    const uint8_t* data = img->data();
+    const size_t size = img->size();
+
+    size_t begin = 0, want = size;
+    e.headerOk = cartridge::ParseHeader(data, size, e.header);
+    if (e.headerOk) {
+        begin = std::min(e.header.romOffset(), size);
+        want = (size_t)e.header.prgRomSize + e.header.chrRomSize;
+    }
+    const size_t have = std::min(want, size - begin);
+
+    Hash::Sha1 sha;
+    e.crc32 = Hash::Crc32(data + begin, have);
+    sha.update(data + begin, have);
+
+    static const uint8_t zeros[4096] = {};
+    for (size_t left = want - have; left > 0;) {
+        const size_t n = std::min(left, sizeof(zeros));
+        e.crc32 = Hash::Crc32(zeros, n, e.crc32);
+        sha.update(zeros, n);
+        left -= n;
+    }
+    e.sha1 = sha.finish();
+    return true;
+}
+
+// ---- index entries ----
+// u32 path length, path, u64 size, i64 mtime, u32 crc, sha1[20], u8 flags,
+// u16 mapper, u8 submapper, u8 mirror, u8 region, then six u32 sizes
+
+enum : uint8_t { F_HEADER = 1, F_NES20 = 2, F_BATTERY = 4, F_TRAINER = 8 };
+
+void putEntry(std::vector<uint8_t>& out, const RomLibrary::Entry& e)
+{
+    const cartridge::Header& h = e.header;
+    putString(out, e.path);
+    putPod(out, e.size);
+    putPod(out, e.mtime);
+    putPod(out, e.crc32);
+    out.insert(out.end(), e.sha1.begin(), e.sha1.end());
+
+    const uint8_t flags = (e.headerOk ? F_HEADER : 0) | (h.nes20 ? F_NES20 : 0) |
+                          (h.battery ? F_BATTERY : 0) | (h.trainer ? F_TRAINER : 0);
+    putPod(out, flags);
+    putPod(out, h.mapper);
+    putPod(out, h.submapper);
+    putPod(out, (uint8_t)h.mirror);
+    putPod(out, (uint8_t)h.region);
+    for (uint32_t v : { h.prgRomSize, h.chrRomSize, h.prgRamSize, h.prgNvramSize, h.chrRamSize, h.chrNvramSize })
+        putPod(out, v);
+}
+
+bool getEntry(const std::vector<uint8_t>& in, size_t& pos, RomLibrary::Entry& e)
+{
+    cartridge::Header& h = e.header;
+    uint8_t flags = 0, mirror = 0, region = 0;
+    if (!getString(in, pos, e.path) || !getPod(in, pos, e.size) || !getPod(in, pos, e.mtime) ||
+        !getPod(in, pos, e.crc32) || !getPod(in, pos, e.sha1) || !getPod(in, pos, flags) ||
+        !getPod(in, pos, h.mapper) || !getPod(in, pos, h.submapper) ||
+        !getPod(in, pos, mirror) || !getPod(in, pos, region))
+        return false;
+
+    for (uint32_t* v : { &h.prgRomSize, &h.chrRomSize, &h.prgRamSize, &h.prgNvramSize, &h.chrRamSize, &h.chrNvramSize })
+        if (!getPod(in, pos, *v)) return false;
+
+    e.headerOk  = (flags & F_HEADER) != 0;
+    h.nes20     = (flags & F_NES20) != 0;
+    h.battery   = (flags & F_BATTERY) != 0;
+    h.trainer   = (flags & F_TRAINER) != 0;
+    h.mirror    = (cartridge::Mirror)std::min<uint8_t>(mirror, (uint8_t)cartridge::Mirror::FOUR_SCREEN);
+    h.region    = (cartridge::Region)(region & 3);
+    return true;
+}
+
+} // namespace
+
+std::string RomLibrary::Entry::name() const
+{
+    const size_t sep = path.find_last_of("/\\");
+    return sep == std::string::npos ? path : path.substr(sep + 1);
+}
+
+RomLibrary::~RomLibrary()
+{
+    cancel();
+}
+
+bool RomLibrary::open(const std::string& path)
+{
+    cancel();
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_path = path;
+    m_roots.clear();
+    m_entries.clear();
+    m_generation++;
+
+    std::ifstream ifs(path, std::ifstream::binary);
+    if (!ifs.is_open()) return true;
+
+    std::vector<uint8_t> in((std::istreambuf_iterator<char>(ifs)), std::istreambuf_iterator<char>());
+
+    size_t pos = 4;
+    uint32_t version = 0, rootCount = 0, count = 0;
+    if (in.size() < 4 || std::memcmp(in.data(), "NESL", 4) != 0 ||
+        !getPod(in, pos, version) || version != INDEX_VERSION || !getPod(in, pos, rootCount)) {
+        std::cout << "ROM library index unreadable, starting over: " << path << "\n";
+        return false;
+    }
+
+    std::vector<std::string> roots(rootCount);
+    for (std::string& r : roots)
+        if (!getString(in, pos, r)) return false;
+
+    std::vector<Entry> entries;
+    if (!getPod(in, pos, count)) return false;
+    for (uint32_t i = 0; i < count; i++) {
+        Entry e;
+        if (!getEntry(in, pos, e)) return false;
+        entries.push_back(std::move(e));
+    }
+
+    m_roots = std::move(roots);
+    m_entries = std::move(entries);
+    return true;
+}
+
+bool RomLibrary::save() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return saveLocked();
+}
+
+// "NESL" u32 version, u32 root count, roots, u32 entry count, entries.
+// Written to a temporary file first so a crash cannot leave half an index.
+bool RomLibrary::saveLocked() const
+{
+    if (m_path.empty()) return false;
+
+    std::vector<uint8_t> out;
+    out.insert(out.end(), { 'N', 'E', 'S', 'L' });
+    putPod(out, INDEX_VERSION);
+    putPod(out, (uint32_t)m_roots.size());
+    for (const std::string& r : m_roots) putString(out, r);
+    putPod(out, (uint32_t)m_entries.size());
+    for (const Entry& e : m_entries) putEntry(out, e);
+
+    const std::string tmp = m_path + ".tmp";
+    {
+        std::ofstream ofs(tmp, std::ofstream::binary | std::ofstream::trunc);
+        if (!ofs.is_open()) {
+            std::cout << "ROM library index open failed: " << tmp << "\n";
+            return false;
+        }
+        ofs.write(reinterpret_cast<const char*>(out.data()), (std::streamsize)out.size());
+        if (!ofs.good()) return false;
+    }
+
+    std::error_code ec;
+    fs::rename(tmp, m_path, ec);
+    if (!ec) return true;
+    fs::remove(tmp, ec);
+    return false;
+}
+
+void RomLibrary::setRoots(std::vector<std::string> roots)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_roots = std::move(roots);
+}
+
+std::vector<std::string> RomLibrary::roots() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_roots;
+}
+
+void RomLibrary::scan()
+{
+    cancel();
+
+    std::vector<std::string> roots;
+    std::vector<Entry> previous;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        roots = m_roots;
+        previous = m_entries;
+    }
+
+    m_seen = 0;
+    m_hashed = 0;
+    m_scanning = true;
+    m_thread = std::thread(&RomLibrary::worker, this, std::move(roots), std::move(previous));
+}
+
+void RomLibrary::cancel()
+{
+    m_cancel = true;
+    wait();
+    m_cancel = false;
+}
+
+void RomLibrary::wait()
+{
+    if (m_thread.joinable()) m_thread.join();
+}
+
+void RomLibrary::worker(std::vector<std::string> roots, std::vector<Entry> previous)
+{
+    const auto t0 = std::chrono::steady_clock::now();
+    ThreadPool pool;
+
+    // Walk: every directory is a task, subdirectories are queued from it
+    std::mutex foundMutex;
+    std::vector<Entry> found;
+
+    std::function<void(fs::path)> walk = [&](fs::path dir) {
+        std::vector<Entry> local;
+        std::error_code ec;
+        fs::directory_iterator it(dir, fs::directory_options::skip_permission_denied, ec), end;
+        for (; !ec && it != end && !m_cancel; it.increment(ec)) {
+            std::error_code sec;
+            // Linked directories are skipped, so a link cycle cannot loop the walk
+            if (it->is_directory(sec) && !it->is_symlink(sec)) {
+                pool.submit([&walk, p = it->path()] { walk(p); });
+                continue;
+            }
+            if (!it->is_regular_file(sec) || lower(it->path().extension().string()) != ".nes")
+                continue;
+
+            Entry e;
+            e.path = it->path().string();
+            e.size = (uint64_t)it->file_size(sec);
+            e.mtime = (int64_t)it->last_write_time(sec).time_since_epoch().count();
+            if (!sec) local.push_back(std::move(e));
+        }
+
+        m_seen += local.size();
+        std::lock_guard<std::mutex> lock(foundMutex);
+        for (Entry& e : local) found.push_back(std::move(e));
+    };
+
+    for (const std::string& r : roots)
+        pool.submit([&walk, r] { walk(fs::path(r)); });
+    pool.wait();
+
+    // Unchanged files keep their indexed data; the rest are hashed
+    std::unordered_map<std::string, const Entry*> known;
+    for (const Entry& e : previous) known.emplace(e.path, &e);
+
+    std::sort(found.begin(), found.end(), [](const Entry& a, const Entry& b) { return a.path < b.path; });
+    found.erase(std::unique(found.begin(), found.end(), [](const Entry& a, const Entry& b) { return a.path == b.path; }),
+                found.end());
+
+    std::vector<size_t> stale;
+    for (size_t i = 0; i < found.size(); i++) {
+        auto k = known.find(found[i].path);
+        if (k != known.end() && k->second->size == found[i].size && k->second->mtime == found[i].mtime)
+            found[i] = *k->second;
+        else
+            stale.push_back(i);
+    }
+
+    std::vector<uint8_t> ok(found.size(), 1);
+    pool.parallelFor(stale.size(), [&](size_t i) {
+        if (m_cancel) return;
+        ok[stale[i]] = indexFile(found[stale[i]]) ? 1 : 0;
+        m_hashed++;
+    });
+
+    if (!m_cancel) {
+        std::vector<Entry> entries;
+        entries.reserve(found.size());
+        for (size_t i = 0; i < found.size(); i++)
+            if (ok[i]) entries.push_back(std::move(found[i]));
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_entries = std::move(entries);
+        m_generation++;
+        m_lastScanMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+        saveLocked();
+    }
+
+    m_scanning = false;
+}
+
+size_t RomLibrary::size() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_entries.size();
+}
+
+std::vector<RomLibrary::Entry> RomLibrary::search(const Filter& filter) const
+{
+    const std::string text = lower(filter.text);
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    std::vector<Entry> out;
+    for (const Entry& e : m_entries) {
+        if (filter.mapper >= 0 && (!e.headerOk || e.header.mapper != filter.mapper)) continue;
+        if (filter.playableOnly && !e.playable()) continue;
+        if (!text.empty()) {
+            char crc[9];
+            std::snprintf(crc, sizeof(crc), "%08x", e.crc32);
+            if (lower(e.name()).find(text) == std::string::npos && std::string(crc).find(text) == std::string::npos)
+                continue;
+        }
+        out.push_back(e);
+    }
+    return out;
+}
+
+std::vector<uint16_t> RomLibrary::mappers() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    std::vector<uint16_t> out;
+    for (const Entry& e : m_entries)
+        if (e.headerOk) out.push_back(e.header.mapper);
+    std::sort(out.begin(), out.end());
+    out.erase(std::unique(out.begin(), out.end()), out.end());
+    return out;
+}
@@ -0,0 +1,183 @@
+#include "header/savestate.h"
+#include "header/Bus.h"
+#include "header/cpu.h"
+#include "header/ppu.h"
+#include "header/apu.h"
+#include "header/cartridge.h"
+#include "header/mapper.h"
+#include "header/nes.h"
+#include <fstream>
+#include <iostream>
+#include <vector>
+
+namespace {
+
+void writeAll(const bus& b, StateWriter& w)
+{
+    w.write("NESS", 4);
+    w.pod(STATE_VERSION);
+
+    if (b.connectedCPU) { w.beginChunk("CPU "); b.connectedCPU->saveState(w); w.endChunk(); }
+    if (b.connectedPPU) { w.beginChunk("PPU "); b.connectedPPU->saveState(w); w.endChunk(); }
+    if (b.connectedAPU) { w.beginChunk("APU "); b.connectedAPU->saveState(w); w.endChunk(); }
+
+    w.beginChunk("BUS ");
+    b.saveState(w);
+    w.endChunk();
+
+    if (b.cart) {
+        w.beginChunk("CART");
+        b.cart->saveState(w);
+        w.endChunk();
+
+        if (b.cart->mapper) {
+            w.beginChunk("MAPR");
+            b.cart->mapper->saveState(w);
+            w.endChunk();
+        }
+    }
+}
+
+// Bytes a device writes into its chunk
+template <typename Device>
+size_t payloadSize(const Device& d)
+{
+    StateWriter w(nullptr, 0);
+    d.saveState(w);
+    return w.size();
+}
+
+} // namespace
+
+namespace SaveState {
+
+size_t Save(const bus& b, uint8_t* out, size_t capacity)
+{
+    StateWriter w(out, capacity);
+    writeAll(b, w);
+    return w.ok() ? w.size() : 0;
+}
+
+size_t Measure(const bus& b)
+{
+    StateWriter w(nullptr, 0);
+    writeAll(b, w);
+    return w.size();
+}
+
+bool Load(bus& b, const uint8_t* data, size_t size)
+{
+    StateReader r(data, size);
+
+    uint32_t version = 0;
+    if (!r.readHeader(version) || version != STATE_VERSION)
+        return false;
+
+    // Refuse states taken with another cartridge (or without one)
+    if (b.cart) {
+        if (!r.openChunk("CART")) return false;
+
+        uint8_t  id = 0;
+        uint32_t prgSize = 0;
+        uint32_t chrSize = 0;
+        uint32_t crc = 0;
+        r.pod(id);
+        r.pod(prgSize);
+        r.pod(chrSize);
+        r.pod(crc);
+
+        if (!r.ok() || id != b.cart->mapperID ||
+            prgSize != b.cart->prgRom.size() || chrSize != b.cart->chrRom.size() ||
+            crc != b.cart->romCrc)
+            return false;
+    }
+
+    // Every chunk this machine needs must be present and exactly the size it
+    // would write before anything is applied, so no load below can run short
+    // and leave the machine half restored
+    auto fits = [&r](const char* tag, size_t expected) {
+        return r.openChunk(tag) && r.remaining() == expected;
+    };
+    if ((b.connectedCPU && !fits("CPU ", payloadSize(*b.connectedCPU))) ||
+        (b.connectedPPU && !fits("PPU ", payloadSize(*b.connectedPPU))) ||
+        (b.connectedAPU && !fits("APU ", payloadSize(*b.connectedAPU))) ||
+        !fits("BUS ", payloadSize(b)))
+        return false;
+
+    if (b.cart) {
+        if (!fits("CART", payloadSize(*b.cart))) return false;
+
+        // Stateless mappers write an empty chunk; older states may lack it
+        const size_t mapperSize = b.cart->mapper ? payloadSize(*b.cart->mapper) : 0;
+        if (mapperSize && !fits("MAPR", mapperSize)) return false;
+    }
+
+    if (b.connectedCPU) { r.openChunk("CPU "); b.connectedCPU->loadState(r); }
+    if (b.connectedPPU) { r.openChunk("PPU "); b.connectedPPU->loadState(r); }
+    if (b.connectedAPU) { r.openChunk("APU "); b.connectedAPU->loadState(r); }
+
+    r.openChunk("BUS ");
+    b.loadState(r);
+
+    if (b.cart) {
+        r.openChunk("CART");
+        b.cart->loadState(r);
+
+        if (b.cart->mapper && r.openChunk("MAPR"))
+            b.cart->mapper->loadState(r);
+    }
+
+    return r.ok();
+}
+
+std::string SlotPath(const std::string& romPath, int slot)
+{
+    std::string base = romPath;
+    size_t dot = base.find_last_of('.');
+    size_t sep = base.find_last_of("/\\");
+    if (dot != std::string::npos && (sep == std::string::npos || dot > sep))
+        base.resize(dot);
+
+    return base + ".ss" + std::to_string(slot);
+}
+
+bool SaveToFile(const bus& b, const std::string& path)
+{
+    std::vector<uint8_t> buf(Measure(b));
+    size_t n = Save(b, buf.data(), buf.size());
+    if (n == 0) return false;
+
+    std::ofstream ofs(path, std::ofstream::binary);
+    if (!ofs.is_open()) {
+        std::cout << "Save state open failed: " << path << "\n";
+        return false;
+    }
+
+    ofs.write(reinterpret_cast<const char*>(buf.data()), (std::streamsize)n);
+    return ofs.good();
+}
+
+bool LoadFromFile(nes& n, const std::string& path)
+{
+    std::ifstream ifs(path, std::ifstream::binary | std::ifstream::ate);
+    if (!ifs.is_open()) {
+        std::cout << "Save state open failed: " << path << "\n";
+        return false;
+    }
+
+    std::streamsize size = ifs.tellg();
+    if (size <= 0) return false;
+
+    std::vector<uint8_t> buf((size_t)size);
+    ifs.seekg(0);
+    ifs.read(reinterpret_cast<char*>(buf.data()), size);
+    if (!ifs) return false;
+
+    if (!n.loadState(buf.data(), buf.size())) {
+        std::cout << "Save state rejected: " << path << "\n";
+        return false;
+    }
+    return true;
+}
+
+} // namespace SaveState
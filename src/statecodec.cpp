@@ -0,0 +1,108 @@
+#include "header/statecodec.h"
+#include <cstring>
+
+namespace {
+
+void putVarint(std::vector<uint8_t>& out, size_t v)
+{
+    while (v >= 0x80) {
+        out.push_back((uint8_t)(v | 0x80));
+        v >>= 7;
+    }
+    out.push_back((uint8_t)v);
+}
+
+bool getVarint(const uint8_t* in, size_t n, size_t& pos, size_t& v)
+{
+    v = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+        if (pos >= n) return false;
+        uint8_t b = in[pos++];
+        v |= (size_t)(b & 0x7F) << shift;
+        if (!(b & 0x80)) return true;
+    }
+    return false;
+}
+
+// Runs shorter than this are cheaper to keep inside a literal
+constexpr size_t MIN_RUN = 4;
+
+} // namespace
+
+namespace StateCodec {
+
+void XorDelta(const uint8_t* a, const uint8_t* b, uint8_t* out, size_t n)
+{
+    // Word-at-a-time; snapshots are a few KB so this stays in cache
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        uint64_t x, y;
+        std::memcpy(&x, a + i, 8);
+        std::memcpy(&y, b + i, 8);
+        x ^= y;
+        std::memcpy(out + i, &x, 8);
+    }
+    for (; i < n; i++) out[i] = a[i] ^ b[i];
+}
+
+size_t Compress(const uint8_t* in, size_t n, std::vector<uint8_t>& out)
+{
+    size_t start = out.size();
+    size_t i = 0;
+    size_t litStart = 0;
+
+    auto flushLiteral = [&](size_t end) {
+        if (end <= litStart) return;
+        out.push_back(0x00);
+        putVarint(out, end - litStart);
+        out.insert(out.end(), in + litStart, in + end);
+    };
+
+    while (i < n) {
+        size_t run = 1;
+        while (i + run < n && in[i + run] == in[i]) run++;
+
+        if (run >= MIN_RUN) {
+            flushLiteral(i);
+            out.push_back(0x01);
+            putVarint(out, run);
+            out.push_back(in[i]);
+            i += run;
+            litStart = i;
+        } else {
+            i += run;
+        }
+    }
+    flushLiteral(n);
+
+    return out.size() - start;
+}
+
+bool Decompress(const uint8_t* in, size_t n, uint8_t* out, size_t outSize)
+{
+    size_t pos = 0;
+    size_t o = 0;
+
+    while (pos < n) {
+        uint8_t kind = in[pos++];
+        size_t len = 0;
+        if (!getVarint(in, n, pos, len)) return false;
+        if (len > outSize - o) return false;
+
+        if (kind == 0x00) {
+            if (len > n - pos) return false;
+            std::memcpy(out + o, in + pos, len);
+            pos += len;
+        } else if (kind == 0x01) {
+            if (pos >= n) return false;
+            std::memset(out + o, in[pos++], len);
+        } else {
+            return false;
+        }
+        o += len;
+    }
+
+    return o == outSize;
+}
+
+} // namespace StateCodec
@@ -0,0 +1,179 @@
+#include "header/symbols.h"
+#include "header/cartridge.h"
+#include "header/mapper.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <map>
+#include <vector>
+
+namespace {
+
+constexpr uint32_t NL_BANK_SIZE = 0x4000;
+constexpr long     INES_HEADER = 16;
+
+// key=value pairs of one .dbg line, after the record type
+std::map<std::string, std::string> dbgFields(const std::string& line, size_t pos)
+{
+    std::map<std::string, std::string> fields;
+    while (pos < line.size()) {
+        size_t eq = line.find('=', pos);
+        if (eq == std::string::npos) break;
+        std::string key = line.substr(pos, eq - pos);
+
+        std::string value;
+        size_t i = eq + 1;
+        if (i < line.size() && line[i] == '"') {
+            for (i++; i < line.size() && line[i] != '"'; i++) value += line[i];
+            i++;
+        } else {
+            for (; i < line.size() && line[i] != ','; i++) value += line[i];
+        }
+
+        fields[key] = value;
+        pos = (i < line.size() && line[i] == ',') ? i + 1 : i;
+    }
+    return fields;
+}
+
+long field(const std::map<std::string, std::string>& f, const char* key, long fallback)
+{
+    auto it = f.find(key);
+    return it == f.end() ? fallback : std::strtol(it->second.c_str(), nullptr, 0);
+}
+
+} // namespace
+
+bool Symbols::loadNl(const std::string& romPath)
+{
+    bool any = readNl(romPath + ".ram.nl", -1);
+
+    // Stop at the first missing bank; FCEUX writes them in order
+    for (long bank = 0; bank < 256; bank++) {
+        char name[16];
+        std::snprintf(name, sizeof(name), ".%lX.nl", bank);
+        bool found = readNl(romPath + name, bank);
+        if (!found && bank >= 10) {
+            std::snprintf(name, sizeof(name), ".%lx.nl", bank);
+            found = readNl(romPath + name, bank);
+        }
+        if (!found) break;
+        any = true;
+    }
+    return any;
+}
+
+bool Symbols::readNl(const std::string& path, long bank)
+{
+    std::ifstream in(path);
+    if (!in) return false;
+
+    // $C000#Reset#comment, or $0300/10#buffer# for a 16-byte array
+    std::string line;
+    while (std::getline(in, line)) {
+        if (line.size() < 2 || line[0] != '$') continue;
+
+        char* end = nullptr;
+        unsigned long addr = std::strtoul(line.c_str() + 1, &end, 16);
+        size_t hash = line.find('#');
+        if (hash == std::string::npos || addr > 0xFFFF) continue;
+
+        size_t close = line.find('#', hash + 1);
+        std::string name = line.substr(hash + 1, close == std::string::npos ? std::string::npos : close - hash - 1);
+        while (!name.empty() && (name.back() == '\r' || name.back() == ' ')) name.pop_back();
+        if (name.empty()) continue;
+
+        if (bank < 0 || addr < 0x8000)
+            add(false, (uint32_t)addr, name);
+        else
+            add(true, (uint32_t)bank * NL_BANK_SIZE + (uint32_t)(addr & (NL_BANK_SIZE - 1)), name);
+    }
+    return true;
+}
+
+bool Symbols::loadDbg(const std::string& path, std::string* error)
+{
+    std::ifstream in(path);
+    if (!in) {
+        if (error) *error = "cannot open " + path;
+        return false;
+    }
+
+    struct Segment {
+        long start = 0;
+        long ooffs = -1;
+    };
+    std::map<long, Segment> segments;
+    std::vector<std::map<std::string, std::string>> syms;
+
+    // Symbols may come before their segments, so collect first
+    std::string line;
+    while (std::getline(in, line)) {
+        if (!line.empty() && line.back() == '\r') line.pop_back();
+
+        if (line.compare(0, 4, "seg\t") == 0 || line.compare(0, 4, "seg ") == 0) {
+            auto f = dbgFields(line, 4);
+            Segment s;
+            s.start = field(f, "start", 0);
+            s.ooffs = field(f, "ooffs", -1);
+            segments[field(f, "id", -1)] = s;
+        } else if (line.compare(0, 4, "sym\t") == 0 || line.compare(0, 4, "sym ") == 0) {
+            syms.push_back(dbgFields(line, 4));
+        }
+    }
+
+    size_t before = size();
+    for (const auto& f : syms) {
+        auto type = f.find("type");
+        auto name = f.find("name");
+        if (type == f.end() || type->second != "lab" || name == f.end()) continue;
+
+        long val = field(f, "val", -1);
+        if (val < 0 || val > 0xFFFF) continue;
+
+        auto seg = segments.find(field(f, "seg", -1));
+        if (val >= 0x8000 && seg != segments.end() && seg->second.ooffs >= INES_HEADER)
+            add(true, (uint32_t)(seg->second.ooffs - INES_HEADER + (val - seg->second.start)), name->second);
+        else
+            add(false, (uint32_t)val, name->second);
+    }
+
+    if (size() == before && error) *error = "no labels in " + path;
+    return size() != before;
+}
+
+void Symbols::clear()
+{
+    m_cpu.clear();
+    m_prg.clear();
+}
+
+void Symbols::add(bool rom, uint32_t key, const std::string& name)
+{
+    // First label wins; cheap local labels (@loop) only where there is nothing else
+    auto& table = rom ? m_prg : m_cpu;
+    auto it = table.find(key);
+    if (it == table.end())
+        table.emplace(key, name);
+    else if (it->second[0] == '@' && name[0] != '@')
+        it->second = name;
+}
+
+const std::string* Symbols::find(const cartridge* cart, uint16_t addr) const
+{
+    // ROM labels by the bank mapped now; .dbg labels without an output
+    // offset are kept by CPU address, also at $8000 and up
+    uint32_t offset = 0;
+    if (addr >= 0x8000 && !m_prg.empty() && cart && cart->mapper && cart->mapper->cpuMapRead(addr, offset))
+        if (const std::string* name = findPrg(offset)) return name;
+
+    auto it = m_cpu.find(addr);
+    return it == m_cpu.end() ? nullptr : &it->second;
+}
+
+const std::string* Symbols::findPrg(uint32_t offset) const
+{
+    auto it = m_prg.find(offset);
+    return it == m_prg.end() ? nullptr : &it->second;
+}
@@ -0,0 +1,341 @@
+#include "header/tracelog.h"
+#include "header/nes.h"
+#include "header/disassembly.h"
+#include "header/savestate.h"
+
+#include <algorithm>
+#include <cstring>
+#include <ctime>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+
+namespace fs = std::filesystem;
+
+namespace {
+
+constexpr char     FILE_MAGIC[4] = { 'N', 'T', 'R', 'C' };
+constexpr uint32_t FILE_VERSION = 1;
+
+// Entries written per fwrite by the stream writer
+constexpr size_t WRITE_CHUNK = 4096;
+
+// Watchdog checks run every 4096 instructions; a longer gap is a pause
+constexpr std::chrono::milliseconds WATCHDOG_PAUSE(100);
+
+// A PC range this small for whole frames is a spin loop no interrupt left
+constexpr uint16_t HANG_SPAN = 32;
+
+size_t roundUp(size_t n)
+{
+    size_t p = 1;
+    while (p < n) p <<= 1;
+    return p;
+}
+
+void formatEntry(std::ostream& os, const nes& n, const TraceLog::Entry& e, TraceLog::Format format)
+{
+    Disassembly::Line line;
+    line.addr = e.pc;
+    line.len = e.len ? e.len : 1;
+    const char* name = n.CPU.opName(e.bytes[0]);
+    line.data = name[0] == 'X' && name[1] == 'X' && name[2] == 'X';
+    for (int i = 0; i < 3; i++) line.bytes[i] = e.bytes[i];
+    const std::string text = Disassembly::format(n, line, nullptr);
+
+    char bytes[12];
+    if (line.len == 1)      std::snprintf(bytes, sizeof(bytes), "%02X", e.bytes[0]);
+    else if (line.len == 2) std::snprintf(bytes, sizeof(bytes), "%02X %02X", e.bytes[0], e.bytes[1]);
+    else                    std::snprintf(bytes, sizeof(bytes), "%02X %02X %02X", e.bytes[0], e.bytes[1], e.bytes[2]);
+
+    char out[160];
+    if (format == TraceLog::Format::Nestest) {
+        std::snprintf(out, sizeof(out), "%04X  %-8s  %-32sA:%02X X:%02X Y:%02X P:%02X SP:%02X PPU:%3d,%3d CYC:%llu\n",
+                      e.pc, bytes, text.c_str(), e.a, e.x, e.y, e.p, e.sp, e.scanline, e.dot,
+                      (unsigned long long)e.cycle);
+    } else {
+        // Mesen: flags as letters, upper case when set
+        char flags[9];
+        const char* names = "NVUBDIZC";
+        for (int i = 0; i < 8; i++)
+            flags[i] = (e.p & (0x80 >> i)) ? names[i] : (char)(names[i] + ('a' - 'A'));
+        flags[8] = 0;
+        std::snprintf(out, sizeof(out), "%04X  $%-9s %-20s A:%02X X:%02X Y:%02X S:%02X P:%s V:%-3d H:%-3d Cycle:%llu\n",
+                      e.pc, bytes, text.c_str(), e.a, e.x, e.y, e.sp, flags, e.scanline, e.dot,
+                      (unsigned long long)e.cycle);
+    }
+    os << out;
+}
+
+} // namespace
+
+TraceLog::TraceLog(size_t capacity)
+    : m_capacity(roundUp(capacity ? capacity : 1)), m_mask(m_capacity - 1), m_ring(new Entry[m_capacity]())
+{
+}
+
+TraceLog::~TraceLog()
+{
+    stop();
+    attach(nullptr);
+}
+
+void TraceLog::attach(nes* n)
+{
+    if (m_nes && m_nes != n) m_nes->CPU.trace = nullptr;
+    m_nes = n;
+    if (!n) return;
+
+    for (int op = 0; op < 256; op++) {
+        const char* name = n->CPU.opName((uint8_t)op);
+        if (name[0] == 'X' && name[1] == 'X' && name[2] == 'X') {
+            m_len[op] = 1;
+            continue;
+        }
+        switch (n->CPU.opMode((uint8_t)op)) {
+        case cpu::AddrMode::IMP: m_len[op] = 1; break;
+        case cpu::AddrMode::ABS: case cpu::AddrMode::ABX: case cpu::AddrMode::ABY: case cpu::AddrMode::IND:
+            m_len[op] = 3;
+            break;
+        default: m_len[op] = 2; break;
+        }
+    }
+    n->CPU.trace = m_mode == Mode::Off ? nullptr : this;
+}
+
+void TraceLog::startFlightRecorder(const std::string& dumpDir)
+{
+    stop();
+    m_dumpDir = dumpDir;
+    m_mode = Mode::FlightRecorder;
+    m_start = m_head.load(std::memory_order_relaxed);
+    resetWatchdog();
+    if (m_nes) m_nes->CPU.trace = this;
+}
+
+bool TraceLog::startStream(const std::string& path, std::string* error)
+{
+    stop();
+
+    m_file = std::fopen(path.c_str(), "wb");
+    if (!m_file) {
+        if (error) *error = "cannot write " + path;
+        return false;
+    }
+
+    const uint32_t header[2] = { FILE_VERSION, (uint32_t)sizeof(Entry) };
+    std::fwrite(FILE_MAGIC, 1, sizeof(FILE_MAGIC), m_file);
+    std::fwrite(header, sizeof(header), 1, m_file);
+
+    // The writer starts at the current head; nothing older goes to the file
+    const uint64_t h = m_head.load(std::memory_order_relaxed);
+    m_tail.store(h, std::memory_order_relaxed);
+    m_tailSeen = h;
+    m_start = h;
+    m_stalls = 0;
+
+    m_stopWriter = false;
+    m_mode = Mode::Stream;
+    resetWatchdog();
+    m_writer = std::thread(&TraceLog::writerMain, this);
+    if (m_nes) m_nes->CPU.trace = this;
+    return true;
+}
+
+void TraceLog::stop()
+{
+    if (m_nes) m_nes->CPU.trace = nullptr;
+
+    if (m_writer.joinable()) {
+        m_stopWriter = true;
+        m_writer.join();
+    }
+    if (m_file) {
+        std::fclose(m_file);
+        m_file = nullptr;
+    }
+    m_mode = Mode::Off;
+}
+
+void TraceLog::waitForSpace(uint64_t head)
+{
+    m_tailSeen = m_tail.load(std::memory_order_acquire);
+    if (head - m_tailSeen < m_capacity) return;
+
+    m_stalls++;
+    while (head - (m_tailSeen = m_tail.load(std::memory_order_acquire)) >= m_capacity)
+        std::this_thread::yield();
+}
+
+void TraceLog::writerMain()
+{
+    for (;;) {
+        // Read the stop flag first, so a final pass sees everything before it
+        const bool stopping = m_stopWriter.load(std::memory_order_acquire);
+        const uint64_t head = m_head.load(std::memory_order_acquire);
+        uint64_t tail = m_tail.load(std::memory_order_relaxed);
+
+        if (tail == head) {
+            if (stopping) break;
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            continue;
+        }
+
+        while (tail != head) {
+            const size_t at = (size_t)(tail & m_mask);
+            size_t n = (size_t)std::min<uint64_t>(head - tail, m_capacity - at);
+            n = std::min(n, WRITE_CHUNK);
+            std::fwrite(&m_ring[at], sizeof(Entry), n, m_file);
+            tail += n;
+            m_tail.store(tail, std::memory_order_release);
+        }
+    }
+    std::fflush(m_file);
+}
+
+void TraceLog::resetWatchdog()
+{
+    m_watchdogFrame = m_nes ? m_nes->PPU.frameCount : 0;
+    m_watchdogCheck = std::chrono::steady_clock::now();
+    m_watchdogStuck = {};
+    m_hangCount = 0;
+    m_pcLo = 0xFFFF;
+    m_pcHi = 0x0000;
+}
+
+void TraceLog::checkWatchdog()
+{
+    const auto now = std::chrono::steady_clock::now();
+    const auto gap = now - m_watchdogCheck;
+    m_watchdogCheck = now;
+
+    const uint64_t frame = m_nes ? m_nes->PPU.frameCount : 0;
+    if (frame != m_watchdogFrame) {
+        // Frames going backwards (state load, rewind) start the count over
+        const uint64_t frames = frame > m_watchdogFrame ? frame - m_watchdogFrame : 0;
+        m_watchdogFrame = frame;
+        m_watchdogStuck = {};
+
+        // Spinning in place, with the handlers (and the player) silent
+        const uint16_t lo = m_pcLo, hi = m_pcHi;
+        const uint16_t input = m_nes ? (uint16_t)(m_nes->BUS.controller[0] | (m_nes->BUS.controller[1] << 8)) : 0;
+        const bool spinning = frames && hi >= lo && hi - lo < HANG_SPAN;
+        if (spinning && input == m_hangInput) {
+            m_hangCount += (unsigned)std::min<uint64_t>(frames, m_hangFrames);
+        } else {
+            m_hangCount = 0;
+            m_hangInput = input;
+        }
+        m_pcLo = 0xFFFF;
+        m_pcHi = 0x0000;
+
+        if (m_hangFrames && m_hangCount >= m_hangFrames) {
+            m_hangCount = 0;
+            char range[16];
+            std::snprintf(range, sizeof(range), "$%04X-$%04X", lo, hi);
+            std::string reason = "watchdog: game hung in " + std::string(range) + " for " +
+                                 std::to_string(m_hangFrames) + " frames";
+            if (m_mode == Mode::FlightRecorder) dump(reason);
+            throw std::runtime_error(reason);
+        }
+        return;
+    }
+
+    // Only time spent emulating counts: a long gap means the CPU was paused
+    if (gap < WATCHDOG_PAUSE) m_watchdogStuck += gap;
+
+    if (m_watchdogMs && m_watchdogStuck > std::chrono::milliseconds(m_watchdogMs)) {
+        m_watchdogStuck = {};
+        std::string reason = "watchdog: no frame completed in " + std::to_string(m_watchdogMs) + " ms";
+        if (m_mode == Mode::FlightRecorder) dump(reason);
+        throw std::runtime_error(reason);
+    }
+}
+
+void TraceLog::fault(const std::string& reason)
+{
+    if (m_mode == Mode::FlightRecorder) dump(reason);
+}
+
+std::vector<TraceLog::Entry> TraceLog::snapshot() const
+{
+    const uint64_t head = m_head.load(std::memory_order_acquire);
+    uint64_t first = m_mode == Mode::Stream ? m_tail.load(std::memory_order_acquire) : m_start;
+    if (head - first > m_capacity) first = head - m_capacity;
+
+    std::vector<Entry> out;
+    out.reserve((size_t)(head - first));
+    for (uint64_t i = first; i != head; i++) out.push_back(m_ring[i & m_mask]);
+    return out;
+}
+
+std::string TraceLog::dump(const std::string& reason)
+{
+    if (!m_nes || m_dumpDir.empty()) return {};
+
+    std::error_code ec;
+    fs::create_directories(m_dumpDir, ec);
+
+    char stamp[32];
+    std::time_t t = std::time(nullptr);
+    std::strftime(stamp, sizeof(stamp), "%Y%m%d-%H%M%S", std::localtime(&t));
+    const std::string base = (fs::path(m_dumpDir) / ("trace-" + std::string(stamp) + "-" + std::to_string(m_dumps++))).string();
+
+    std::ofstream out(base + ".txt");
+    if (!out) return {};
+
+    const std::vector<Entry> entries = snapshot();
+    out << "# " << reason.substr(0, reason.find('\n')) << "\n";
+    WriteText(out, *m_nes, entries.data(), entries.size(), Format::Nestest);
+    out.close();
+
+    SaveState::SaveToFile(m_nes->BUS, base + ".state");
+
+    std::cerr << "Trace dumped to " << base << ".txt (" << entries.size() << " instructions)\n";
+    m_lastDump = base + ".txt";
+    return m_lastDump;
+}
+
+TraceLog::Stats TraceLog::stats() const
+{
+    Stats s;
+    s.recorded = m_head.load(std::memory_order_relaxed) - m_start;
+    s.written = m_mode == Mode::Stream ? m_tail.load(std::memory_order_relaxed) - m_start : 0;
+    s.stalls = m_stalls;
+    s.lastDump = m_lastDump;
+    return s;
+}
+
+void TraceLog::WriteText(std::ostream& os, const nes& n, const Entry* entries, size_t count, Format format)
+{
+    for (size_t i = 0; i < count; i++) formatEntry(os, n, entries[i], format);
+}
+
+bool TraceLog::ExportFile(const nes& n, const std::string& binaryPath, const std::string& textPath,
+                          Format format, std::string* error)
+{
+    std::ifstream in(binaryPath, std::ios::binary);
+    char magic[4] = {};
+    uint32_t header[2] = {};
+    in.read(magic, sizeof(magic));
+    in.read(reinterpret_cast<char*>(header), sizeof(header));
+    if (!in || std::memcmp(magic, FILE_MAGIC, sizeof(magic)) != 0 || header[1] != sizeof(Entry)) {
+        if (error) *error = binaryPath + " is not a trace file";
+        return false;
+    }
+
+    std::ofstream out(textPath);
+    if (!out) {
+        if (error) *error = "cannot write " + textPath;
+        return false;
+    }
+
+    std::vector<Entry> chunk(WRITE_CHUNK);
+    while (in) {
+        in.read(reinterpret_cast<char*>(chunk.data()), (std::streamsize)(chunk.size() * sizeof(Entry)));
+        const size_t got = (size_t)in.gcount() / sizeof(Entry);
+        WriteText(out, n, chunk.data(), got, format);
+    }
+    return true;
+}
@@ -0,0 +1,123 @@
+#include "header/watchpoints.h"
+#include "header/Bus.h"
+#include "header/cpu.h"
+#include <algorithm>
+
+namespace {
+
+// RAM watches match any mirror
+inline uint16_t canonical(uint16_t addr, const Watchpoints::Watch& w)
+{
+    return (addr <= 0x1FFF && w.hi <= 0x07FF) ? (uint16_t)(addr & 0x07FF) : addr;
+}
+
+} // namespace
+
+void Watchpoints::attach(bus* b)
+{
+    if (m_bus && m_bus != b) {
+        for (uint8_t& t : m_bus->trapPages) t &= (uint8_t)~bus::TRAP_WATCH;
+        m_bus->watchpoints = nullptr;
+    }
+    m_bus = b;
+    rebuild();
+}
+
+int Watchpoints::add(uint16_t lo, uint16_t hi, uint8_t access, bool breaks, Condition condition)
+{
+    Watch w;
+    w.id = m_nextId++;
+    w.lo = std::min(lo, hi);
+    w.hi = std::max(lo, hi);
+    w.access = access & (Read | Write | Exec);
+    w.breaks = breaks;
+    w.condition = std::move(condition);
+    m_watches.push_back(std::move(w));
+    rebuild();
+    return m_watches.back().id;
+}
+
+void Watchpoints::remove(int id)
+{
+    m_watches.erase(std::remove_if(m_watches.begin(), m_watches.end(),
+                                   [id](const Watch& w) { return w.id == id; }),
+                    m_watches.end());
+    rebuild();
+}
+
+void Watchpoints::setEnabled(int id, bool enabled)
+{
+    for (Watch& w : m_watches)
+        if (w.id == id) w.enabled = enabled;
+    rebuild();
+}
+
+bool Watchpoints::setCondition(int id, const std::string& text, std::string* error)
+{
+    Condition condition;
+    if (!condition.compile(text, error)) return false;
+
+    for (Watch& w : m_watches)
+        if (w.id == id) w.condition = condition;
+    return true;
+}
+
+void Watchpoints::resetCounts()
+{
+    for (Watch& w : m_watches) {
+        w.accesses = 0;
+        w.hits = 0;
+    }
+}
+
+void Watchpoints::clear()
+{
+    m_watches.clear();
+    m_hasHit = false;
+    rebuild();
+}
+
+void Watchpoints::rebuild()
+{
+    if (!m_bus) return;
+
+    for (uint8_t& t : m_bus->trapPages) t &= (uint8_t)~bus::TRAP_WATCH;
+    m_bus->watchpoints = this;
+
+    for (const Watch& w : m_watches) {
+        if (!w.enabled || !w.access) continue;
+
+        for (unsigned page = w.lo >> 8; page <= (unsigned)(w.hi >> 8); page++) {
+            m_bus->trapPages[page] |= w.access;
+
+            // $0000-$07FF repeats every 2 KB up to $1FFF
+            if (w.hi <= 0x07FF)
+                for (unsigned mirror = page + 8; mirror < 0x20; mirror += 8)
+                    m_bus->trapPages[mirror] |= w.access;
+        }
+    }
+}
+
+void Watchpoints::onAccess(bus& b, Access access, uint16_t addr, uint8_t value)
+{
+    for (Watch& w : m_watches) {
+        if (!w.enabled || !(w.access & access)) continue;
+
+        uint16_t a = canonical(addr, w);
+        if (a < w.lo || a > w.hi) continue;
+
+        w.accesses++;
+        if (!w.condition.test(b, addr, value)) continue;
+        w.hits++;
+
+        m_lastHit.id = w.id;
+        m_lastHit.access = access;
+        m_lastHit.addr = addr;
+        m_lastHit.value = value;
+        m_lastHit.pc = (access == Exec || !b.connectedCPU) ? addr : b.connectedCPU->prev_PC;
+        m_hasHit = true;
+
+        if (m_callback) m_callback(m_lastHit);
+        if (w.breaks) b.breakRequested = true;
+    }
+}
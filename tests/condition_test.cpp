@@ -0,0 +1,94 @@
+// Condition parser/evaluator: every case is compiled and run against a
+// machine with known registers, so folding and fusing are checked against
+// what the expression means rather than against the bytecode they produce.
+#include "nes.h"
+#include "condition.h"
+
+#include <cstdio>
+#include <string>
+
+namespace {
+
+struct Case {
+    const char* text;
+    uint8_t a, x;
+    uint8_t carry;
+    int32_t expected;
+};
+
+const Case CASES[] = {
+    // plain leaves, fused and mirrored comparisons
+    { "A",                   5, 0, 0, 5 },
+    { "A == 5",              5, 0, 0, 1 },
+    { "5 == A",              5, 0, 0, 1 },
+    { "3 < A",               5, 0, 0, 1 },
+    { "A < 3",               5, 0, 0, 0 },
+    { "X + 1",               0, 9, 0, 10 },
+
+    // constant folding
+    { "2 + 3 * 4",           0, 0, 0, 14 },
+    { "$10 << 2 | 1",        0, 0, 0, 0x41 },
+    { "!0 && ~0 == -1",      0, 0, 0, 1 },
+
+    // short circuit
+    { "A && C",              0, 0, 1, 0 },
+    { "A && C",              5, 0, 1, 1 },
+    { "A || C",              0, 0, 0, 0 },
+    { "A || X",              0, 7, 0, 1 },
+    { "A == 5 && X == 2",    5, 2, 0, 1 },
+    { "A == 5 && X == 2",    5, 3, 0, 0 },
+
+    // the result of && / || as the left operand of a folded operator
+    { "(A && C) == 0",       0, 0, 1, 1 },
+    { "(A && C) == 0",       5, 0, 1, 0 },
+    { "(A || C) == 0",       5, 0, 0, 0 },
+    { "(A || C) == 0",       0, 0, 0, 1 },
+    { "(A && C) + 1",        0, 0, 1, 1 },
+    { "(A || C) < 1",        5, 0, 0, 0 },
+    { "(A && X == 1) == 0",  0, 1, 0, 1 },
+    { "1 == (A && C)",       5, 0, 1, 1 },
+    { "(A && C || X) == 0",  0, 0, 1, 1 },
+};
+
+const char* const ERRORS[] = { "A ==", "(A", "[$10", "foo", "A $", "99999999999" };
+
+} // namespace
+
+int main()
+{
+    nes n;
+    int failed = 0;
+
+    for (const Case& c : CASES) {
+        n.CPU.A = c.a;
+        n.CPU.X = c.x;
+        n.CPU.P = c.carry ? 0x01 : 0x00;
+
+        Condition cond;
+        std::string error;
+        if (!cond.compile(c.text, &error)) {
+            std::printf("FAIL %-22s does not compile: %s\n", c.text, error.c_str());
+            failed++;
+            continue;
+        }
+
+        const int32_t got = cond.evaluate(n.BUS, 0, 0);
+        if (got != c.expected) {
+            std::printf("FAIL %-22s A=%u X=%u C=%u: got %d, want %d\n%s",
+                        c.text, c.a, c.x, c.carry, got, c.expected, cond.dump().c_str());
+            failed++;
+        }
+    }
+
+    for (const char* text : ERRORS) {
+        Condition cond;
+        if (cond.compile(text)) {
+            std::printf("FAIL %-22s compiled, should not\n", text);
+            failed++;
+        }
+    }
+
+    std::printf("%d of %zu condition cases failed\n", failed,
+                sizeof(CASES) / sizeof(CASES[0]) + sizeof(ERRORS) / sizeof(ERRORS[0]));
+    return failed ? 1 : 0;
+}
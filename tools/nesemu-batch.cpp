@@ -0,0 +1,116 @@
+// nesemu-batch: run every ROM in a directory headless, one instance per job,
+// spread across all cores, and print a compatibility/throughput report.
+//
+//   nesemu-batch <rom-dir> [--frames N] [--threads T] [--recursive] [--csv report.csv]
+//                [--warm-cache dir] [--warm-frames N] [--isolate]
+//                [--trace-dir dir] [--watchdog ms] [--cdl dir] [--cheat code]...
+//
+// A ROM with <name>.nesmovie or <name>.fm2 next to it plays that movie
+// instead of running N frames with no input. With --warm-cache, the state
+// after the first --warm-frames frames (default 300) is cached on disk and
+// restored by later jobs and runs that start the same way. --isolate runs
+// jobs in worker processes, so a ROM that crashes the emulator only costs
+// its own job. With --trace-dir, a job that faults (unknown opcode, or a
+// frame running longer than --watchdog ms) leaves its last 100K
+// instructions and a save state in dir/<rom name>/. With --cdl, every job
+// adds to a code/data log per ROM and movie in dir, and the logs of each
+// ROM are merged into dir/<rom name>.cdl with a coverage report. Each
+// --cheat (Game Genie or AAAA:VV[:CC]) is applied to every job, so the
+// fps columns show throughput with patched pages.
+
+#include "batch.h"
+#include "ThreadPool.h"
+#include "cheats.h"
+
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+static void usage()
+{
+    std::cerr << "usage: nesemu-batch <rom-dir> [--frames N] [--threads T] [--recursive] [--csv report.csv]\n"
+                 "                    [--warm-cache dir] [--warm-frames N] [--isolate]\n"
+                 "                    [--trace-dir dir] [--watchdog ms] [--cdl dir] [--cheat code]...\n";
+}
+
+int main(int argc, char** argv)
+{
+    std::string dir;
+    std::string csvPath;
+    uint64_t frames = 600;
+    size_t threads = 0;
+    bool recursive = false;
+    bool isolate = false;
+    Batch::Options options;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+
+        if (arg == "--frames" && hasValue)        frames = std::strtoull(argv[++i], nullptr, 10);
+        else if (arg == "--threads" && hasValue)  threads = (size_t)std::strtoul(argv[++i], nullptr, 10);
+        else if (arg == "--csv" && hasValue)      csvPath = argv[++i];
+        else if (arg == "--warm-cache" && hasValue)  options.warmCacheDir = argv[++i];
+        else if (arg == "--warm-frames" && hasValue) options.warmFrames = std::strtoull(argv[++i], nullptr, 10);
+        else if (arg == "--trace-dir" && hasValue)   options.traceDir = argv[++i];
+        else if (arg == "--watchdog" && hasValue)    options.watchdogMs = (unsigned)std::strtoul(argv[++i], nullptr, 10);
+        else if (arg == "--cdl" && hasValue)         options.cdlDir = argv[++i];
+        else if (arg == "--cheat" && hasValue)       options.cheats.push_back(argv[++i]);
+        else if (arg == "--recursive")            recursive = true;
+        else if (arg == "--isolate")              isolate = true;
+        else if (arg[0] != '-' && dir.empty())    dir = arg;
+        else { usage(); return 2; }
+    }
+
+    if (dir.empty()) { usage(); return 2; }
+
+    for (const std::string& code : options.cheats) {
+        Cheats::Cheat cheat;
+        std::string error;
+        if (!Cheats::Parse(code, cheat, &error)) {
+            std::cerr << error << "\n";
+            return 2;
+        }
+    }
+
+    std::vector<Batch::Job> jobs = Batch::FindJobs(dir, frames, recursive);
+    if (jobs.empty()) {
+        std::cerr << "no .nes files in " << dir << "\n";
+        return 1;
+    }
+
+    std::vector<Batch::Result> results(jobs.size());
+
+    auto t0 = std::chrono::steady_clock::now();
+    if (isolate) {
+        std::cerr << jobs.size() << " jobs in worker processes\n";
+        results = Batch::RunIsolated(jobs, threads, options);
+    } else {
+        ThreadPool pool(threads);
+        std::cerr << jobs.size() << " jobs on " << pool.size() << " threads\n";
+        pool.parallelFor(jobs.size(), [&](size_t i) { results[i] = Batch::Run(jobs[i], options); });
+    }
+    double wall = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+
+    Batch::WriteReport(std::cout, results, wall);
+
+    if (!options.cdlDir.empty()) {
+        std::cout << "\nCoverage\n";
+        Batch::MergeCoverage(options.cdlDir, jobs, std::cout);
+    }
+
+    if (!csvPath.empty()) {
+        std::ofstream csv(csvPath);
+        if (!csv.is_open()) {
+            std::cerr << "cannot write " << csvPath << "\n";
+            return 1;
+        }
+        Batch::WriteCsv(csv, results);
+    }
+
+    return 0;
+}